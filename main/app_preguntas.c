@@ -1,184 +1,78 @@
 #include "app_interface.h"
 #include "printer_driver.h"
+#include "print_spool.h"
+#include "escpos.h"
+#include "ticket_template.h"
+#include "web_server.h"
+#include "form_parser.h"
+#include "status_push.h"
+#include "job_status.h"
+#include "web_assets.h"
+#include "nvs_storage.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
 
 static const char *TAG = "APP_PREGUNTAS";
 static uint32_t pregunta_counter = 0;
+// Cliente del pedido en curso (el servidor HTTP atiende de a uno)
+static uint32_t current_client = 0;
 
-const char *html_form = 
-"<!DOCTYPE html>"
-"<html lang='es'>"
-"<head>"
-"    <meta charset='UTF-8'>"
-"    <meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-"    <title>Pregunta lo que quieras!!</title>"
-"    <style>"
-"        body {"
-"            font-family: Arial, sans-serif;"
-"            background-color: #f4f6f9;"
-"            margin: 0;"
-"            padding: 0;"
-"            display: flex;"
-"            justify-content: center;"
-"            align-items: center;"
-"            height: 100vh;"
-"        }"
-"        .container {"
-"            width: 90%;"
-"            max-width: 480px;"
-"            background: #fff;"
-"            padding: 24px;"
-"            border-radius: 12px;"
-"            box-shadow: 0 4px 12px rgba(0,0,0,0.2);"
-"        }"
-"        h1 {"
-"            text-align: center;"
-"            color: #333;"
-"            margin-bottom: 20px;"
-"        }"
-"        .status {"
-"            text-align: center;"
-"            padding: 10px;"
-"            border-radius: 5px;"
-"            margin-bottom: 15px;"
-"        }"
-"        .ready { background: #d4edda; color: #155724; }"
-"        .waiting { background: #fff3cd; color: #856404; }"
-"        .error { background: #f8d7da; color: #721c24; }"
-"        textarea {"
-"            width: 100%;"
-"            height: 120px;"
-"            padding: 12px;"
-"            font-size: 16px;"
-"            border: 1px solid #ccc;"
-"            border-radius: 8px;"
-"            box-sizing: border-box;"
-"            resize: none;"
-"        }"
-"        .char-counter {"
-"            text-align: right;"
-"            font-size: 12px;"
-"            color: #666;"
-"            margin-top: 5px;"
-"        }"
-"        button {"
-"            margin-top: 20px;"
-"            width: 100%;"
-"            background-color: #007BFF;"
-"            color: white;"
-"            padding: 14px;"
-"            font-size: 18px;"
-"            border: none;"
-"            border-radius: 8px;"
-"            cursor: pointer;"
-"            transition: background-color 0.3s ease;"
-"        }"
-"        button:hover {"
-"            background-color: #0056b3;"
-"        }"
-"        button:disabled {"
-"            background-color: #cccccc;"
-"            cursor: not-allowed;"
-"        }"
-"    </style>"
-"</head>"
-"<body>"
-"    <div class='container'>"
-"        <h1>Escribí lo que quieras</h1>"
-"        <div id='status' class='status waiting'>Conectando...</div>"
-"        <form action='/msg' method='POST' id='msgForm'>"
-"            <textarea name='msg' id='msgText' placeholder='Escribe tu mensaje ANÓNIMO aquí...' "
-"                     maxlength='200' required></textarea>"
-"            <div class='char-counter'><span id='charCount'>0</span>/200</div>"
-"            <button type='submit' id='submitBtn' disabled>Enviar</button>"
-"        </form>"
-"    </div>"
-"    <script>"
-"        const textarea = document.getElementById('msgText');"
-"        const charCount = document.getElementById('charCount');"
-"        const submitBtn = document.getElementById('submitBtn');"
-"        const statusDiv = document.getElementById('status');"
-"        let consecutiveErrors = 0;"
-"        "
-"        textarea.addEventListener('input', function() {"
-"            charCount.textContent = this.value.length;"
-"        });"
-"        "
-"        function checkPrinterStatus() {"
-"            console.log('🔍 Consultando /printer_status...');"
-"            fetch('/printer_status', {"
-"                method: 'GET',"
-"                cache: 'no-cache'"
-"            })"
-"            .then(response => {"
-"                console.log('📡 Response status:', response.status, response.ok);"
-"                if (!response.ok) {"
-"                    throw new Error('HTTP error ' + response.status);"
-"                }"
-"                return response.text();"
-"            })"
-"            .then(text => {"
-"                console.log('📄 Raw response:', text);"
-"                try {"
-"                    const data = JSON.parse(text);"
-"                    console.log('📊 Parsed data:', data);"
-"                    consecutiveErrors = 0;"
-"                    "
-"                    if (data.ready === true) {"
-"                        statusDiv.textContent = '✓ Impresora lista';"
-"                        statusDiv.className = 'status ready';"
-"                        submitBtn.disabled = false;"
-"                        console.log('✅ Impresora LISTA');"
-"                    } else {"
-"                        statusDiv.textContent = '⏳ Esperando impresora...';"
-"                        statusDiv.className = 'status waiting';"
-"                        submitBtn.disabled = true;"
-"                        console.log('⏳ Impresora NO lista');"
-"                    }"
-"                } catch(e) {"
-"                    console.error('❌ JSON parse error:', e);"
-"                    statusDiv.textContent = '✗ Error de formato';"
-"                    statusDiv.className = 'status error';"
-"                }"
-"            })"
-"            .catch((error) => {"
-"                consecutiveErrors++;"
-"                console.error('💥 Fetch error:', error);"
-"                statusDiv.textContent = '✗ Error de conexión (' + consecutiveErrors + ')';"
-"                statusDiv.className = 'status error';"
-"                submitBtn.disabled = true;"
-"            });"
-"        }"
-"        "
-"        console.log('🚀 Iniciando monitor...');"
-"        checkPrinterStatus();"
-"        setInterval(checkPrinterStatus, 2000);"
-"        "
-"        document.getElementById('msgForm').addEventListener('submit', function(e) {"
-"            e.preventDefault();"
-"            const formData = new FormData(this);"
-"            submitBtn.disabled = true;"
-"            submitBtn.textContent = 'Enviando...';"
-"            "
-"            fetch('/msg', {"
-"                method: 'POST',"
-"                body: formData"
-"            }).then(r => r.text()).then(() => {"
-"                textarea.value = '';"
-"                charCount.textContent = '0';"
-"                submitBtn.textContent = '✓ Enviado!';"
-"                setTimeout(() => {"
-"                    submitBtn.textContent = 'Enviar';"
-"                    checkPrinterStatus();"
-"                }, 2000);"
-"            });"
-"        });"
-"    </script>"
-"</body>"
-"</html>";
+#define PREGUNTA_MAX_LEN          511   // Lo que entra en el buffer de msg_post_handler
+#define PREGUNTA_TICKET_SIZE      (PREGUNTA_MAX_LEN + 512) // Texto + la parte fija más larga de la plantilla
+#define PREGUNTA_TEMPLATE         "pregunta"
+#define PREGUNTA_SEP_TEMPLATE     "preg_sep"
+#define PREGUNTA_END_TEMPLATE     "preg_fin"
+
+// Lotes: las preguntas que llegan juntas salen en una sola tira con un
+// único avance y corte al final. La ventana y el máximo por tira salen de
+// menuconfig y se pueden cambiar en /batch (se guardan en NVS); el máximo
+// de menuconfig es además el tope, porque dimensiona la tira.
+#define PREGUNTA_BATCH_WINDOW_MAX 30000 // Ventana más larga aceptada en /batch
+#define PREGUNTA_BATCH_MAX        CONFIG_ALLTOPRINT_PREGUNTA_BATCH_MAX
+#define PREGUNTA_WINDOW_KEY       "preg_window"
+#define PREGUNTA_MAX_KEY          "preg_max"
+#define PREGUNTA_TEMPLATE_RESERVE 512   // Lo que puede ocupar un separador o el cierre (una plantilla compilada)
+// Entran PREGUNTA_BATCH_MAX tickets del tamaño máximo, cada uno con su
+// separador, y el cierre: el máximo por tira siempre llega antes que el
+// límite de tamaño
+#define PREGUNTA_BATCH_SIZE       (PREGUNTA_BATCH_MAX * (PREGUNTA_TICKET_SIZE + PREGUNTA_TEMPLATE_RESERVE))
+
+// Tickets por defecto; se pueden reemplazar en /template sin reflashear.
+// Una pregunta suelta es pregunta + cierre; en un lote van separadas por
+// el separador y el cierre sale una sola vez.
+static const char *pregunta_template =
+    "{center}PREGUNTA ANONIMA\n"
+    "================================\n"
+    "{$texto}\n\n";
+static const char *pregunta_sep_template =
+    "{center}- - - - - - - - - - - - - - - -\n\n";
+static const char *pregunta_end_template =
+    "{center}================================\n"
+    "AllToPrint - Preguntas\n"
+    "{feed:3}{cut}";
+static const char *const pregunta_fields[] = { "texto", "numero" };
+
+// Tira en armado (bajo batch_mutex)
+static uint8_t batch_buf[PREGUNTA_BATCH_SIZE];
+static size_t batch_len = 0;
+static int batch_count = 0;
+static uint32_t batch_client = 0;
+static uint32_t batch_job = 0;        // Id de la tira (todas sus preguntas lo comparten)
+static SemaphoreHandle_t batch_mutex = NULL;
+static esp_timer_handle_t batch_timer = NULL;
+static uint32_t batch_window_ms = CONFIG_ALLTOPRINT_PREGUNTA_BATCH_WINDOW_MS; // 0 = sin lotes
+static int batch_max = PREGUNTA_BATCH_MAX;
+
+// Página del formulario (web/preguntas.html, embebida comprimida)
+WEB_ASSET_DECLARE(preguntas_html, "text/html");
 
 static void app_init(void) {
     // NO inicializar printer aquí - ya se hizo en main.c
@@ -186,158 +80,336 @@ static void app_init(void) {
     ESP_LOGI(TAG, "App 'Preguntas' inicializada (printer ya iniciado en main)");
 }
 
-static void imprimir_pregunta(const char *texto) {
-    if (!printer_is_ready()) {
-        ESP_LOGW(TAG, "Impresora no lista, mensaje no impreso");
+// Cierra la tira en armado y la encola. Llamar con batch_mutex tomado.
+static void batch_flush_locked(void) {
+    if (batch_count == 0) {
         return;
     }
-        
-    char print_buffer[512];
-    int offset = 0;
+    esp_timer_stop(batch_timer);
+    
+    // El cierre siempre entra: se reservó lugar al agregar cada pregunta
+    escpos_t b;
+    escpos_begin_buffer(&b, batch_buf + batch_len, sizeof(batch_buf) - batch_len);
+    ticket_template_render(PREGUNTA_END_TEMPLATE, NULL, &b);
+    if (escpos_error(&b) == ESP_OK) {
+        batch_len += escpos_length(&b);
+    } else {
+        ESP_LOGW(TAG, "Cierre de tira demasiado largo, se omite");
+    }
+    
+    // Sin esperar la flash: corre en el timer o en el handler HTTP
+    esp_err_t ret = print_spool_submit_async(batch_buf, batch_len, PRINTER_PRIO_NORMAL,
+                                             batch_client, batch_job);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "✓ Tira #%lu con %d pregunta(s) encolada (%u bytes)", batch_job, batch_count, batch_len);
+    } else {
+        ESP_LOGE(TAG, "✗ Error encolando tira: %s", esp_err_to_name(ret));
+        job_status_set(batch_job, JOB_STATUS_FAILED);
+    }
     
-    offset += snprintf(print_buffer + offset, sizeof(print_buffer) - offset,
-                      "%s%s",
-                      ESC_ALIGN_CENTER,
-                      "PREGUNTA ANONIMA\n");
+    batch_len = 0;
+    batch_count = 0;
+    batch_job = 0;
+}
+
+// Agrega un ticket a la tira, con separador si no es el primero.
+// Llamar con batch_mutex tomado.
+static bool batch_append_locked(const uint8_t *ticket, size_t len) {
+    escpos_t b;
+    escpos_begin_buffer(&b, batch_buf + batch_len,
+                        sizeof(batch_buf) - PREGUNTA_TEMPLATE_RESERVE - batch_len);
+    if (batch_count > 0) {
+        ticket_template_render(PREGUNTA_SEP_TEMPLATE, NULL, &b);
+    }
+    escpos_raw(&b, ticket, len);
+    if (escpos_error(&b) != ESP_OK) {
+        return false;
+    }
     
-    offset += snprintf(print_buffer + offset, sizeof(print_buffer) - offset,
-                      "%s",
-                      "================================\n");
+    if (batch_count == 0) {
+        batch_client = current_client;
+        batch_job = job_status_create();
+    }
+    batch_len += escpos_length(&b);
+    batch_count++;
+    return true;
+}
+
+// Plazo de la tira: la primera pregunta nunca espera más que la ventana
+static void batch_timer_cb(void *arg) {
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    batch_flush_locked();
+    xSemaphoreGive(batch_mutex);
+}
+
+// Ventana y máximo válidos: se aplican al instante, sin tocar NVS.
+// Llamar con batch_mutex tomado.
+static void batch_configure_locked(uint32_t window_ms, int max) {
+    // Lo ya armado sale con la configuración con la que se armó
+    batch_flush_locked();
+    batch_window_ms = window_ms;
+    batch_max = max;
+}
+
+static void batch_init(void) {
+    if (batch_mutex) {
+        return;
+    }
+    batch_mutex = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t timer_args = {
+        .callback = batch_timer_cb,
+        .name = "preg_batch",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &batch_timer));
     
-    offset += snprintf(print_buffer + offset, sizeof(print_buffer) - offset,
-                      "%s\n\n",
-                      texto);
+    // Lo guardado en /batch reemplaza a menuconfig; lo inválido se ignora
+    char value[8];
+    if (nvs_get_str_value(PREGUNTA_WINDOW_KEY, value, sizeof(value), "") == ESP_OK && value[0]) {
+        unsigned long window = strtoul(value, NULL, 10);
+        if (window <= PREGUNTA_BATCH_WINDOW_MAX) {
+            batch_window_ms = window;
+        }
+    }
+    if (nvs_get_str_value(PREGUNTA_MAX_KEY, value, sizeof(value), "") == ESP_OK && value[0]) {
+        int max = atoi(value);
+        if (max >= 1 && max <= PREGUNTA_BATCH_MAX) {
+            batch_max = max;
+        }
+    }
+    ESP_LOGI(TAG, "Lotes: ventana %lu ms, hasta %d preguntas por tira", batch_window_ms, batch_max);
+}
+
+// Devuelve el id del trabajo que la lleva (ver job_status.h), 0 si no se
+// aceptó. No espera a la flash ni a la impresora.
+static uint32_t imprimir_pregunta(const char *texto) {
+    // Con spool la pregunta queda en flash hasta que vuelva la impresora
+    if (!print_spool_is_active() && !printer_is_ready()) {
+        ESP_LOGW(TAG, "Impresora no lista, mensaje no impreso");
+        return 0;
+    }
+        
+    uint8_t ticket[PREGUNTA_TICKET_SIZE];
+    escpos_t b;
+    escpos_begin_buffer(&b, ticket, sizeof(ticket));
     
-    offset += snprintf(print_buffer + offset, sizeof(print_buffer) - offset,
-                      "%s================================\n",
-                      ESC_ALIGN_CENTER);
+    // El número se confirma recién cuando la pregunta se acepta, así los
+    // tickets impresos no saltean números
+    uint32_t n = pregunta_counter + 1;
+    char numero[12];
+    snprintf(numero, sizeof(numero), "%lu", n);
+    const char *values[] = { texto, numero };
+    ticket_template_render(PREGUNTA_TEMPLATE, values, &b);
     
-    offset += snprintf(print_buffer + offset, sizeof(print_buffer) - offset,
-                      "AllToPrint - Preguntas\n");
+    // Sin lotes: cada pregunta con su propio cierre
+    bool batching = batch_window_ms > 0;
+    if (!batching) {
+        ticket_template_render(PREGUNTA_END_TEMPLATE, NULL, &b);
+    }
     
-    offset += snprintf(print_buffer + offset, sizeof(print_buffer) - offset,
-                      "%s%s",
-                      ESC_FEED_3,
-                      ESC_CUT_PARTIAL);
+    // Nunca se imprime un ticket cortado
+    if (escpos_error(&b) != ESP_OK) {
+        ESP_LOGE(TAG, "✗ Pregunta demasiado larga (%u bytes, máximo %u)",
+                 escpos_length(&b), sizeof(ticket));
+        return 0;
+    }
     
-    esp_err_t ret = printer_send_raw((uint8_t*)print_buffer, offset);
+    if (!batching) {
+        uint32_t job = job_status_create();
+        esp_err_t ret = print_spool_submit_async(ticket, escpos_length(&b), PRINTER_PRIO_NORMAL,
+                                                 current_client, job);
+        if (ret == ESP_OK) {
+            pregunta_counter = n;
+            ESP_LOGI(TAG, "✓ Pregunta #%lu encolada para impresión", n);
+        } else {
+            ESP_LOGE(TAG, "✗ Error encolando pregunta: %s", esp_err_to_name(ret));
+            job_status_set(job, JOB_STATUS_FAILED);
+            job = 0;
+        }
+        return job;
+    }
     
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "✓ Pregunta #%lu encolada para impresión", pregunta_counter);
-    } else {
-        ESP_LOGE(TAG, "✗ Error encolando pregunta: %s", esp_err_to_name(ret));
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    // Tira llena: sale la que hay y esta pregunta abre otra
+    bool added = batch_append_locked(ticket, escpos_length(&b));
+    if (!added && batch_count > 0) {
+        batch_flush_locked();
+        added = batch_append_locked(ticket, escpos_length(&b));
+    }
+    if (!added) {
+        // No entra ni sola (separador o cierre personalizados muy largos)
+        xSemaphoreGive(batch_mutex);
+        ESP_LOGE(TAG, "✗ Pregunta no entra en una tira (%u bytes)", escpos_length(&b));
+        return 0;
+    }
+    pregunta_counter = n;
+    if (batch_count == 1) {
+        esp_timer_start_once(batch_timer, batch_window_ms * 1000ULL);
+    }
+    uint32_t job = batch_job;
+    if (batch_count >= batch_max) {
+        batch_flush_locked();
     }
+    xSemaphoreGive(batch_mutex);
+    
+    ESP_LOGI(TAG, "✓ Pregunta #%lu agregada a la tira #%lu", n, job);
+    return job;
 }
 
 static void app_handle_message(const char *msg) {
     ESP_LOGI(TAG, "Mensaje recibido: %s", msg);
     imprimir_pregunta(msg);
+    // El contador y la cola cambiaron: avisar ya, sin esperar el chequeo
+    status_push_notify();
 }
 
 static esp_err_t msg_post_handler(httpd_req_t *req) {
-    char buf[512] = {0}; 
-    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
-    if (ret <= 0) {
+    current_client = web_client_id(req);
+    char msg[PREGUNTA_MAX_LEN + 1] = {0};
+    form_text_t field = FORM_TEXT_INIT("msg", msg, sizeof(msg));
+    
+    // El formulario llega como multipart (FormData) o url-encoded
+    esp_err_t ret = form_parse_request(req, form_text_cb, &field);
+    if (ret == ESP_FAIL) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
-    buf[ret] = '\0';
+    if (ret != ESP_OK || !field.found) {
+        ESP_LOGE(TAG, "Error: formulario sin campo 'msg' (%s)", esp_err_to_name(ret));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Falta el campo msg");
+        return ESP_FAIL;
+    }
     
-    char *msg_start = NULL;
-    char *msg_end = NULL;
-
-    // 1. Encontrar el inicio del campo 'msg'
-    char *msg_header = strstr(buf, "name=\"msg\""); 
+    // Limpiar espacios en blanco o saltos de línea al final del mensaje
+    while (field.len > 0 && (msg[field.len - 1] == '\r' || msg[field.len - 1] == '\n' || msg[field.len - 1] == ' ')) {
+        msg[--field.len] = '\0';
+    }
     
-    if (msg_header) {
-        // 2. Buscar el doble salto de línea ESTÁNDAR HTTP (CRLF)
-        msg_start = strstr(msg_header, "\r\n\r\n");
-        
-        // Fallback: si no es el estándar (aunque el JS debería usar CRLF), probamos con solo \n\n
-        if (!msg_start) {
-            msg_start = strstr(msg_header, "\n\n");
-        }
+    // Se responde al encolar; el avance se sigue en /job/<id>
+    ESP_LOGI(TAG, "Mensaje recibido: %s", msg);
+    uint32_t job = imprimir_pregunta(msg);
+    status_push_notify();
+    
+    return job_status_respond(req, job);
+}
 
-        if (msg_start) {
-            // Ajustar el puntero para que apunte al inicio del contenido real
-            // Si encontramos \r\n\r\n, avanzamos 4 bytes. Si encontramos \n\n, avanzamos 2.
-            msg_start += (msg_start[1] == '\n') ? 2 : 4; 
-            
-            // 3. Encontrar el final del contenido (el boundary). El boundary comienza con \r\n
-            msg_end = strstr(msg_start, "\r\n------"); 
-            
-            // Fallback: si no es el estándar, probar con solo \n
-            if (!msg_end) {
-                msg_end = strstr(msg_start, "\n------");
-            }
-            
-            // 4. Terminar el string
-            if (msg_end) {
-                // El caracter antes del boundary debe ser el terminador de línea del mensaje. Lo reemplazamos con '\0'.
-                *msg_end = '\0'; 
-                
-                // Limpiar espacios en blanco o saltos de línea al final del mensaje extraído
-                size_t len = strlen(msg_start);
-                // Si el mensaje termina con \r o \n, lo eliminamos
-                while (len > 0 && (msg_start[len - 1] == '\r' || msg_start[len - 1] == '\n' || msg_start[len - 1] == ' ')) {
-                    msg_start[len - 1] = '\0';
-                    len--;
-                }
+// GET /batch muestra la configuración de los lotes; POST /batch con
+// ?window_ms=N y/o ?max=N la cambia al instante y la guarda en NVS
+static esp_err_t batch_get_handler(httpd_req_t *req) {
+    char json[80];
+    
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    int len = snprintf(json, sizeof(json), "{\"window_ms\":%lu,\"max\":%d,\"max_limit\":%d}",
+                       batch_window_ms, batch_max, PREGUNTA_BATCH_MAX);
+    xSemaphoreGive(batch_mutex);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, json, len);
+}
 
-                // Llamar al manejador con el mensaje limpio
-                app_handle_message(msg_start);
-            } else {
-                // Caso extremo o si es el único campo sin boundary claro (lo enviamos "crudo")
-                app_handle_message(msg_start);
-            }
-        } else {
-            ESP_LOGE(TAG, "Error: Contenido del mensaje no delimitado correctamente.");
-            app_handle_message("Error de formato multipart"); 
+static esp_err_t batch_post_handler(httpd_req_t *req) {
+    char query[48];
+    char value[8];
+    char *end;
+    
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    unsigned long window = batch_window_ms;
+    long max = batch_max;
+    xSemaphoreGive(batch_mutex);
+    
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Falta ?window_ms= o ?max=");
+    }
+    if (httpd_query_key_value(query, "window_ms", value, sizeof(value)) == ESP_OK) {
+        window = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || window > PREGUNTA_BATCH_WINDOW_MAX) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "window_ms: de 0 a 30000");
+        }
+    }
+    if (httpd_query_key_value(query, "max", value, sizeof(value)) == ESP_OK) {
+        max = strtol(value, &end, 10);
+        if (end == value || *end != '\0' || max < 1 || max > PREGUNTA_BATCH_MAX) {
+            char err[40];
+            snprintf(err, sizeof(err), "max: de 1 a %d", PREGUNTA_BATCH_MAX);
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
         }
-    } else {
-        // Fallback: Si no es multipart/form-data (p. ej., si es form-urlencoded), usar el buffer crudo
-        // Nota: Si usas este fallback, deberías re-introducir la lógica de decodificación de URL de tu código original.
-        ESP_LOGW(TAG, "No se encontró 'name=\"msg\"'. Procesando como URL-encoded o texto plano.");
-        app_handle_message(buf);
     }
     
-    httpd_resp_sendstr(req, "OK");
-    return ESP_OK;
+    char stored[8];
+    snprintf(stored, sizeof(stored), "%lu", window);
+    esp_err_t ret = nvs_set_str_value(PREGUNTA_WINDOW_KEY, stored);
+    if (ret == ESP_OK) {
+        snprintf(stored, sizeof(stored), "%ld", max);
+        ret = nvs_set_str_value(PREGUNTA_MAX_KEY, stored);
+    }
+    if (ret != ESP_OK) {
+        return httpd_resp_send_500(req);
+    }
+    
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    batch_configure_locked(window, max);
+    xSemaphoreGive(batch_mutex);
+    
+    ESP_LOGI(TAG, "Lotes: ventana %lu ms, hasta %ld preguntas por tira", window, max);
+    return batch_get_handler(req);
 }
 
 static esp_err_t root_get_handler(httpd_req_t *req) {
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, html_form, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return web_asset_send(req, &preguntas_html_asset);
 }
 
-// 🔥 HANDLER MEJORADO CON MÁS LOGS
-static esp_err_t printer_status_handler(httpd_req_t *req) {
-    ESP_LOGI(TAG, "📞 /printer_status consultado");
+// Estado compacto de la impresora: lo usan /printer_status y el WebSocket
+static int build_status_json(char *response, size_t size) {
+    bool ready = printer_is_ready();
     
+    // Motivo real: el de la primera impresora sin error, o el de la última
+    const char *reason = "disconnected";
+    for (int i = 0; i < printer_get_device_count(); i++) {
+        printer_status_t st;
+        if (printer_get_status(i, &st) == ESP_OK) {
+            reason = printer_status_reason(&st);
+            if (!st.fault) {
+                break;
+            }
+        }
+    }
+    
+    int len = snprintf(response, size, 
+                      "{\"ready\":%s,\"counter\":%lu,\"status\":\"%s\",\"bytes_saved\":%lu,\"lanes\":[", 
+                      ready ? "true" : "false",
+                      pregunta_counter,
+                      reason,
+                      printer_get_bytes_saved(NULL));
+    
+    // Espera estimada de un trabajo nuevo en cada carril
+    for (int lane = 0; lane < PRINTER_PRIO_COUNT; lane++) {
+        uint32_t queued = print_spool_pending_lane(lane);
+        len += snprintf(response + len, size - len,
+                        "%s{\"queued\":%lu,\"wait_ms\":%lu}",
+                        lane ? "," : "",
+                        queued,
+                        printer_estimate_wait_ms(lane, queued));
+    }
+    len += snprintf(response + len, size - len, "]}");
+    return len;
+}
+
+// Respaldo de los navegadores sin WebSocket (se consulta cada 10 s)
+static esp_err_t printer_status_handler(httpd_req_t *req) {
     httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
     httpd_resp_set_hdr(req, "Pragma", "no-cache");
     httpd_resp_set_hdr(req, "Expires", "0");
     
-    bool ready = printer_is_ready();
-    
-    ESP_LOGI(TAG, "📊 printer_is_ready() = %s", ready ? "TRUE" : "FALSE");
-    
-    char response[128];
-    int len = snprintf(response, sizeof(response), 
-                      "{\"ready\":%s,\"counter\":%lu}", 
-                      ready ? "true" : "false",
-                      pregunta_counter);
+    char response[STATUS_PUSH_MAX_LEN];
+    int len = build_status_json(response, sizeof(response));
     
-    ESP_LOGI(TAG, "📤 Enviando: %s", response);
+    ESP_LOGD(TAG, "📤 /printer_status: %s", response);
     
     esp_err_t ret = httpd_resp_send(req, response, len);
     
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "❌ Error enviando respuesta: %s", esp_err_to_name(ret));
-    } else {
-        ESP_LOGI(TAG, "✅ Respuesta enviada correctamente");
     }
     
     return ret;
@@ -346,6 +418,12 @@ static esp_err_t printer_status_handler(httpd_req_t *req) {
 static void app_register_http_handlers(httpd_handle_t server) {
     ESP_LOGI(TAG, "📝 Registrando endpoints HTTP...");
     
+    // Se compila una sola vez; cada pregunta solo copia tramos
+    ticket_template_declare(PREGUNTA_TEMPLATE, pregunta_template, pregunta_fields, 2);
+    ticket_template_declare(PREGUNTA_SEP_TEMPLATE, pregunta_sep_template, NULL, 0);
+    ticket_template_declare(PREGUNTA_END_TEMPLATE, pregunta_end_template, NULL, 0);
+    batch_init();
+    
     httpd_uri_t root_uri = {
         .uri = "/",
         .method = HTTP_GET,
@@ -373,6 +451,28 @@ static void app_register_http_handlers(httpd_handle_t server) {
     ret = httpd_register_uri_handler(server, &status_uri);
     ESP_LOGI(TAG, "/printer_status → %s", esp_err_to_name(ret));
     
+    httpd_uri_t batch_get_uri = {
+        .uri = "/batch",
+        .method = HTTP_GET,
+        .handler = batch_get_handler,
+        .user_ctx = NULL
+    };
+    ret = httpd_register_uri_handler(server, &batch_get_uri);
+    httpd_uri_t batch_post_uri = {
+        .uri = "/batch",
+        .method = HTTP_POST,
+        .handler = batch_post_handler,
+        .user_ctx = NULL
+    };
+    if (ret == ESP_OK) {
+        ret = httpd_register_uri_handler(server, &batch_post_uri);
+    }
+    ESP_LOGI(TAG, "/batch → %s", esp_err_to_name(ret));
+    
+    // Push del mismo estado; si no hay WebSocket la página consulta
+    ret = status_push_register(server, "/status_ws", build_status_json);
+    ESP_LOGI(TAG, "/status_ws → %s", esp_err_to_name(ret));
+    
     ESP_LOGI(TAG, "🎯 Endpoints registrados");
 }
 
@@ -0,0 +1,186 @@
+#include "escpos.h"
+#include <string.h>
+
+// ============================================
+// SECUENCIAS FIJAS
+// ============================================
+// Comandos sin parámetros: constantes en flash, se copian tal cual
+
+static const uint8_t s_init[] = { 0x1B, 0x40 };
+static const uint8_t s_bold_on[] = { 0x1B, 0x45, 0x01 };
+static const uint8_t s_bold_off[] = { 0x1B, 0x45, 0x00 };
+static const uint8_t s_inverse_on[] = { 0x1D, 0x42, 0x01 };
+static const uint8_t s_inverse_off[] = { 0x1D, 0x42, 0x00 };
+static const uint8_t s_cut_partial[] = { 0x1D, 0x56, 0x41, 0x03 };
+static const uint8_t s_cut_full[] = { 0x1D, 0x56, 0x41, 0x00 };
+static const uint8_t s_qr_model2[] = { 0x1D, 0x28, 0x6B, 0x04, 0x00, 0x31, 0x41, 0x32, 0x00 };
+static const uint8_t s_qr_print[] = { 0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x51, 0x30 };
+
+#define ESCPOS_QR_MAX_DATA        7089
+
+// ============================================
+// DESTINO
+// ============================================
+
+void escpos_begin_buffer(escpos_t *b, uint8_t *buf, size_t cap)
+{
+    memset(b, 0, sizeof(*b));
+    b->buf = buf;
+    b->cap = buf ? cap : 0;
+}
+
+void escpos_begin_job(escpos_t *b, printer_job_t *job)
+{
+    memset(b, 0, sizeof(*b));
+    b->job = job;
+    if (!job) {
+        b->error = ESP_ERR_INVALID_ARG;
+    }
+}
+
+esp_err_t escpos_raw(escpos_t *b, const void *data, size_t length)
+{
+    if (b->error != ESP_OK) {
+        // En modo buffer se sigue contando para informar el tamaño necesario
+        if (b->error == ESP_ERR_INVALID_SIZE) {
+            b->len += length;
+        }
+        return b->error;
+    }
+
+    if (b->job) {
+        b->error = printer_job_write(b->job, data, length);
+    } else if (length > b->cap - b->len) {
+        b->error = ESP_ERR_INVALID_SIZE;
+    } else {
+        memcpy(b->buf + b->len, data, length);
+    }
+
+    if (b->error == ESP_OK || b->error == ESP_ERR_INVALID_SIZE) {
+        b->len += length;
+    }
+    return b->error;
+}
+
+// ============================================
+// TEXTO
+// ============================================
+
+esp_err_t escpos_text(escpos_t *b, const char *text)
+{
+    return escpos_raw(b, text, strlen(text));
+}
+
+esp_err_t escpos_uint(escpos_t *b, uint32_t value)
+{
+    char digits[10];
+    int n = sizeof(digits);
+
+    do {
+        digits[--n] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    return escpos_raw(b, digits + n, sizeof(digits) - n);
+}
+
+// ============================================
+// FORMATO
+// ============================================
+
+esp_err_t escpos_init(escpos_t *b)
+{
+    return escpos_raw(b, s_init, sizeof(s_init));
+}
+
+esp_err_t escpos_align(escpos_t *b, escpos_align_t align)
+{
+    const uint8_t cmd[] = { 0x1B, 0x61, (uint8_t)align };
+    return escpos_raw(b, cmd, sizeof(cmd));
+}
+
+esp_err_t escpos_bold(escpos_t *b, bool on)
+{
+    return on ? escpos_raw(b, s_bold_on, sizeof(s_bold_on))
+              : escpos_raw(b, s_bold_off, sizeof(s_bold_off));
+}
+
+esp_err_t escpos_underline(escpos_t *b, uint8_t dots)
+{
+    const uint8_t cmd[] = { 0x1B, 0x2D, dots > 2 ? 2 : dots };
+    return escpos_raw(b, cmd, sizeof(cmd));
+}
+
+esp_err_t escpos_inverse(escpos_t *b, bool on)
+{
+    return on ? escpos_raw(b, s_inverse_on, sizeof(s_inverse_on))
+              : escpos_raw(b, s_inverse_off, sizeof(s_inverse_off));
+}
+
+esp_err_t escpos_size(escpos_t *b, uint8_t width, uint8_t height)
+{
+    width = width < 1 ? 1 : (width > 8 ? 8 : width);
+    height = height < 1 ? 1 : (height > 8 ? 8 : height);
+
+    const uint8_t cmd[] = { 0x1D, 0x21, (uint8_t)(((width - 1) << 4) | (height - 1)) };
+    return escpos_raw(b, cmd, sizeof(cmd));
+}
+
+esp_err_t escpos_feed(escpos_t *b, uint8_t lines)
+{
+    const uint8_t cmd[] = { 0x1B, 0x64, lines };
+    return escpos_raw(b, cmd, sizeof(cmd));
+}
+
+esp_err_t escpos_cut(escpos_t *b, bool partial)
+{
+    return partial ? escpos_raw(b, s_cut_partial, sizeof(s_cut_partial))
+                   : escpos_raw(b, s_cut_full, sizeof(s_cut_full));
+}
+
+// ============================================
+// CÓDIGOS
+// ============================================
+
+esp_err_t escpos_barcode(escpos_t *b, escpos_barcode_t type, const char *data, size_t length,
+                         uint8_t height, bool hri_below)
+{
+    if (!data || length == 0 || length > 255) {
+        if (b->error == ESP_OK) {
+            b->error = ESP_ERR_INVALID_ARG;
+        }
+        return b->error;
+    }
+
+    const uint8_t setup[] = {
+        0x1D, 0x68, height,                     // GS h: alto
+        0x1D, 0x48, hri_below ? 0x02 : 0x00,    // GS H: texto legible
+        0x1D, 0x6B, (uint8_t)type, (uint8_t)length, // GS k m n
+    };
+    escpos_raw(b, setup, sizeof(setup));
+    return escpos_raw(b, data, length);
+}
+
+esp_err_t escpos_qr(escpos_t *b, const char *data, size_t length, uint8_t module,
+                    escpos_qr_ecc_t ecc)
+{
+    if (!data || length == 0 || length > ESCPOS_QR_MAX_DATA) {
+        if (b->error == ESP_OK) {
+            b->error = ESP_ERR_INVALID_ARG;
+        }
+        return b->error;
+    }
+    module = module < 1 ? 1 : (module > 16 ? 16 : module);
+
+    // GS ( k: modelo, tamaño de módulo, corrección, guardar datos, imprimir
+    size_t store = length + 3;
+    const uint8_t setup[] = {
+        0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x43, module,
+        0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x45, (uint8_t)ecc,
+        0x1D, 0x28, 0x6B, store & 0xFF, store >> 8, 0x31, 0x50, 0x30,
+    };
+    escpos_raw(b, s_qr_model2, sizeof(s_qr_model2));
+    escpos_raw(b, setup, sizeof(setup));
+    escpos_raw(b, data, length);
+    return escpos_raw(b, s_qr_print, sizeof(s_qr_print));
+}
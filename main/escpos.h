@@ -0,0 +1,171 @@
+/**
+ * @file escpos.h
+ * @brief Typed ESC/POS command builder
+ *
+ * Emits ESC/POS commands straight into a caller buffer or into an open print
+ * job, without format strings or heap allocations. Fixed command sequences
+ * are constant byte blobs. The builder always counts the exact number of
+ * bytes emitted, even past the end of a buffer, so callers can detect and
+ * size overflows instead of printing a truncated ticket.
+ *
+ * Errors are sticky: once a command fails, the following ones are ignored
+ * and every call returns the first error.
+ *
+ * @code
+ * escpos_t b;
+ * uint8_t buf[256];
+ * escpos_begin_buffer(&b, buf, sizeof(buf));
+ * escpos_align(&b, ESCPOS_ALIGN_CENTER);
+ * escpos_text(&b, "Hello\n");
+ * escpos_feed(&b, 3);
+ * escpos_cut(&b, true);
+ * if (escpos_error(&b) == ESP_OK) {
+ *     printer_send_raw(buf, escpos_length(&b));
+ * }
+ * @endcode
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "printer_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Builder state
+ *
+ * Fill with escpos_begin_buffer() or escpos_begin_job(); do not touch the
+ * fields directly.
+ */
+typedef struct {
+    printer_job_t *job;     ///< Streaming destination (NULL in buffer mode)
+    uint8_t *buf;           ///< Buffer destination
+    size_t cap;             ///< Buffer capacity
+    size_t len;             ///< Bytes emitted, including those that did not fit
+    esp_err_t error;        ///< First error
+} escpos_t;
+
+typedef enum {
+    ESCPOS_ALIGN_LEFT = 0,
+    ESCPOS_ALIGN_CENTER = 1,
+    ESCPOS_ALIGN_RIGHT = 2,
+} escpos_align_t;
+
+/**
+ * @brief Barcode symbologies (GS k, function B)
+ */
+typedef enum {
+    ESCPOS_BARCODE_UPC_A = 65,
+    ESCPOS_BARCODE_EAN13 = 67,
+    ESCPOS_BARCODE_EAN8 = 68,
+    ESCPOS_BARCODE_CODE39 = 69,
+    ESCPOS_BARCODE_ITF = 70,
+    ESCPOS_BARCODE_CODE128 = 73,    ///< Data must start with a code set, e.g. "{B"
+} escpos_barcode_t;
+
+/**
+ * @brief QR error correction levels
+ */
+typedef enum {
+    ESCPOS_QR_ECC_L = 48,
+    ESCPOS_QR_ECC_M = 49,
+    ESCPOS_QR_ECC_Q = 50,
+    ESCPOS_QR_ECC_H = 51,
+} escpos_qr_ecc_t;
+
+/**
+ * @brief Build into a caller buffer
+ *
+ * Commands that do not fit set ESP_ERR_INVALID_SIZE, but escpos_length()
+ * keeps counting, so it returns the size the buffer needed.
+ */
+void escpos_begin_buffer(escpos_t *b, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Build into an open print job
+ *
+ * Bytes go directly into the driver's chunk buffers and stream to the
+ * printer as chunks fill, so there is no size limit.
+ */
+void escpos_begin_job(escpos_t *b, printer_job_t *job);
+
+/**
+ * @brief Exact number of bytes emitted so far
+ */
+static inline size_t escpos_length(const escpos_t *b)
+{
+    return b->len;
+}
+
+/**
+ * @brief First error, ESP_OK if every command was emitted
+ */
+static inline esp_err_t escpos_error(const escpos_t *b)
+{
+    return b->error;
+}
+
+/**
+ * @brief Emit raw bytes
+ */
+esp_err_t escpos_raw(escpos_t *b, const void *data, size_t length);
+
+/**
+ * @brief Emit a NUL-terminated string as is
+ */
+esp_err_t escpos_text(escpos_t *b, const char *text);
+
+/**
+ * @brief Emit an unsigned number in decimal
+ */
+esp_err_t escpos_uint(escpos_t *b, uint32_t value);
+
+esp_err_t escpos_init(escpos_t *b);                         ///< ESC @
+esp_err_t escpos_align(escpos_t *b, escpos_align_t align);  ///< ESC a n
+esp_err_t escpos_bold(escpos_t *b, bool on);                ///< ESC E n
+esp_err_t escpos_underline(escpos_t *b, uint8_t dots);      ///< ESC - n (0, 1 or 2)
+esp_err_t escpos_inverse(escpos_t *b, bool on);             ///< GS B n
+
+/**
+ * @brief Character size multiplier (GS ! n)
+ *
+ * @param width 1..8
+ * @param height 1..8
+ */
+esp_err_t escpos_size(escpos_t *b, uint8_t width, uint8_t height);
+
+esp_err_t escpos_feed(escpos_t *b, uint8_t lines);          ///< ESC d n
+esp_err_t escpos_cut(escpos_t *b, bool partial);            ///< GS V 65 n
+
+/**
+ * @brief Print a barcode
+ *
+ * @param type Symbology
+ * @param data Barcode content (1..255 bytes)
+ * @param length Length of data
+ * @param height Bar height in dots (GS h)
+ * @param hri_below Print the human readable text below (GS H)
+ */
+esp_err_t escpos_barcode(escpos_t *b, escpos_barcode_t type, const char *data, size_t length,
+                         uint8_t height, bool hri_below);
+
+/**
+ * @brief Print a QR code (model 2)
+ *
+ * @param data QR content (1..7089 bytes)
+ * @param length Length of data
+ * @param module Module size in dots (1..16)
+ * @param ecc Error correction level
+ */
+esp_err_t escpos_qr(escpos_t *b, const char *data, size_t length, uint8_t module,
+                    escpos_qr_ecc_t ecc);
+
+#ifdef __cplusplus
+}
+#endif
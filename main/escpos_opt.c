@@ -0,0 +1,494 @@
+#include "escpos_opt.h"
+#include <string.h>
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define ESC                       0x1B
+#define GS                        0x1D
+#define FS                        0x1C
+#define DLE                       0x10
+#define LF                        0x0A
+
+#define MODE_UNKNOWN              0xFF
+#define FEED_LF_MAX               3     // Hasta acá LF sueltos ocupan lo mismo o menos que ESC d n
+
+// Estados del parser
+enum {
+    PARSE_TEXT = 0,     // Texto o inicio de comando
+    PARSE_CMD,          // Juntando la cabecera de un comando en cmd[]
+    PARSE_PAYLOAD,      // Pasando datos binarios de un comando (payload bytes)
+    PARSE_NUL,          // Pasando datos hasta un 0x00 (GS k, función A)
+};
+
+// ============================================
+// SALIDA
+// ============================================
+
+static void out_flush(escpos_opt_t *o)
+{
+    if (o->out_len == 0) {
+        return;
+    }
+    if (o->error == ESP_OK) {
+        o->error = o->sink(o->ctx, o->out, o->out_len);
+        o->bytes_out += o->out_len;
+    }
+    o->out_len = 0;
+}
+
+static void out_bytes(escpos_opt_t *o, const uint8_t *data, size_t length)
+{
+    // Tramos largos (imágenes) van directo al destino
+    if (length > sizeof(o->out)) {
+        out_flush(o);
+        if (o->error == ESP_OK) {
+            o->error = o->sink(o->ctx, data, length);
+            o->bytes_out += length;
+        }
+        return;
+    }
+    if (o->out_len + length > sizeof(o->out)) {
+        out_flush(o);
+    }
+    memcpy(o->out + o->out_len, data, length);
+    o->out_len += length;
+}
+
+static void out_cmd(escpos_opt_t *o, uint8_t prefix, uint8_t cmd, uint8_t n)
+{
+    const uint8_t bytes[] = { prefix, cmd, n };
+    out_bytes(o, bytes, sizeof(bytes));
+}
+
+// ============================================
+// ESTADO PENDIENTE
+// ============================================
+// Los cambios de modo se guardan en want y se emiten recién antes del
+// próximo byte que dependa de ellos; así un modo que se activa y desactiva
+// sin nada en el medio no llega nunca a la impresora. Espacios y avances
+// pendientes se emiten siempre en el orden en que llegaron.
+
+static bool mode_dirty(uint8_t want, uint8_t sent)
+{
+    return want != MODE_UNKNOWN && want != sent;
+}
+
+static bool modes_dirty(const escpos_opt_t *o)
+{
+    return mode_dirty(o->want.codepage, o->sent.codepage) ||
+           mode_dirty(o->want.align, o->sent.align) ||
+           mode_dirty(o->want.bold, o->sent.bold) ||
+           mode_dirty(o->want.underline, o->sent.underline) ||
+           mode_dirty(o->want.inverse, o->sent.inverse) ||
+           mode_dirty(o->want.size, o->sent.size);
+}
+
+static void flush_modes(escpos_opt_t *o)
+{
+    if (mode_dirty(o->want.codepage, o->sent.codepage)) {
+        out_cmd(o, ESC, 't', o->want.codepage);
+    }
+    if (mode_dirty(o->want.align, o->sent.align)) {
+        out_cmd(o, ESC, 'a', o->want.align);
+    }
+    if (mode_dirty(o->want.bold, o->sent.bold)) {
+        out_cmd(o, ESC, 'E', o->want.bold);
+    }
+    if (mode_dirty(o->want.underline, o->sent.underline)) {
+        out_cmd(o, ESC, '-', o->want.underline);
+    }
+    if (mode_dirty(o->want.inverse, o->sent.inverse)) {
+        out_cmd(o, GS, 'B', o->want.inverse);
+    }
+    if (mode_dirty(o->want.size, o->sent.size)) {
+        out_cmd(o, GS, '!', o->want.size);
+    }
+    o->want = o->sent = (escpos_opt_modes_t) {
+        .codepage = o->want.codepage != MODE_UNKNOWN ? o->want.codepage : o->sent.codepage,
+        .align = o->want.align != MODE_UNKNOWN ? o->want.align : o->sent.align,
+        .bold = o->want.bold != MODE_UNKNOWN ? o->want.bold : o->sent.bold,
+        .underline = o->want.underline != MODE_UNKNOWN ? o->want.underline : o->sent.underline,
+        .inverse = o->want.inverse != MODE_UNKNOWN ? o->want.inverse : o->sent.inverse,
+        .size = o->want.size != MODE_UNKNOWN ? o->want.size : o->sent.size,
+    };
+}
+
+static void flush_feeds(escpos_opt_t *o)
+{
+    while (o->feeds > FEED_LF_MAX) {
+        uint8_t n = o->feeds > 255 ? 255 : o->feeds;
+        out_cmd(o, ESC, 'd', n);
+        o->feeds -= n;
+    }
+    while (o->feeds > 0) {
+        const uint8_t lf = LF;
+        out_bytes(o, &lf, 1);
+        o->feeds--;
+    }
+}
+
+static void flush_spaces(escpos_opt_t *o)
+{
+    static const uint8_t blanks[16] = "                ";
+
+    while (o->spaces > 0) {
+        uint16_t n = o->spaces > sizeof(blanks) ? sizeof(blanks) : o->spaces;
+        out_bytes(o, blanks, n);
+        o->spaces -= n;
+    }
+}
+
+// Todo lo pendiente, en orden (los espacios siempre llegaron después de
+// los avances): antes de un comando que no se optimiza
+static void flush_all(escpos_opt_t *o)
+{
+    flush_feeds(o);
+    flush_spaces(o);
+    flush_modes(o);
+}
+
+// Fin de línea: los espacios finales no se ven si la línea está alineada a
+// la izquierda y no tiene subrayado ni inverso
+static void end_line(escpos_opt_t *o)
+{
+    if (o->spaces == 0) {
+        return;
+    }
+    if (o->sent.align == 0 && o->sent.underline == 0 && o->sent.inverse == 0) {
+        o->spaces = 0;
+    } else {
+        flush_feeds(o);
+        flush_spaces(o);
+    }
+}
+
+static void add_feed(escpos_opt_t *o, uint8_t lines)
+{
+    end_line(o);
+    if (modes_dirty(o)) {
+        flush_feeds(o);
+        flush_modes(o);
+    }
+    if (o->feeds > 0xFFFF - lines) {
+        flush_feeds(o);
+    }
+    o->feeds += lines;
+}
+
+static void add_space(escpos_opt_t *o)
+{
+    if (modes_dirty(o)) {
+        flush_all(o);
+    }
+    if (o->spaces == 0xFFFF) {
+        flush_feeds(o);
+        flush_spaces(o);
+    }
+    o->spaces++;
+}
+
+static void add_text(escpos_opt_t *o, const uint8_t *text, size_t length)
+{
+    flush_all(o);
+    out_bytes(o, text, length);
+}
+
+// ============================================
+// COMANDOS
+// ============================================
+
+// Largo total de la cabecera del comando en cmd[], 0 si todavía faltan
+// bytes para saberlo, -1 si es un comando desconocido
+static int header_length(const uint8_t *c, size_t n)
+{
+    if (n < 2) {
+        return 0;
+    }
+
+    switch (c[0]) {
+    case ESC:
+        switch (c[1]) {
+        case '@': case '2': case '<':
+            return 2;
+        case 'a': case 'E': case '-': case 't': case 'd': case '!': case 'J': case 'e':
+        case '3': case 'M': case 'G': case '{': case 'V': case 'R': case ' ': case 'U':
+        case 'r': case '=':
+            return 3;
+        case '$': case '\\': case 'c':
+            return 4;
+        case '*': case 'p':
+            return 5;
+        }
+        return -1;
+
+    case GS:
+        switch (c[1]) {
+        case '!': case 'B': case 'h': case 'w': case 'H': case 'f': case 'a': case 'r':
+        case 'I': case '/':
+            return 3;
+        case 'L': case 'W': case 'P': case '*':
+            return 4;
+        case '(':
+            return 5;
+        }
+        if (n < 3) {
+            return 0;
+        }
+        switch (c[1]) {
+        case 'V':
+            switch (c[2]) {
+            case 0: case 1: case 48: case 49:
+                return 3;
+            case 65: case 66: case 97: case 98: case 103: case 104:
+                return 4;
+            }
+            return -1;
+        case 'v':
+            return c[2] == '0' ? 8 : -1;
+        case 'k':
+            if (c[2] <= 6) {
+                return 3;
+            }
+            return c[2] >= 65 && c[2] <= 79 ? 4 : -1;
+        }
+        return -1;
+
+    case FS:
+        return c[1] == '.' || c[1] == '&' ? 2 : -1;
+
+    case DLE:
+        if (c[1] == 0x04 || c[1] == 0x05) {
+            return 3;
+        }
+        return c[1] == 0x14 ? 5 : -1;
+    }
+    return -1;
+}
+
+// Datos binarios que siguen a una cabecera completa
+static uint32_t payload_length(const uint8_t *c)
+{
+    if (c[0] == ESC && c[1] == '*') {
+        return (c[3] | (c[4] << 8)) * (c[2] < 2 ? 1 : 3);
+    }
+    if (c[0] == GS) {
+        switch (c[1]) {
+        case '*':
+            return c[2] * c[3] * 8;
+        case 'v':
+            return (uint32_t)(c[4] | (c[5] << 8)) * (c[6] | (c[7] << 8));
+        case '(':
+            return c[3] | (c[4] << 8);
+        case 'k':
+            return c[2] >= 65 ? c[3] : 0;
+        }
+    }
+    return 0;
+}
+
+// Valor de ESC a / ESC - (acepta 0..2 y '0'..'2'), MODE_UNKNOWN si no aplica
+static uint8_t small_mode(uint8_t n)
+{
+    if (n >= '0') {
+        n -= '0';
+    }
+    return n <= 2 ? n : MODE_UNKNOWN;
+}
+
+static void on_command(escpos_opt_t *o)
+{
+    const uint8_t *c = o->cmd;
+    uint8_t n = c[2];
+
+    if (c[0] == ESC) {
+        switch (c[1]) {
+        case '@':
+            // ESC @ borra el buffer de línea (los espacios pendientes ya no
+            // importan) y vuelve todo a su valor inicial
+            o->spaces = 0;
+            flush_feeds(o);
+            out_bytes(o, c, 2);
+            o->want = o->sent = (escpos_opt_modes_t) {
+                .codepage = MODE_UNKNOWN,
+            };
+            return;
+        case 'a':
+            if (small_mode(n) != MODE_UNKNOWN) {
+                o->want.align = small_mode(n);
+                return;
+            }
+            break;
+        case 'E':
+            o->want.bold = n & 1;
+            return;
+        case '-':
+            if (small_mode(n) != MODE_UNKNOWN) {
+                o->want.underline = small_mode(n);
+                return;
+            }
+            break;
+        case 't':
+            o->want.codepage = n;
+            return;
+        case 'd':
+            // ESC d 0 imprime sin avanzar: no es un avance
+            if (n > 0) {
+                add_feed(o, n);
+                return;
+            }
+            break;
+        case '!':
+            // Toca negrita, subrayado y tamaño a la vez: dejan de conocerse
+            flush_all(o);
+            out_bytes(o, c, 3);
+            o->want.bold = o->sent.bold = MODE_UNKNOWN;
+            o->want.underline = o->sent.underline = MODE_UNKNOWN;
+            o->want.size = o->sent.size = MODE_UNKNOWN;
+            return;
+        }
+    } else if (c[0] == GS) {
+        switch (c[1]) {
+        case '!':
+            o->want.size = n;
+            return;
+        case 'B':
+            o->want.inverse = n & 1;
+            return;
+        }
+    }
+
+    // Cualquier otro comando conocido pasa tal cual, con todo lo pendiente antes
+    flush_all(o);
+    out_bytes(o, c, o->cmd_len);
+}
+
+static void start_passthrough(escpos_opt_t *o)
+{
+    flush_all(o);
+    out_bytes(o, o->cmd, o->cmd_len);
+    out_flush(o);
+    o->cmd_len = 0;
+    o->passthrough = true;
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+void escpos_opt_init(escpos_opt_t *o, escpos_opt_sink_t sink, void *ctx)
+{
+    memset(o, 0, sizeof(*o));
+    o->sink = sink;
+    o->ctx = ctx;
+    memset(&o->want, MODE_UNKNOWN, sizeof(o->want));
+    memset(&o->sent, MODE_UNKNOWN, sizeof(o->sent));
+}
+
+esp_err_t escpos_opt_write(escpos_opt_t *o, const uint8_t *data, size_t length)
+{
+    const uint8_t *end = data + length;
+
+    o->bytes_in += length;
+
+    while (data < end && o->error == ESP_OK) {
+        if (o->passthrough) {
+            out_flush(o);
+            if (o->error == ESP_OK) {
+                o->error = o->sink(o->ctx, data, end - data);
+                o->bytes_out += end - data;
+            }
+            break;
+        }
+
+        switch (o->parse) {
+        case PARSE_PAYLOAD: {
+            size_t n = end - data;
+            if (n > o->payload) {
+                n = o->payload;
+            }
+            out_bytes(o, data, n);
+            data += n;
+            o->payload -= n;
+            if (o->payload == 0) {
+                o->parse = PARSE_TEXT;
+            }
+            break;
+        }
+
+        case PARSE_NUL: {
+            const uint8_t *nul = memchr(data, 0, end - data);
+            const uint8_t *stop = nul ? nul + 1 : end;
+            out_bytes(o, data, stop - data);
+            data = stop;
+            if (nul) {
+                o->parse = PARSE_TEXT;
+            }
+            break;
+        }
+
+        case PARSE_CMD: {
+            o->cmd[o->cmd_len++] = *data++;
+            int header = header_length(o->cmd, o->cmd_len);
+            if (header < 0 || header > (int)sizeof(o->cmd)) {
+                start_passthrough(o);
+                break;
+            }
+            if (header == 0 || o->cmd_len < header) {
+                break;
+            }
+            o->parse = PARSE_TEXT;
+            on_command(o);
+            o->payload = payload_length(o->cmd);
+            if (o->payload > 0) {
+                o->parse = PARSE_PAYLOAD;
+            } else if (o->cmd[0] == GS && o->cmd[1] == 'k' && o->cmd[2] <= 6) {
+                o->parse = PARSE_NUL;
+            }
+            o->cmd_len = 0;
+            break;
+        }
+
+        default: {
+            uint8_t c = *data;
+            if (c > ' ') {
+                // Tramo de texto imprimible de una sola vez
+                const uint8_t *run = data;
+                while (data < end && *data > ' ') {
+                    data++;
+                }
+                add_text(o, run, data - run);
+            } else if (c == ' ') {
+                add_space(o);
+                data++;
+            } else if (c == LF) {
+                add_feed(o, 1);
+                data++;
+            } else if (c == ESC || c == GS || c == FS || c == DLE) {
+                o->cmd[0] = c;
+                o->cmd_len = 1;
+                o->parse = PARSE_CMD;
+                data++;
+            } else {
+                // CR, HT y demás controles de un byte
+                add_text(o, data, 1);
+                data++;
+            }
+            break;
+        }
+        }
+    }
+
+    return o->error;
+}
+
+esp_err_t escpos_opt_finish(escpos_opt_t *o)
+{
+    if (o->parse == PARSE_CMD) {
+        start_passthrough(o);
+    }
+    end_line(o);
+    flush_all(o);
+    out_flush(o);
+    return o->error;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file escpos_opt.h
+ * @brief Streaming peephole optimizer for ESC/POS byte streams
+ *
+ * Sits between a job producer and the USB pipeline. It tracks the printer
+ * state (alignment, emphasis, underline, reverse, character size and code
+ * page) across the whole job and applies mode changes lazily, right before
+ * the next printable byte, so redundant or cancelled switches never reach
+ * the printer. Consecutive line feeds and ESC d feeds are merged, and
+ * trailing spaces of left-aligned, unmarked lines are dropped.
+ *
+ * The parser knows the length of every command it handles, including the
+ * payload of raster images, barcodes and 2D codes. On a command it does not
+ * know it stops optimizing and passes the rest of the job through verbatim,
+ * so unknown streams are never corrupted.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESCPOS_OPT_OUT_SIZE 64      ///< Output staging buffer
+
+/**
+ * @brief Destination of the optimized stream
+ *
+ * @param ctx User context given to escpos_opt_init()
+ * @param data Bytes to append
+ * @param length Number of bytes
+ * @return ESP_OK or an error, which makes the optimizer stop
+ */
+typedef esp_err_t (*escpos_opt_sink_t)(void *ctx, const uint8_t *data, size_t length);
+
+/**
+ * @brief Tracked printer modes; 0xFF means unknown
+ */
+typedef struct {
+    uint8_t align;
+    uint8_t bold;
+    uint8_t underline;
+    uint8_t inverse;
+    uint8_t size;
+    uint8_t codepage;
+} escpos_opt_modes_t;
+
+/**
+ * @brief Optimizer state
+ *
+ * Fill with escpos_opt_init(); do not touch the fields directly.
+ */
+typedef struct {
+    escpos_opt_sink_t sink;
+    void *ctx;
+    escpos_opt_modes_t want;        ///< Modes requested by the stream
+    escpos_opt_modes_t sent;        ///< Modes the printer is in
+    uint8_t cmd[8];                 ///< Command being parsed
+    uint8_t cmd_len;
+    uint8_t out[ESCPOS_OPT_OUT_SIZE];
+    uint8_t out_len;
+    uint8_t parse;                  ///< Parser state
+    uint32_t payload;               ///< Payload bytes left to pass through
+    uint16_t spaces;                ///< Pending spaces
+    uint16_t feeds;                 ///< Pending line feeds
+    bool passthrough;               ///< Unknown command seen: no more optimizing
+    uint32_t bytes_in;              ///< Bytes received
+    uint32_t bytes_out;             ///< Bytes passed to the sink
+    esp_err_t error;                ///< First sink error
+} escpos_opt_t;
+
+/**
+ * @brief Start optimizing a new stream
+ *
+ * All modes start as unknown, so the first switch of each is always kept.
+ */
+void escpos_opt_init(escpos_opt_t *o, escpos_opt_sink_t sink, void *ctx);
+
+/**
+ * @brief Feed stream bytes
+ *
+ * Commands may be split across calls.
+ *
+ * @return The first sink error, or ESP_OK
+ */
+esp_err_t escpos_opt_write(escpos_opt_t *o, const uint8_t *data, size_t length);
+
+/**
+ * @brief End the stream
+ *
+ * Emits pending feeds and mode changes and the bytes of an incomplete
+ * command. Trailing spaces at the very end are treated like those before a
+ * line feed.
+ *
+ * @return The first sink error, or ESP_OK
+ */
+esp_err_t escpos_opt_finish(escpos_opt_t *o);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,484 @@
+#include "form_parser.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define FORM_RECV_BUF_SIZE        256
+#define FORM_RECV_RETRIES         5
+#define FORM_CONTENT_TYPE_MAX     128
+
+// Estados del parser
+enum {
+    // x-www-form-urlencoded
+    UE_NAME = 0,
+    UE_VALUE,
+    UE_PCT1,            // Después de '%'
+    UE_PCT2,            // Después de '%' y un dígito
+    // multipart/form-data
+    MP_PREAMBLE,        // Antes del primer delimitador
+    MP_AFTER_DELIM,     // Después de un delimitador: CRLF o "--"
+    MP_AFTER_DASH,
+    MP_AFTER_CR,
+    MP_HEADER,          // Línea de cabecera de una parte
+    MP_HEADER_CR,
+    MP_BODY,            // Datos de una parte
+    MP_DONE,            // Después del delimitador final (epílogo)
+};
+
+// ============================================
+// CAMPOS
+// ============================================
+
+static void emit(form_parser_t *p, const uint8_t *data, size_t length)
+{
+    if (length > 0 && p->error == ESP_OK) {
+        p->error = p->cb(p->ctx, p->name, data, length, false);
+    }
+}
+
+static void end_field(form_parser_t *p)
+{
+    if (p->error == ESP_OK) {
+        p->error = p->cb(p->ctx, p->name, NULL, 0, true);
+    }
+    p->name[0] = '\0';
+    p->name_len = 0;
+    p->in_field = false;
+}
+
+static void name_put(form_parser_t *p, uint8_t c)
+{
+    if (p->name_len < FORM_NAME_MAX) {
+        p->name[p->name_len++] = c;
+        p->name[p->name_len] = '\0';
+    }
+}
+
+// Valores url-encoded: se decodifican a un buffer chico y salen por tramos
+static void out_flush(form_parser_t *p)
+{
+    emit(p, p->out, p->out_len);
+    p->out_len = 0;
+}
+
+static void out_put(form_parser_t *p, uint8_t c)
+{
+    if (p->out_len == sizeof(p->out)) {
+        out_flush(p);
+    }
+    p->out[p->out_len++] = c;
+}
+
+// Byte decodificado para el nombre o el valor, según dónde estaba el '%'
+static void decoded_put(form_parser_t *p, uint8_t c)
+{
+    if (p->ret_state == UE_NAME) {
+        name_put(p, c);
+    } else {
+        out_put(p, c);
+    }
+}
+
+static int hex_value(uint8_t c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = tolower(c);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// ============================================
+// CABECERAS MULTIPART
+// ============================================
+
+// Búsqueda sin distinguir mayúsculas (newlib no siempre trae strcasestr)
+static const char *find_nocase(const char *s, const char *needle)
+{
+    size_t n = strlen(needle);
+
+    for (; *s; s++) {
+        if (strncasecmp(s, needle, n) == 0) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// Copia el valor de un parámetro (entre comillas o hasta ';'). Devuelve el
+// largo completo del valor aunque no haya entrado entero en out.
+static size_t param_value(const char *v, char *out, size_t out_size)
+{
+    size_t len = 0;
+    char end = ';';
+
+    if (*v == '"') {
+        end = '"';
+        v++;
+    }
+    while (*v && *v != end && !(end == ';' && (*v == ' ' || *v == '\t'))) {
+        if (len + 1 < out_size) {
+            out[len] = *v;
+        }
+        len++;
+        v++;
+    }
+    out[len + 1 < out_size ? len : out_size - 1] = '\0';
+    return len;
+}
+
+// Solo interesa el nombre del campo de Content-Disposition
+static void parse_header_line(form_parser_t *p)
+{
+    p->line[p->line_len] = '\0';
+    if (strncasecmp(p->line, "content-disposition:", 20) != 0) {
+        return;
+    }
+
+    const char *s = p->line + 20;
+    while ((s = strchr(s, ';')) != NULL) {
+        s++;
+        while (*s == ' ' || *s == '\t') {
+            s++;
+        }
+        if (strncasecmp(s, "name=", 5) == 0) {
+            size_t len = param_value(s + 5, p->name, sizeof(p->name));
+            p->name_len = len < FORM_NAME_MAX ? len : FORM_NAME_MAX;
+            return;
+        }
+    }
+}
+
+// ============================================
+// MÁQUINAS DE ESTADO
+// ============================================
+
+static size_t feed_urlencoded(form_parser_t *p, const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+
+    while (i < length && p->error == ESP_OK) {
+        uint8_t c = data[i];
+
+        switch (p->state) {
+        case UE_NAME:
+            i++;
+            if (c == '=') {
+                p->in_field = true;
+                p->state = UE_VALUE;
+            } else if (c == '&') {
+                // Campo sin '=': valor vacío
+                if (p->name_len > 0) {
+                    end_field(p);
+                }
+            } else if (c == '%') {
+                p->ret_state = UE_NAME;
+                p->state = UE_PCT1;
+            } else {
+                name_put(p, c == '+' ? ' ' : c);
+            }
+            break;
+
+        case UE_VALUE:
+            i++;
+            if (c == '&') {
+                out_flush(p);
+                end_field(p);
+                p->state = UE_NAME;
+            } else if (c == '%') {
+                p->ret_state = UE_VALUE;
+                p->state = UE_PCT1;
+            } else {
+                out_put(p, c == '+' ? ' ' : c);
+            }
+            break;
+
+        case UE_PCT1:
+            if (hex_value(c) < 0) {
+                // Escape inválido: el '%' queda literal y c se procesa de nuevo
+                decoded_put(p, '%');
+                p->state = p->ret_state;
+                break;
+            }
+            p->hex = c;
+            p->state = UE_PCT2;
+            i++;
+            break;
+
+        case UE_PCT2:
+            if (hex_value(c) < 0) {
+                decoded_put(p, '%');
+                decoded_put(p, p->hex);
+                p->state = p->ret_state;
+                break;
+            }
+            decoded_put(p, (hex_value(p->hex) << 4) | hex_value(c));
+            p->state = p->ret_state;
+            i++;
+            break;
+        }
+    }
+    return i;
+}
+
+static size_t feed_multipart(form_parser_t *p, const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+
+    while (i < length && p->error == ESP_OK) {
+        uint8_t c = data[i];
+
+        switch (p->state) {
+        case MP_BODY:
+            if (p->match == 0) {
+                // Datos hasta el próximo '\r', el único byte que puede abrir
+                // el delimitador (el boundary no tiene CR ni LF)
+                const uint8_t *cr = memchr(data + i, '\r', length - i);
+                size_t n = cr ? (size_t)(cr - (data + i)) : length - i;
+                emit(p, data + i, n);
+                i += n;
+                if (cr) {
+                    p->match = 1;
+                    i++;
+                }
+                break;
+            }
+            if (c == (uint8_t)p->delim[p->match]) {
+                i++;
+                if (++p->match == p->delim_len) {
+                    p->match = 0;
+                    end_field(p);
+                    p->state = MP_AFTER_DELIM;
+                }
+                break;
+            }
+            // No era el delimitador: lo retenido eran datos. c se vuelve a
+            // mirar desde cero.
+            emit(p, (const uint8_t *)p->delim, p->match);
+            p->match = 0;
+            break;
+
+        case MP_PREAMBLE:
+            i++;
+            if (c == (uint8_t)p->delim[p->match]) {
+                if (++p->match == p->delim_len) {
+                    p->match = 0;
+                    p->state = MP_AFTER_DELIM;
+                }
+            } else {
+                p->match = (c == '\r') ? 1 : 0;
+            }
+            break;
+
+        case MP_AFTER_DELIM:
+            i++;
+            if (c == '-') {
+                p->state = MP_AFTER_DASH;
+            } else if (c == '\r') {
+                p->state = MP_AFTER_CR;
+            } else if (c != ' ' && c != '\t') {
+                p->error = ESP_ERR_INVALID_RESPONSE;
+            }
+            break;
+
+        case MP_AFTER_DASH:
+            i++;
+            if (c == '-') {
+                p->state = MP_DONE;
+            } else {
+                p->error = ESP_ERR_INVALID_RESPONSE;
+            }
+            break;
+
+        case MP_AFTER_CR:
+            i++;
+            if (c == '\n') {
+                p->line_len = 0;
+                p->state = MP_HEADER;
+            } else {
+                p->error = ESP_ERR_INVALID_RESPONSE;
+            }
+            break;
+
+        case MP_HEADER:
+            i++;
+            if (c == '\r') {
+                p->state = MP_HEADER_CR;
+            } else if (p->line_len < FORM_HEADER_MAX) {
+                p->line[p->line_len++] = c;
+            }
+            break;
+
+        case MP_HEADER_CR:
+            i++;
+            if (c != '\n') {
+                p->error = ESP_ERR_INVALID_RESPONSE;
+            } else if (p->line_len == 0) {
+                // Línea vacía: empiezan los datos de la parte
+                p->in_field = true;
+                p->state = MP_BODY;
+            } else {
+                parse_header_line(p);
+                p->line_len = 0;
+                p->state = MP_HEADER;
+            }
+            break;
+
+        case MP_DONE:
+        default:
+            // Epílogo: se ignora
+            i = length;
+            break;
+        }
+    }
+    return i;
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+esp_err_t form_parser_init(form_parser_t *p, const char *content_type,
+                           form_field_cb_t cb, void *ctx)
+{
+    if (!p || !content_type || !cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(p, 0, sizeof(*p));
+    p->cb = cb;
+    p->ctx = ctx;
+
+    if (strncasecmp(content_type, "application/x-www-form-urlencoded", 33) == 0) {
+        p->state = UE_NAME;
+        return ESP_OK;
+    }
+    if (strncasecmp(content_type, "multipart/form-data", 19) != 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const char *b = find_nocase(content_type, "boundary=");
+    if (!b) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(p->delim, "\r\n--", 4);
+    size_t len = param_value(b + 9, p->delim + 4, sizeof(p->delim) - 4);
+    if (len == 0 || len > FORM_BOUNDARY_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    p->multipart = true;
+    p->delim_len = 4 + len;
+    // El cuerpo arranca con "--boundary": como si ya hubiera llegado el CRLF
+    p->match = 2;
+    p->state = MP_PREAMBLE;
+    return ESP_OK;
+}
+
+esp_err_t form_parser_feed(form_parser_t *p, const uint8_t *data, size_t length)
+{
+    if (p->error == ESP_OK) {
+        if (p->multipart) {
+            feed_multipart(p, data, length);
+        } else {
+            feed_urlencoded(p, data, length);
+        }
+    }
+    return p->error;
+}
+
+esp_err_t form_parser_finish(form_parser_t *p)
+{
+    if (p->error != ESP_OK) {
+        return p->error;
+    }
+
+    if (p->multipart) {
+        if (p->state != MP_DONE) {
+            p->error = ESP_ERR_INVALID_RESPONSE;
+        }
+        return p->error;
+    }
+
+    // Escape cortado al final: queda literal
+    if (p->state == UE_PCT1 || p->state == UE_PCT2) {
+        decoded_put(p, '%');
+        if (p->state == UE_PCT2) {
+            decoded_put(p, p->hex);
+        }
+        p->state = p->ret_state;
+    }
+    if (p->state == UE_VALUE || p->name_len > 0) {
+        out_flush(p);
+        end_field(p);
+    }
+    p->state = UE_NAME;
+    return p->error;
+}
+
+esp_err_t form_parse_request(httpd_req_t *req, form_field_cb_t cb, void *ctx)
+{
+    char content_type[FORM_CONTENT_TYPE_MAX];
+    form_parser_t parser;
+
+    // Sin Content-Type se asume un formulario simple
+    size_t ct_len = httpd_req_get_hdr_value_len(req, "Content-Type");
+    if (ct_len == 0) {
+        strcpy(content_type, "application/x-www-form-urlencoded");
+    } else if (ct_len >= sizeof(content_type) ||
+               httpd_req_get_hdr_value_str(req, "Content-Type", content_type,
+                                           sizeof(content_type)) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = form_parser_init(&parser, content_type, cb, ctx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uint8_t buf[FORM_RECV_BUF_SIZE];
+    size_t remaining = req->content_len;
+    int retries = 0;
+    while (remaining > 0) {
+        int n = httpd_req_recv(req, (char *)buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++retries < FORM_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        retries = 0;
+        remaining -= n;
+        ret = form_parser_feed(&parser, buf, n);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return form_parser_finish(&parser);
+}
+
+esp_err_t form_text_cb(void *ctx, const char *name,
+                       const uint8_t *data, size_t length, bool done)
+{
+    form_text_t *t = ctx;
+
+    if (strcmp(name, t->name) != 0) {
+        return ESP_OK;
+    }
+    if (!t->found) {
+        // Un campo repetido cuenta la primera vez
+        if (done) {
+            t->found = true;
+        }
+        size_t n = t->len + length < t->size ? length : t->size - 1 - t->len;
+        if (n > 0) {
+            memcpy(t->buf + t->len, data, n);
+            t->len += n;
+        }
+        t->buf[t->len] = '\0';
+    }
+    return ESP_OK;
+}
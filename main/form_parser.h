@@ -0,0 +1,159 @@
+/**
+ * @file form_parser.h
+ * @brief Streaming parser for HTML form bodies
+ *
+ * Parses `multipart/form-data` and `application/x-www-form-urlencoded`
+ * request bodies one byte at a time, so a body can be fed in whatever
+ * pieces the socket delivers and is never buffered whole. Multipart parts
+ * are delimited with the real boundary from the Content-Type header and
+ * their data is passed to the callback without copying; url-encoded names
+ * and values are decoded on the fly.
+ *
+ * @code
+ * static esp_err_t on_field(void *ctx, const char *name,
+ *                           const uint8_t *data, size_t length, bool done)
+ * {
+ *     if (strcmp(name, "msg") == 0 && !done) {
+ *         // append data to the message
+ *     }
+ *     return ESP_OK;
+ * }
+ *
+ * esp_err_t ret = form_parse_request(req, on_field, &msg);
+ * @endcode
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORM_NAME_MAX      32      ///< Longest field name kept (longer ones are truncated)
+#define FORM_BOUNDARY_MAX  70      ///< Longest multipart boundary (RFC 2046)
+#define FORM_HEADER_MAX    160     ///< Longest part header line kept
+
+/**
+ * @brief Field data callback
+ *
+ * Called zero or more times with consecutive pieces of a field value, then
+ * once with done = true and no data when the field ends.
+ *
+ * @param ctx User context given to the parser
+ * @param name Field name (NUL-terminated, possibly truncated)
+ * @param data Next bytes of the value (NULL when done)
+ * @param length Number of bytes
+ * @param done The field is complete
+ * @return ESP_OK to continue; any error stops the parser and is returned
+ */
+typedef esp_err_t (*form_field_cb_t)(void *ctx, const char *name,
+                                     const uint8_t *data, size_t length, bool done);
+
+/**
+ * @brief Parser state
+ *
+ * Fill with form_parser_init(); do not touch the fields directly.
+ */
+typedef struct {
+    form_field_cb_t cb;
+    void *ctx;
+    bool multipart;
+    uint8_t state;
+    uint8_t ret_state;              ///< State to resume after a %XX escape
+    uint8_t hex;                    ///< First digit of a %XX escape
+    char delim[FORM_BOUNDARY_MAX + 5]; ///< "\r\n--" + boundary
+    uint8_t delim_len;
+    uint8_t match;                  ///< Delimiter bytes matched so far
+    char name[FORM_NAME_MAX + 1];
+    uint8_t name_len;
+    char line[FORM_HEADER_MAX + 1]; ///< Part header line being read
+    uint8_t line_len;
+    uint8_t out[32];                ///< Decoded url-encoded value bytes
+    uint8_t out_len;
+    bool in_field;                  ///< A field has started and not ended
+    esp_err_t error;                ///< First error
+} form_parser_t;
+
+/**
+ * @brief Prepare a parser for a body
+ *
+ * @param p Parser state
+ * @param content_type Value of the Content-Type header
+ * @param cb Field callback
+ * @param ctx User context for the callback
+ * @return esp_err_t
+ *         - ESP_OK: Ready
+ *         - ESP_ERR_NOT_SUPPORTED: Not a form content type
+ *         - ESP_ERR_INVALID_ARG: Multipart without a valid boundary
+ */
+esp_err_t form_parser_init(form_parser_t *p, const char *content_type,
+                           form_field_cb_t cb, void *ctx);
+
+/**
+ * @brief Feed the next bytes of the body
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_RESPONSE for a malformed body, or the
+ *         error returned by the callback (sticky)
+ */
+esp_err_t form_parser_feed(form_parser_t *p, const uint8_t *data, size_t length);
+
+/**
+ * @brief Signal the end of the body
+ *
+ * Ends the last url-encoded field.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_RESPONSE if a multipart body did not
+ *         reach its closing boundary, or the first error
+ */
+esp_err_t form_parser_finish(form_parser_t *p);
+
+/**
+ * @brief Receive and parse the whole body of a request
+ *
+ * Reads the Content-Type header, then the body in small pieces from the
+ * socket, feeding each piece to the parser.
+ *
+ * @param req HTTP request
+ * @param cb Field callback
+ * @param ctx User context for the callback
+ * @return esp_err_t
+ *         - ESP_OK: Body parsed
+ *         - ESP_ERR_NOT_SUPPORTED / ESP_ERR_INVALID_ARG: See form_parser_init()
+ *         - ESP_ERR_INVALID_RESPONSE: Malformed body
+ *         - ESP_FAIL: Connection error
+ *         - Any error returned by the callback
+ */
+esp_err_t form_parse_request(httpd_req_t *req, form_field_cb_t cb, void *ctx);
+
+/**
+ * @brief Collector for a single text field
+ *
+ * Use with form_text_cb() to copy one named field into a caller buffer.
+ * Longer values are truncated; the buffer is always NUL-terminated.
+ */
+typedef struct {
+    const char *name;   ///< Field to collect
+    char *buf;          ///< Destination
+    size_t size;        ///< Size of buf including the terminator
+    size_t len;         ///< Bytes stored
+    bool found;         ///< The field was present
+} form_text_t;
+
+#define FORM_TEXT_INIT(field, buffer, buffer_size) \
+    { .name = (field), .buf = (buffer), .size = (buffer_size), .len = 0, .found = false }
+
+/**
+ * @brief Field callback that fills a form_text_t given as ctx
+ */
+esp_err_t form_text_cb(void *ctx, const char *name,
+                       const uint8_t *data, size_t length, bool done);
+
+#ifdef __cplusplus
+}
+#endif
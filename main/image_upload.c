@@ -0,0 +1,343 @@
+#include "image_upload.h"
+#include "printer_driver.h"
+#include "raster.h"
+#include "escpos.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include "rom/tjpgd.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "IMAGE";
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define IMAGE_RECV_BUF_SIZE       512
+#define IMAGE_RECV_RETRIES        5
+#define IMAGE_TJPGD_POOL_SIZE     3100  // Área de trabajo que pide TJpgDec
+#define IMAGE_MCU_MAX_ROWS        16    // Alto máximo de una fila de MCU (4:2:0)
+#define IMAGE_MAX_STRIP_WIDTH     (2 * RASTER_MAX_WIDTH) // Ancho decodificado máximo tras reducir
+
+// Estado de una subida. Vive en el heap: los buffers son lo único que
+// crece con el ancho, nunca con el alto de la imagen.
+typedef struct {
+    httpd_req_t *req;
+    size_t remaining;           // Bytes del cuerpo sin leer
+    uint8_t buf[IMAGE_RECV_BUF_SIZE];
+    size_t buf_pos;
+    size_t buf_len;
+    uint16_t src_w;             // Tamaño que entrega TJpgDec tras reducir
+    uint16_t src_h;
+    uint16_t dst_w;             // Tamaño impreso en puntos
+    uint32_t dst_h;
+    uint32_t next_dy;           // Próxima fila impresa
+    uint8_t *strip;             // Fila de MCU en grises (IMAGE_MCU_MAX_ROWS x src_w)
+    uint8_t *row;               // Fila impresa (dst_w)
+    raster_t *raster;
+    esp_err_t error;
+} image_ctx_t;
+
+// ============================================
+// ENTRADA: CUERPO HTTP
+// ============================================
+
+static bool recv_fill(image_ctx_t *ctx)
+{
+    int retries = 0;
+
+    while (ctx->remaining > 0) {
+        size_t want = ctx->remaining < sizeof(ctx->buf) ? ctx->remaining : sizeof(ctx->buf);
+        int n = httpd_req_recv(ctx->req, (char *)ctx->buf, want);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++retries < IMAGE_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            ESP_LOGE(TAG, "❌ Error de recepción: %d", n);
+            ctx->remaining = 0;
+            return false;
+        }
+        ctx->remaining -= n;
+        ctx->buf_pos = 0;
+        ctx->buf_len = n;
+        return true;
+    }
+    return false;
+}
+
+// Entrada de TJpgDec: copia (o salta, si buf es NULL) hasta len bytes
+static UINT jpeg_input(JDEC *jd, BYTE *buf, UINT len)
+{
+    image_ctx_t *ctx = (image_ctx_t *)jd->device;
+    UINT done = 0;
+
+    while (done < len) {
+        if (ctx->buf_pos == ctx->buf_len && !recv_fill(ctx)) {
+            break;
+        }
+        size_t n = ctx->buf_len - ctx->buf_pos;
+        if (n > len - done) {
+            n = len - done;
+        }
+        if (buf) {
+            memcpy(buf + done, ctx->buf + ctx->buf_pos, n);
+        }
+        ctx->buf_pos += n;
+        done += n;
+    }
+    return done;
+}
+
+// ============================================
+// SALIDA: ESCALADO Y RASTER
+// ============================================
+
+// Imprime las filas de destino que caen en la fila de MCU recién completa.
+// Escalado por vecino más cercano con paso en punto fijo 16.16.
+static void emit_rows(image_ctx_t *ctx, uint16_t top, uint16_t bottom)
+{
+    uint32_t step = ((uint32_t)ctx->src_w << 16) / ctx->dst_w;
+
+    while (ctx->next_dy < ctx->dst_h && ctx->error == ESP_OK) {
+        uint32_t sy = (uint64_t)ctx->next_dy * ctx->src_h / ctx->dst_h;
+        if (sy > bottom) {
+            break;
+        }
+        if (sy >= top) {
+            const uint8_t *src = ctx->strip + (size_t)(sy - top) * ctx->src_w;
+            uint32_t sx = step / 2;
+            for (uint16_t dx = 0; dx < ctx->dst_w; dx++, sx += step) {
+                ctx->row[dx] = src[sx >> 16];
+            }
+            ctx->error = raster_write_rows(ctx->raster, ctx->row, ctx->dst_w, 1);
+        }
+        ctx->next_dy++;
+    }
+}
+
+// Salida de TJpgDec: un bloque MCU en RGB888
+static UINT jpeg_output(JDEC *jd, void *bitmap, JRECT *rect)
+{
+    image_ctx_t *ctx = (image_ctx_t *)jd->device;
+    const uint8_t *rgb = (const uint8_t *)bitmap;
+    uint16_t w = rect->right - rect->left + 1;
+    uint16_t h = rect->bottom - rect->top + 1;
+
+    if (ctx->error != ESP_OK) {
+        return 0;
+    }
+    if (h > IMAGE_MCU_MAX_ROWS) {
+        h = IMAGE_MCU_MAX_ROWS;
+    }
+
+    for (uint16_t y = 0; y < h; y++) {
+        uint8_t *dst = ctx->strip + (size_t)y * ctx->src_w;
+        for (uint16_t x = 0; x < w; x++, rgb += 3) {
+            if (rect->left + x < ctx->src_w) {
+                // Luma BT.601 en enteros
+                dst[rect->left + x] = (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8;
+            }
+        }
+    }
+
+    // El último MCU de la fila completa la franja
+    if (rect->right + 1 >= ctx->src_w) {
+        emit_rows(ctx, rect->top, rect->top + h - 1);
+    }
+    return ctx->error == ESP_OK;
+}
+
+// ============================================
+// HANDLER HTTP
+// ============================================
+
+static esp_err_t send_status(httpd_req_t *req, const char *status, const char *msg)
+{
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_sendstr(req, msg);
+}
+
+static raster_dither_t parse_options(httpd_req_t *req, uint16_t *width)
+{
+    raster_dither_t dither = RASTER_DITHER_FLOYD_STEINBERG;
+    char query[64];
+    char value[16];
+
+    *width = IMAGE_PRINT_WIDTH;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        return dither;
+    }
+    if (httpd_query_key_value(query, "dither", value, sizeof(value)) == ESP_OK) {
+        if (strcmp(value, "bayer") == 0) {
+            dither = RASTER_DITHER_BAYER;
+        } else if (strcmp(value, "threshold") == 0) {
+            dither = RASTER_DITHER_THRESHOLD;
+        }
+    }
+    if (httpd_query_key_value(query, "width", value, sizeof(value)) == ESP_OK) {
+        int w = atoi(value);
+        if (w > 0 && w <= RASTER_MAX_WIDTH) {
+            *width = w;
+        }
+    }
+    return dither;
+}
+
+// Decodifica e imprime mientras recibe; corre en web_worker (ver
+// web_defer()) porque dura lo que tarda la impresora
+static esp_err_t print_image_worker(httpd_req_t *req)
+{
+    image_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    void *pool = malloc(IMAGE_TJPGD_POOL_SIZE);
+    if (!ctx || !pool) {
+        free(ctx);
+        free(pool);
+        return send_status(req, "500 Internal Server Error", "Sin memoria");
+    }
+    ctx->req = req;
+    ctx->remaining = req->content_len;
+    raster_dither_t dither = parse_options(req, &ctx->dst_w);
+
+    esp_err_t ret = ESP_OK;
+    const char *status = NULL;
+    const char *msg = NULL;
+    printer_job_t *job = NULL;
+    JDEC jd;
+
+    // Solo JPEG baseline: es lo que decodifica TJpgDec en ROM
+    if (!recv_fill(ctx) || ctx->buf_len < 4) {
+        status = "400 Bad Request";
+        msg = "Imagen incompleta";
+        goto out;
+    }
+    if (ctx->buf[0] != 0xFF || ctx->buf[1] != 0xD8) {
+        status = "415 Unsupported Media Type";
+        msg = memcmp(ctx->buf, "\x89PNG", 4) == 0 ? "PNG no soportado, enviar JPEG" : "Se espera un JPEG";
+        goto out;
+    }
+    if (jd_prepare(&jd, jpeg_input, pool, IMAGE_TJPGD_POOL_SIZE, ctx) != JDR_OK) {
+        status = "415 Unsupported Media Type";
+        msg = "JPEG no soportado (¿progresivo?)";
+        goto out;
+    }
+
+    // Reducir en el decodificador (1/2, 1/4, 1/8) mientras siga quedando al
+    // menos el ancho impreso, y siempre lo necesario para acotar la franja
+    uint8_t scale = 0;
+    while (scale < 3 && ((jd.width >> (scale + 1)) >= ctx->dst_w ||
+                         ((jd.width + (1u << scale) - 1) >> scale) > IMAGE_MAX_STRIP_WIDTH)) {
+        scale++;
+    }
+    ctx->src_w = (jd.width + (1u << scale) - 1) >> scale;
+    ctx->src_h = (jd.height + (1u << scale) - 1) >> scale;
+    if (ctx->src_w > IMAGE_MAX_STRIP_WIDTH) {
+        status = "413 Payload Too Large";
+        msg = "Imagen demasiado ancha";
+        goto out;
+    }
+    ctx->dst_h = (uint32_t)ctx->src_h * ctx->dst_w / ctx->src_w;
+    if (ctx->dst_h == 0) {
+        ctx->dst_h = 1;
+    }
+
+    ctx->strip = malloc((size_t)IMAGE_MCU_MAX_ROWS * ctx->src_w);
+    ctx->row = malloc(ctx->dst_w);
+    if (!ctx->strip || !ctx->row) {
+        ret = ESP_ERR_NO_MEM;
+        goto out;
+    }
+
+    ESP_LOGI(TAG, "🖼️ JPEG %ux%u → %ux%lu puntos (escala 1/%d)",
+             jd.width, jd.height, ctx->dst_w, ctx->dst_h, 1 << scale);
+
+    ret = printer_job_open(&job);
+    if (ret != ESP_OK) {
+        goto out;
+    }
+    printer_job_set_class(job, PRINTER_PRIO_NORMAL, web_client_id(req));
+
+    escpos_t b;
+    escpos_begin_job(&b, job);
+    escpos_init(&b);
+    ret = escpos_align(&b, ESCPOS_ALIGN_CENTER);
+    if (ret == ESP_OK) {
+        ret = raster_begin(job, ctx->dst_w, dither, &ctx->raster);
+    }
+    if (ret == ESP_OK) {
+        JRESULT jres = jd_decomp(&jd, jpeg_output, scale);
+        ret = raster_end(ctx->raster);
+        ctx->raster = NULL;
+        if (ctx->error != ESP_OK) {
+            ret = ctx->error;
+        } else if (jres != JDR_OK && ret == ESP_OK) {
+            ESP_LOGE(TAG, "❌ Error decodificando JPEG: %d", jres);
+            ret = ESP_FAIL;
+        }
+    }
+    if (ret == ESP_OK) {
+        escpos_feed(&b, 3);
+        ret = escpos_cut(&b, true);
+    }
+
+    if (ret == ESP_OK) {
+        ret = printer_job_close(job);
+    } else {
+        printer_job_abort(job);
+    }
+    job = NULL;
+
+out:
+    if (ctx->raster) {
+        raster_end(ctx->raster);
+    }
+    free(ctx->strip);
+    free(ctx->row);
+    free(ctx);
+    free(pool);
+
+    if (status) {
+        ESP_LOGW(TAG, "⚠️ Imagen rechazada: %s", msg);
+        return send_status(req, status, msg);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error imprimiendo imagen: %s", esp_err_to_name(ret));
+        return send_status(req, "500 Internal Server Error", esp_err_to_name(ret));
+    }
+
+    ESP_LOGI(TAG, "✅ Imagen enviada a la impresora");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"ok\":true}");
+}
+
+static esp_err_t print_image_handler(httpd_req_t *req)
+{
+    if (req->content_len == 0) {
+        return send_status(req, "400 Bad Request", "Falta la imagen");
+    }
+    if (!printer_is_ready()) {
+        return send_status(req, "503 Service Unavailable", "Impresora no lista");
+    }
+
+    // Una impresión en curso y otra esperando (compartido con /print)
+    esp_err_t ret = web_defer(req, print_image_worker);
+    if (ret == ESP_ERR_TIMEOUT) {
+        httpd_resp_set_hdr(req, "Retry-After", "5");
+        return send_status(req, "503 Service Unavailable", "Otra impresion en curso");
+    }
+    if (ret != ESP_OK) {
+        return send_status(req, "500 Internal Server Error", "Sin memoria");
+    }
+    return ESP_OK;
+}
+
+esp_err_t image_upload_register(httpd_handle_t server)
+{
+    httpd_uri_t image_uri = {
+        .uri = "/print_image",
+        .method = HTTP_POST,
+        .handler = print_image_handler,
+        .user_ctx = NULL
+    };
+    return httpd_register_uri_handler(server, &image_uri);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file image_upload.h
+ * @brief HTTP endpoint that prints uploaded photos
+ *
+ * `POST /print_image` takes a baseline JPEG as the raw request body
+ * (`Content-Type: image/jpeg`). The image is decoded one MCU row at a time
+ * while it is received, scaled to the paper width, dithered and streamed to
+ * the printer band by band, so peak RAM does not depend on the image size.
+ *
+ * The work runs on the web worker task (see web_defer()), so the server
+ * keeps answering other clients meanwhile. While another upload is in
+ * progress and one more is waiting, the request gets `503` with
+ * `Retry-After`.
+ *
+ * Optional query parameters:
+ * - `dither=fs|bayer|threshold` (default `fs`)
+ * - `width=<dots>` (default IMAGE_PRINT_WIDTH)
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_PRINT_WIDTH 576   ///< Printable dots of an 80 mm head at 203 dpi
+
+/**
+ * @brief Register `POST /print_image`
+ *
+ * @param server Running HTTP server
+ * @return esp_err_t Result of httpd_register_uri_handler()
+ */
+esp_err_t image_upload_register(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,148 @@
+#include "job_status.h"
+#include "print_spool.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "JOB_STATUS";
+
+#define JOB_RETRY_AFTER           "5"   // Segundos sugeridos si no se pudo encolar
+
+// Anillo indexado por id: el lugar de un id lo reusa el id HISTORY más nuevo
+typedef struct {
+    uint32_t id;
+    uint8_t status;
+} job_entry_t;
+
+static job_entry_t s_jobs[JOB_STATUS_HISTORY];
+static uint32_t s_next_id = 1;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ============================================
+// ESTADO
+// ============================================
+
+uint32_t job_status_create(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t id = s_next_id++;
+    if (s_next_id == 0) {
+        s_next_id = 1;
+    }
+    s_jobs[id % JOB_STATUS_HISTORY] = (job_entry_t){
+        .id = id,
+        .status = JOB_STATUS_QUEUED,
+    };
+    taskEXIT_CRITICAL(&s_lock);
+    return id;
+}
+
+void job_status_set(uint32_t id, job_status_t status)
+{
+    job_entry_t *e = &s_jobs[id % JOB_STATUS_HISTORY];
+
+    taskENTER_CRITICAL(&s_lock);
+    if (id != 0 && e->id == id && e->status != JOB_STATUS_DONE && e->status != JOB_STATUS_FAILED) {
+        e->status = status;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+job_status_t job_status_get(uint32_t id)
+{
+    job_entry_t *e = &s_jobs[id % JOB_STATUS_HISTORY];
+    job_status_t status = JOB_STATUS_UNKNOWN;
+
+    taskENTER_CRITICAL(&s_lock);
+    if (id != 0 && e->id == id) {
+        status = e->status;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return status;
+}
+
+const char *job_status_name(job_status_t status)
+{
+    switch (status) {
+    case JOB_STATUS_QUEUED:   return "queued";
+    case JOB_STATUS_PRINTING: return "printing";
+    case JOB_STATUS_DONE:     return "done";
+    case JOB_STATUS_FAILED:   return "failed";
+    default:                  return "unknown";
+    }
+}
+
+// Avisos del spool (o del driver sin spool): la etiqueta es el id
+static void spool_listener(uint32_t tag, print_spool_event_t event)
+{
+    static const job_status_t map[] = {
+        [PRINT_SPOOL_EV_STORED] = JOB_STATUS_QUEUED,
+        [PRINT_SPOOL_EV_PRINTING] = JOB_STATUS_PRINTING,
+        [PRINT_SPOOL_EV_PRINTED] = JOB_STATUS_DONE,
+        [PRINT_SPOOL_EV_FAILED] = JOB_STATUS_FAILED,
+    };
+
+    job_status_set(tag, map[event]);
+    if (event == PRINT_SPOOL_EV_FAILED) {
+        ESP_LOGW(TAG, "⚠️ Trabajo web #%lu falló", tag);
+    }
+}
+
+// ============================================
+// HANDLER HTTP
+// ============================================
+
+static esp_err_t job_get_handler(httpd_req_t *req)
+{
+    char json[64];
+    char *end;
+    const char *arg = req->uri + strlen("/job/");
+    unsigned long id = strtoul(arg, &end, 10);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    job_status_t status = (end != arg && (*end == '\0' || *end == '?')) ? job_status_get(id) : JOB_STATUS_UNKNOWN;
+    if (status == JOB_STATUS_UNKNOWN) {
+        httpd_resp_set_status(req, "404 Not Found");
+        return httpd_resp_sendstr(req, "{\"ok\":false,\"error\":\"trabajo desconocido\"}");
+    }
+
+    int len = snprintf(json, sizeof(json), "{\"job\":%lu,\"status\":\"%s\"}",
+                       id, job_status_name(status));
+    return httpd_resp_send(req, json, len);
+}
+
+esp_err_t job_status_respond(httpd_req_t *req, uint32_t id)
+{
+    char json[48];
+    char location[24];
+
+    httpd_resp_set_type(req, "application/json");
+    if (id == 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", JOB_RETRY_AFTER);
+        return httpd_resp_sendstr(req, "{\"ok\":false,\"error\":\"no se pudo encolar\"}");
+    }
+
+    snprintf(location, sizeof(location), "/job/%lu", id);
+    int len = snprintf(json, sizeof(json), "{\"ok\":true,\"job\":%lu}", id);
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_set_hdr(req, "Location", location);
+    return httpd_resp_send(req, json, len);
+}
+
+esp_err_t job_status_register(httpd_handle_t server)
+{
+    print_spool_set_listener(spool_listener);
+
+    httpd_uri_t job_uri = {
+        .uri = "/job/*",
+        .method = HTTP_GET,
+        .handler = job_get_handler,
+        .user_ctx = NULL
+    };
+    return httpd_register_uri_handler(server, &job_uri);
+}
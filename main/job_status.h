@@ -0,0 +1,97 @@
+/**
+ * @file job_status.h
+ * @brief Status of recently submitted web print jobs
+ *
+ * HTTP handlers do not wait for a job to be stored or printed. They create
+ * an id here, submit the job with print_spool_submit_async() using that id
+ * as the tag, and answer `202 Accepted` with the id. The spool and the USB
+ * transfer completion then move the job through queued → printing → done
+ * (or failed), and `GET /job/<id>` reports where it is:
+ *
+ *     {"job":12,"status":"printing"}
+ *
+ * Only the last JOB_STATUS_HISTORY ids are kept (RAM only); older or
+ * unknown ids get 404.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JOB_STATUS_HISTORY 32      ///< Ids remembered
+
+/**
+ * @brief Job status
+ */
+typedef enum {
+    JOB_STATUS_UNKNOWN = 0,        ///< Never issued, or forgotten
+    JOB_STATUS_QUEUED,             ///< Accepted, waiting for the printer
+    JOB_STATUS_PRINTING,           ///< Being transferred to the printer
+    JOB_STATUS_DONE,               ///< The printer accepted every byte
+    JOB_STATUS_FAILED,             ///< Rejected or dropped
+} job_status_t;
+
+/**
+ * @brief Issue a new job id in the QUEUED state
+ *
+ * @return Non-zero id, usable as a print_spool_submit_async() tag
+ */
+uint32_t job_status_create(void);
+
+/**
+ * @brief Update the status of a job
+ *
+ * DONE and FAILED are final: later updates are ignored, so a late
+ * "printing" cannot hide a completion. Unknown ids are ignored.
+ * Safe from any task; does not block.
+ *
+ * @param id Id from job_status_create()
+ * @param status New status
+ */
+void job_status_set(uint32_t id, job_status_t status);
+
+/**
+ * @brief Get the status of a job
+ *
+ * @param id Id from job_status_create()
+ * @return Status, or JOB_STATUS_UNKNOWN if the id is not remembered
+ */
+job_status_t job_status_get(uint32_t id);
+
+/**
+ * @brief Name of a status as used in the JSON ("queued", "printing", ...)
+ */
+const char *job_status_name(job_status_t status);
+
+/**
+ * @brief Answer a submission
+ *
+ * Sends `202 Accepted` with `{"ok":true,"job":<id>}` and a Location header
+ * pointing at /job/<id>, or `503 Service Unavailable` with Retry-After if
+ * id is 0 (the job was not accepted).
+ *
+ * @param req HTTP request
+ * @param id Id from job_status_create(), or 0
+ * @return Result of httpd_resp_send()
+ */
+esp_err_t job_status_respond(httpd_req_t *req, uint32_t id);
+
+/**
+ * @brief Follow spool events and register `GET /job/<id>`
+ *
+ * Needs the server's wildcard URI matcher (httpd_uri_match_wildcard).
+ *
+ * @param server Running HTTP server
+ * @return Result of httpd_register_uri_handler()
+ */
+esp_err_t job_status_register(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,6 +9,8 @@
 #include "wifi_manager.h"
 #include "ota_config_server.h"
 #include "printer_driver.h"  // 🔥 AGREGADO
+#include "print_spool.h"
+#include "raw_server.h"
 
 #define BUTTON_GPIO         GPIO_NUM_0
 #define BUTTON_HOLD_TIME_MS 5000
@@ -98,15 +100,16 @@ static void start_normal_mode(void) {
         ESP_LOGE(TAG, "❌ Error inicializando impresora: %s", esp_err_to_name(ret));
     }
 
-    // Esperar a que la impresora se detecte (máximo 5 segundos)
-    int timeout = 50; // 50 * 100ms = 5 segundos
-    while (!printer_is_ready() && timeout > 0) {
-        ESP_LOGW(TAG, "⏳ Esperando impresora... (%d)", timeout);
-        vTaskDelay(pdMS_TO_TICKS(100));
-        timeout--;
+    // Spool en flash: los trabajos pendientes de antes del reinicio se
+    // imprimen en cuanto aparezca la impresora
+    ret = print_spool_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Spool no disponible, impresión directa: %s", esp_err_to_name(ret));
     }
 
-    if (!printer_is_ready()) {
+    // Esperar a que la impresora se detecte (máximo 5 segundos)
+    ESP_LOGW(TAG, "⏳ Esperando impresora...");
+    if (!printer_wait_ready(5000)) {
         ESP_LOGE(TAG, "❌ Timeout esperando impresora");
     } else {
         ESP_LOGI(TAG, "✅ Impresora detectada y lista");
@@ -131,6 +134,12 @@ static void start_normal_mode(void) {
     wifi_manager_init_ap();
     start_webserver();
     
+    // Impresión directa desde PCs y sistemas POS (puerto 9100)
+    ret = raw_server_start();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Servidor RAW no iniciado: %s", esp_err_to_name(ret));
+    }
+    
     ESP_LOGI(TAG, "Sistema listo - Modo aplicación activo");
 }
 
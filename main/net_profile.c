@@ -0,0 +1,230 @@
+#include "net_profile.h"
+#include "nvs_storage.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "NET_PROFILE";
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define NET_PROFILE_KEY           "net_profile"
+#define NET_HTTPD_OWN_SOCKETS     3     // Los que httpd se reserva (escucha, control...)
+#define NET_RAW_SOCKETS           2     // Servidor RAW 9100: escucha + la conexión en curso
+#define NET_KEEPALIVE_INTERVAL_S  5
+#define NET_KEEPALIVE_COUNT       3
+
+// Sockets que quedan para sesiones HTTP
+#define NET_HTTP_SOCKETS_FREE     (CONFIG_LWIP_MAX_SOCKETS - NET_HTTPD_OWN_SOCKETS - NET_RAW_SOCKETS)
+
+#if CONFIG_ALLTOPRINT_NET_PROFILE_BASICO
+#define NET_PROFILE_DEFAULT       "basico"
+#elif CONFIG_ALLTOPRINT_NET_PROFILE_CUSTOM
+#define NET_PROFILE_DEFAULT       "personalizado"
+#else
+#define NET_PROFILE_DEFAULT       "evento"
+#endif
+
+// Los límites se recortan al armar el perfil activo (ver clamp_profile)
+static const net_profile_t s_profiles[] = {
+    // Lo de antes: las 7 sesiones de HTTPD_DEFAULT_CONFIG() y 4 clientes en el AP
+    {
+        .name = "basico",
+        .ap_max_clients = 4,
+        .http_max_sockets = 7,
+        .http_backlog = 5,
+        .lru_purge = true,
+        .keep_alive_idle_s = 0,
+        .timeout_s = 5,
+    },
+    // Salas llenas: todo lo que dé el AP y todos los sockets libres. El
+    // keep-alive suelta pronto las sesiones de teléfonos que se fueron del
+    // AP sin cerrar, y los timeouts cortos no dejan a uno lento ocupando
+    // la tarea del servidor.
+    {
+        .name = "evento",
+        .ap_max_clients = UINT8_MAX,
+        .http_max_sockets = UINT16_MAX,
+        .http_backlog = 16,
+        .lru_purge = true,
+        .keep_alive_idle_s = 30,
+        .timeout_s = 3,
+    },
+    {
+        .name = "personalizado",
+        .ap_max_clients = CONFIG_ALLTOPRINT_NET_AP_MAX_CLIENTS,
+        .http_max_sockets = CONFIG_ALLTOPRINT_NET_HTTP_MAX_SOCKETS,
+        .http_backlog = CONFIG_ALLTOPRINT_NET_HTTP_BACKLOG,
+#if CONFIG_ALLTOPRINT_NET_LRU_PURGE
+        .lru_purge = true,
+#endif
+        .keep_alive_idle_s = CONFIG_ALLTOPRINT_NET_KEEPALIVE_IDLE,
+        .timeout_s = CONFIG_ALLTOPRINT_NET_TIMEOUT,
+    },
+};
+
+#define NET_PROFILE_COUNT (sizeof(s_profiles) / sizeof(s_profiles[0]))
+
+static net_profile_t s_active;
+static bool s_loaded = false;
+
+// ============================================
+// PERFILES
+// ============================================
+
+static const net_profile_t *find_profile(const char *name)
+{
+    for (size_t i = 0; i < NET_PROFILE_COUNT; i++) {
+        if (strcmp(s_profiles[i].name, name) == 0) {
+            return &s_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+// Recorta a lo que permiten el chip y la configuración de lwIP
+static void clamp_profile(net_profile_t *p)
+{
+    unsigned ap_limit = ESP_WIFI_MAX_CONN_NUM;
+#ifdef CONFIG_LWIP_DHCPS_MAX_STATION_NUM
+    // Un cliente sin lease de DHCP se asocia pero no tiene IP
+    if (ap_limit > CONFIG_LWIP_DHCPS_MAX_STATION_NUM) {
+        ap_limit = CONFIG_LWIP_DHCPS_MAX_STATION_NUM;
+    }
+#endif
+    if (p->ap_max_clients > ap_limit) {
+        p->ap_max_clients = ap_limit;
+    }
+
+    int free_sockets = NET_HTTP_SOCKETS_FREE;
+    if (free_sockets < 1) {
+        free_sockets = 1;
+    }
+    if (p->http_max_sockets > free_sockets) {
+        p->http_max_sockets = free_sockets;
+    }
+}
+
+const net_profile_t *net_profile_get(void)
+{
+    if (s_loaded) {
+        return &s_active;
+    }
+
+    char name[NET_PROFILE_NAME_LEN + 1];
+    nvs_get_str_value(NET_PROFILE_KEY, name, sizeof(name), NET_PROFILE_DEFAULT);
+
+    const net_profile_t *p = find_profile(name);
+    if (!p) {
+        ESP_LOGW(TAG, "⚠️ Perfil '%s' desconocido, se usa %s", name, NET_PROFILE_DEFAULT);
+        p = find_profile(NET_PROFILE_DEFAULT);
+    }
+
+    s_active = *p;
+    clamp_profile(&s_active);
+    s_loaded = true;
+
+    ESP_LOGI(TAG, "📶 Perfil %s: %u clientes en el AP, %u sesiones HTTP, backlog %u, keep-alive %u s",
+             s_active.name, s_active.ap_max_clients, s_active.http_max_sockets,
+             s_active.http_backlog, s_active.keep_alive_idle_s);
+    return &s_active;
+}
+
+esp_err_t net_profile_select(const char *name)
+{
+    const net_profile_t *p = find_profile(name);
+    if (!p) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return nvs_set_str_value(NET_PROFILE_KEY, p->name);
+}
+
+void net_profile_apply_httpd(httpd_config_t *config)
+{
+    const net_profile_t *p = net_profile_get();
+
+    config->max_open_sockets = p->http_max_sockets;
+    config->backlog_conn = p->http_backlog;
+    config->lru_purge_enable = p->lru_purge;
+    config->recv_wait_timeout = p->timeout_s;
+    config->send_wait_timeout = p->timeout_s;
+    config->keep_alive_enable = p->keep_alive_idle_s > 0;
+    if (config->keep_alive_enable) {
+        config->keep_alive_idle = p->keep_alive_idle_s;
+        config->keep_alive_interval = NET_KEEPALIVE_INTERVAL_S;
+        config->keep_alive_count = NET_KEEPALIVE_COUNT;
+    }
+}
+
+// ============================================
+// ENDPOINT /net_profile
+// ============================================
+
+static esp_err_t net_profile_get_handler(httpd_req_t *req)
+{
+    const net_profile_t *p = net_profile_get();
+    char next[NET_PROFILE_NAME_LEN + 1];
+    char json[256];
+
+    nvs_get_str_value(NET_PROFILE_KEY, next, sizeof(next), NET_PROFILE_DEFAULT);
+
+    int len = snprintf(json, sizeof(json),
+                       "{\"profile\":\"%s\",\"next\":\"%s\",\"ap_max_clients\":%u,"
+                       "\"http_max_sockets\":%u,\"backlog\":%u,\"lru_purge\":%s,"
+                       "\"keep_alive_idle\":%u,\"timeout\":%u}",
+                       p->name, find_profile(next) ? next : NET_PROFILE_DEFAULT,
+                       p->ap_max_clients, p->http_max_sockets, p->http_backlog,
+                       p->lru_purge ? "true" : "false", p->keep_alive_idle_s, p->timeout_s);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, json, len);
+}
+
+static esp_err_t net_profile_post_handler(httpd_req_t *req)
+{
+    char query[32];
+    char name[NET_PROFILE_NAME_LEN + 1];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Falta ?name=");
+    }
+
+    esp_err_t ret = net_profile_select(name);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                                   "Perfiles: basico, evento, personalizado");
+    }
+    if (ret != ESP_OK) {
+        return httpd_resp_send_500(req);
+    }
+
+    ESP_LOGI(TAG, "📶 Perfil %s guardado, se aplica al reiniciar", name);
+    return httpd_resp_sendstr(req, "OK (se aplica al reiniciar)");
+}
+
+esp_err_t net_profile_register(httpd_handle_t server)
+{
+    httpd_uri_t get_uri = {
+        .uri = "/net_profile",
+        .method = HTTP_GET,
+        .handler = net_profile_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_uri_t post_uri = {
+        .uri = "/net_profile",
+        .method = HTTP_POST,
+        .handler = net_profile_post_handler,
+        .user_ctx = NULL
+    };
+
+    esp_err_t ret = httpd_register_uri_handler(server, &get_uri);
+    if (ret == ESP_OK) {
+        ret = httpd_register_uri_handler(server, &post_uri);
+    }
+    return ret;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file net_profile.h
+ * @brief Capacity profile of the access point and the application web server
+ *
+ * A profile sets how many phones can join the AP and how the HTTP server
+ * shares its sockets among them:
+ *
+ * | Profile         | AP clients | HTTP sockets       | Backlog | Keep-alive |
+ * |-----------------|------------|--------------------|---------|------------|
+ * | `basico`        | 4          | 7                  | 5       | off        |
+ * | `evento`        | AP maximum | every free socket  | 16      | 30 s       |
+ * | `personalizado` | Kconfig    | Kconfig            | Kconfig | Kconfig    |
+ *
+ * The default profile is chosen in menuconfig ("AllToPrint" menu), which
+ * also holds the values of `personalizado`. It can be changed without
+ * reflashing with `POST /net_profile?name=<profile>`; the choice is stored
+ * in NVS and applied on the next restart, since neither the AP nor the
+ * server can be resized while running. `GET /net_profile` shows the
+ * profile in use with its effective values.
+ *
+ * Values are clamped to what the build allows: the soft-AP station limit
+ * of the chip, the DHCP leases (CONFIG_LWIP_DHCPS_MAX_STATION_NUM) and the
+ * lwIP sockets (CONFIG_LWIP_MAX_SOCKETS) left after the server's own and
+ * the RAW 9100 server's. The lwIP sizing itself is in sdkconfig.defaults.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NET_PROFILE_NAME_LEN 14    ///< Longest profile name
+
+/**
+ * @brief Capacity settings
+ */
+typedef struct {
+    const char *name;
+    uint8_t ap_max_clients;        ///< Stations allowed on the AP
+    uint16_t http_max_sockets;     ///< Open HTTP sessions (httpd max_open_sockets)
+    uint16_t http_backlog;         ///< Connections waiting to be accepted
+    bool lru_purge;                ///< Close the least recently used session when full
+    uint16_t keep_alive_idle_s;    ///< TCP keep-alive idle time; 0 = off
+    uint16_t timeout_s;            ///< HTTP receive/send timeout
+} net_profile_t;
+
+/**
+ * @brief Profile in use, with its values already clamped
+ *
+ * Read from NVS on first call (Kconfig default if none is stored); stays
+ * the same until restart.
+ */
+const net_profile_t *net_profile_get(void);
+
+/**
+ * @brief Store the profile to use from the next restart
+ *
+ * @param name "basico", "evento" or "personalizado"
+ * @return ESP_OK, ESP_ERR_NOT_FOUND for an unknown name, or an NVS error
+ */
+esp_err_t net_profile_select(const char *name);
+
+/**
+ * @brief Apply the profile in use to an HTTP server configuration
+ *
+ * Sets max_open_sockets, backlog_conn, lru_purge_enable, the keep-alive
+ * fields and the receive/send timeouts; the rest is left as is.
+ */
+void net_profile_apply_httpd(httpd_config_t *config);
+
+/**
+ * @brief Register `GET /net_profile` and `POST /net_profile?name=X`
+ *
+ * @param server Running HTTP server
+ * @return Result of httpd_register_uri_handler()
+ */
+esp_err_t net_profile_register(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
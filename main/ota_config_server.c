@@ -2,153 +2,59 @@
 #include "esp_log.h"
 #include "esp_ota_ops.h"
 #include "esp_http_server.h"
+#include "form_parser.h"
+#include "web_assets.h"
 #include <string.h>
 #include <sys/param.h>
 
 static const char *TAG = "OTA_UPLOAD";
 
-// HTML MEJORADO con el mismo estilo de las apps
-static const char *OTA_CONFIG_HTML = 
-"<!DOCTYPE html>"
-"<html lang='es'>"
-"<head>"
-"    <meta charset='UTF-8'>"
-"    <meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-"    <title>Actualizar Aplicación</title>"
-"    <style>"
-"        body {"
-"            font-family: Arial, sans-serif;"
-"            background-color: #f4f6f9;"
-"            margin: 0;"
-"            padding: 0;"
-"            display: flex;"
-"            justify-content: center;"
-"            align-items: center;"
-"            height: 100vh;"
-"        }"
-"        .container {"
-"            width: 90%;"
-"            max-width: 480px;"
-"            background: #fff;"
-"            padding: 24px;"
-"            border-radius: 12px;"
-"            box-shadow: 0 4px 12px rgba(0,0,0,0.2);"
-"        }"
-"        h1 {"
-"            text-align: center;"
-"            color: #333;"
-"            margin-bottom: 20px;"
-"        }"
-"        .info-box {"
-"            background: #e7f3ff;"
-"            padding: 15px;"
-"            border-radius: 8px;"
-"            margin: 20px 0;"
-"            font-size: 14px;"
-"            border-left: 4px solid #007BFF;"
-"        }"
-"        .file-input {"
-"            width: 100%;"
-"            padding: 12px;"
-"            margin: 15px 0;"
-"            border: 2px dashed #007BFF;"
-"            border-radius: 8px;"
-"            background: #f8f9fa;"
-"            cursor: pointer;"
-"            transition: all 0.3s ease;"
-"            text-align: center;"
-"        }"
-"        .file-input:hover {"
-"            background: #e7f3ff;"
-"            border-color: #0056b3;"
-"        }"
-"        button {"
-"            margin-top: 20px;"
-"            width: 100%;"
-"            background-color: #007BFF;"
-"            color: white;"
-"            padding: 14px;"
-"            font-size: 18px;"
-"            border: none;"
-"            border-radius: 8px;"
-"            cursor: pointer;"
-"            transition: background-color 0.3s ease;"
-"        }"
-"        button:hover {"
-"            background-color: #0056b3;"
-"        }"
-"        .instructions {"
-"            font-size: 12px;"
-"            color: #666;"
-"            text-align: center;"
-"            margin-top: 15px;"
-"        }"
-"        .status {"
-"            text-align: center;"
-"            margin-top: 15px;"
-"            padding: 10px;"
-"            border-radius: 5px;"
-"            display: none;"
-"        }"
-"        .success {"
-"            background: #d4edda;"
-"            color: #155724;"
-"            border: 1px solid #c3e6cb;"
-"        }"
-"        .error {"
-"            background: #f8d7da;"
-"            color: #721c24;"
-"            border: 1px solid #f5c6cb;"
-"        }"
-"    </style>"
-"</head>"
-"<body>"
-"    <div class='container'>"
-"        <h1>Actualizar Aplicación</h1>"
-"        <div class='info-box'>"
-"            <strong>Modo Configuración OTA</strong><br>"
-"            Sube un archivo .bin para cambiar la aplicación del sistema"
-"        </div>"
-"        <form method='POST' action='/do_update' enctype='multipart/form-data' id='otaForm'>"
-"            <label class='file-input'>"
-"                📁 Seleccionar archivo .bin"
-"                <input type='file' name='firmware' accept='.bin' required "
-"                       style='display: none;' id='fileInput' onchange='updateFileName()'>"
-"            </label>"
-"            <div id='fileName' class='instructions'></div>"
-"            <button type='submit' id='submitBtn'>Subir y Actualizar</button>"
-"        </form>"
-"        <div class='instructions'>"
-"            El sistema se reiniciará automáticamente después de la actualización"
-"        </div>"
-"        <div id='statusMessage' class='status'></div>"
-"    </div>"
-"    <script>"
-"        function updateFileName() {"
-"            const fileInput = document.getElementById('fileInput');"
-"            const fileNameDiv = document.getElementById('fileName');"
-"            if (fileInput.files.length > 0) {"
-"                fileNameDiv.textContent = 'Archivo seleccionado: ' + fileInput.files[0].name;"
-"                fileNameDiv.style.color = '#007BFF';"
-"            } else {"
-"                fileNameDiv.textContent = '';"
-"            }"
-"        }"
-"        "
-"        document.getElementById('otaForm').onsubmit = function() {"
-"            const submitBtn = document.getElementById('submitBtn');"
-"            submitBtn.disabled = true;"
-"            submitBtn.textContent = 'Subiendo...';"
-"            submitBtn.style.backgroundColor = '#6c757d';"
-"        };"
-"    </script>"
-"</body>"
-"</html>";
+// Página de carga (web/ota.html, embebida comprimida)
+WEB_ASSET_DECLARE(ota_html, "text/html");
 
 // Handler GET /
 static esp_err_t root_ota_get_handler(httpd_req_t *req) {
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, OTA_CONFIG_HTML, HTTPD_RESP_USE_STRLEN);
+    return web_asset_send(req, &ota_html_asset);
+}
+
+// Destino del campo 'firmware' mientras se recibe el formulario
+typedef struct {
+    esp_ota_handle_t handle;
+    const esp_partition_t *partition;
+    size_t content_len;
+    int written;
+    bool found;
+} ota_sink_t;
+
+static esp_err_t ota_field_cb(void *ctx, const char *name,
+                              const uint8_t *data, size_t length, bool done) {
+    ota_sink_t *sink = ctx;
+
+    if (strcmp(name, "firmware") != 0) {
+        return ESP_OK;
+    }
+    if (done) {
+        sink->found = true;
+        return ESP_OK;
+    }
+    if (sink->written + length > sink->partition->size) {
+        ESP_LOGE(TAG, "La imagen no entra en la partición (%lu bytes)", sink->partition->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err = esp_ota_write(sink->handle, data, length);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error en esp_ota_write: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Log de progreso cada 100 KB
+    int before = sink->written / (100 * 1024);
+    sink->written += length;
+    if (sink->written / (100 * 1024) != before && sink->content_len > 0) {
+        ESP_LOGI(TAG, "Progreso: %d/%d bytes (%d%%)", sink->written, sink->content_len,
+                 (int)((sink->written * 100LL) / sink->content_len));
+    }
     return ESP_OK;
 }
 
@@ -156,8 +62,6 @@ static esp_err_t root_ota_get_handler(httpd_req_t *req) {
 static esp_err_t ota_upload_handler(httpd_req_t *req) {
     esp_ota_handle_t ota_handle = 0;
     const esp_partition_t *update_partition = NULL;
-    uint8_t ota_buff[1024];  // Buffer estático - más seguro
-    int data_read;
     int total_received = 0;
     esp_err_t err = ESP_OK;
     bool ota_started = false;
@@ -193,92 +97,21 @@ static esp_err_t ota_upload_handler(httpd_req_t *req) {
     ota_started = true;
     ESP_LOGI(TAG, "OTA begin exitoso");
 
-    // 3. Procesar datos en chunks pequeños y SEGUROS
-    int remaining = req->content_len;
-    bool in_binary_section = false;
-    int skip_counter = 0;
-    const int MAX_SKIP = 4096; // Máximo bytes a buscar boundary
-
+    // 3. Recibir el formulario: solo el campo 'firmware' va a la flash.
+    // El parser corta en el boundary real, así no se escriben cabeceras de
+    // la parte ni el delimitador final dentro de la imagen.
     ESP_LOGI(TAG, "Comenzando recepción de datos...");
 
-    while (remaining > 0 && total_received < (10 * 1024 * 1024)) { // Límite de 10MB por seguridad
-        // Leer chunk pequeño
-        int chunk_size = (remaining < sizeof(ota_buff)) ? remaining : sizeof(ota_buff);
-        data_read = httpd_req_recv(req, (char*)ota_buff, chunk_size);
-        
-        if (data_read < 0) {
-            if (data_read == HTTPD_SOCK_ERR_TIMEOUT) {
-                ESP_LOGW(TAG, "Timeout, reintentando...");
-                continue;
-            }
-            ESP_LOGE(TAG, "Error de recepción: %d", data_read);
-            break;
-        }
-        
-        if (data_read == 0) {
-            ESP_LOGW(TAG, "Conexión cerrada por cliente");
-            break;
-        }
-
-        // 🔥 PROCESAMIENTO SEGURO
-        if (!in_binary_section) {
-            // Buscar el inicio de los datos binarios de forma SEGURA
-            bool found_boundary = false;
-            int binary_start_offset = 0;
-            
-            for (int i = 0; i <= data_read - 4; i++) {
-                if (ota_buff[i] == '\r' && ota_buff[i+1] == '\n' && 
-                    ota_buff[i+2] == '\r' && ota_buff[i+3] == '\n') {
-                    found_boundary = true;
-                    binary_start_offset = i + 4;
-                    break;
-                }
-            }
-            
-            if (found_boundary && binary_start_offset < data_read) {
-                int binary_size = data_read - binary_start_offset;
-                if (binary_size > 0) {
-                    err = esp_ota_write(ota_handle, &ota_buff[binary_start_offset], binary_size);
-                    if (err != ESP_OK) {
-                        ESP_LOGE(TAG, "Error en esp_ota_write: %s", esp_err_to_name(err));
-                        break;
-                    }
-                    total_received += binary_size;
-                    in_binary_section = true;
-                    ESP_LOGI(TAG, "Datos binarios encontrados después de %d bytes", skip_counter);
-                }
-            } else {
-                // Seguir buscando boundary
-                skip_counter += data_read;
-                if (skip_counter > MAX_SKIP) {
-                    ESP_LOGW(TAG, "Límite de búsqueda alcanzado, escribiendo todo como binario");
-                    in_binary_section = true;
-                    err = esp_ota_write(ota_handle, ota_buff, data_read);
-                    if (err != ESP_OK) break;
-                    total_received += data_read;
-                }
-            }
-        } else {
-            // Ya estamos en sección binaria - escribir directamente
-            err = esp_ota_write(ota_handle, ota_buff, data_read);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Error en esp_ota_write: %s", esp_err_to_name(err));
-                break;
-            }
-            total_received += data_read;
-        }
-
-        remaining -= data_read;
-
-        // Log de progreso SEGURO (sin divisiones por cero)
-        if (req->content_len > 0 && (total_received % (100 * 1024) == 0)) {
-            int progress = (total_received * 100) / req->content_len;
-            ESP_LOGI(TAG, "Progreso: %d/%d bytes (%d%%)", 
-                    total_received, req->content_len, progress);
-        }
-        
-        // Pequeña pausa para evitar sobrecarga
-        vTaskDelay(pdMS_TO_TICKS(5));
+    ota_sink_t sink = {
+        .handle = ota_handle,
+        .partition = update_partition,
+        .content_len = req->content_len,
+    };
+    err = form_parse_request(req, ota_field_cb, &sink);
+    total_received = sink.written;
+    if (err == ESP_OK && !sink.found) {
+        ESP_LOGE(TAG, "El formulario no trae el campo 'firmware'");
+        err = ESP_ERR_NOT_FOUND;
     }
 
     // 🔥 VERIFICAR SI HUBO ERROR DURANTE EL PROCESO
@@ -0,0 +1,30 @@
+#include "print_sched.h"
+
+uint32_t print_sched_rank(const print_sched_t *sched, uint32_t client)
+{
+    for (int i = 0; i < PRINT_SCHED_MAX_CLIENTS; i++) {
+        if (sched->served[i] && sched->client[i] == client) {
+            return sched->served[i];
+        }
+    }
+    return 0;
+}
+
+void print_sched_served(print_sched_t *sched, uint32_t client)
+{
+    int slot = 0;
+
+    // Mismo cliente o, si no está, el atendido hace más tiempo
+    for (int i = 0; i < PRINT_SCHED_MAX_CLIENTS; i++) {
+        if (sched->served[i] && sched->client[i] == client) {
+            slot = i;
+            break;
+        }
+        if (sched->served[i] < sched->served[slot]) {
+            slot = i;
+        }
+    }
+
+    sched->client[slot] = client;
+    sched->served[slot] = ++sched->clock;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file print_sched.h
+ * @brief Per-client round-robin bookkeeping for the print queues
+ *
+ * Within a priority lane the job to serve next is the one whose client was
+ * served least recently, so a single client flooding the queue cannot
+ * starve the others. Used by the driver dispatcher and by the spool.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRINT_SCHED_MAX_CLIENTS 16
+
+/**
+ * @brief Last-served clock of the most recent clients
+ *
+ * Zero-initialize before use. Not thread-safe: callers hold their own lock.
+ */
+typedef struct {
+    uint32_t client[PRINT_SCHED_MAX_CLIENTS];
+    uint32_t served[PRINT_SCHED_MAX_CLIENTS];
+    uint32_t clock;
+} print_sched_t;
+
+/**
+ * @brief Rank of a client: lower ranks are served first
+ *
+ * @return Clock value of the client's last service, 0 if it was never
+ *         served (or was forgotten)
+ */
+uint32_t print_sched_rank(const print_sched_t *sched, uint32_t client);
+
+/**
+ * @brief Record that a job of the client has just been served
+ *
+ * Evicts the least recently served client when the table is full.
+ */
+void print_sched_served(print_sched_t *sched, uint32_t client);
+
+#ifdef __cplusplus
+}
+#endif
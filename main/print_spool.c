@@ -0,0 +1,953 @@
+#include "print_spool.h"
+#include "printer_driver.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "print_sched.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "SPOOL";
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define SPOOL_PARTITION_LABEL     "storage"
+#define SPOOL_SECTOR_SIZE         4096
+#define SPOOL_MAGIC               0x5153  // "SQ": registro con carril y cliente
+#define SPOOL_MAX_JOBS            64      // Trabajos pendientes en el índice
+#define SPOOL_SUBMIT_QUEUE        8       // Envíos esperando al escritor
+#define SPOOL_SUBMIT_TIMEOUT_MS   2000
+#define SPOOL_BATCH_MS            20      // Ventana para agrupar escrituras
+#define SPOOL_MIN_FRAG            64      // Fragmento mínimo antes de saltar de sector
+#define SPOOL_READ_CHUNK          256
+#define SPOOL_MAX_OUTSTANDING     (PRINTER_MAX_DEVICES * 2) // Trabajos entregados al driver
+#define SPOOL_MAX_ATTEMPTS        3
+#define SPOOL_READY_WAIT_MS       1000
+#define SPOOL_STATE_PENDING       0xFFFFFFFF // Flash borrada: sin imprimir
+#define SPOOL_STATE_PRINTED       0x00000000
+
+#define SPOOL_REC_FIRST           (1 << 0)
+#define SPOOL_REC_LAST            (1 << 1)
+
+#define SPOOL_ALIGN4(x)           (((x) + 3) & ~3u)
+
+// Registro del log. Un trabajo ocupa uno o más registros consecutivos que
+// nunca cruzan un límite de sector. El estado se escribe aparte (1 → 0 sin
+// borrar) cuando la impresora aceptó el trabajo completo.
+typedef struct {
+    uint16_t magic;
+    uint8_t flags;
+    uint8_t prio;           // printer_prio_t
+    uint32_t seq;
+    uint32_t job_id;
+    uint32_t client;
+    uint16_t length;
+    uint16_t reserved2;
+    uint32_t crc;           // CRC32 de los campos anteriores y del payload
+    uint32_t state;
+} spool_rec_t;
+
+#define SPOOL_HDR_SIZE            sizeof(spool_rec_t)
+#define SPOOL_MAX_FRAG            (SPOOL_SECTOR_SIZE - SPOOL_HDR_SIZE)
+
+typedef enum {
+    SPOOL_JOB_QUEUED,
+    SPOOL_JOB_SENDING,
+    SPOOL_JOB_DONE,
+} spool_job_state_t;
+
+// Entrada del índice en RAM, en orden de llegada
+typedef struct {
+    uint32_t id;
+    uint32_t offset;        // Primer registro del trabajo
+    uint32_t length;
+    uint32_t client;
+    uint32_t tag;           // Para el listener; 0 = sin avisos (y tras un replay)
+    uint8_t prio;
+    uint8_t state;
+    uint8_t attempts;
+} spool_job_t;
+
+// Envío de un productor: vive en su stack mientras espera el commit. Los
+// envíos asíncronos (done == NULL) van en el heap junto con su copia de los
+// datos y los libera el escritor.
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    printer_prio_t prio;
+    uint32_t client;
+    uint32_t tag;
+    uint32_t id;
+    uint32_t offset;        // Primer registro, asignado por el escritor
+    esp_err_t result;
+    SemaphoreHandle_t done;
+} spool_req_t;
+
+// Fin de un trabajo informado por el driver
+typedef struct {
+    uint32_t id;
+    bool ok;
+} spool_done_t;
+
+typedef struct {
+    const esp_partition_t *part;
+    uint32_t sectors;
+    uint32_t head;              // Próximo byte a escribir
+    uint32_t stage_base;        // Inicio del sector de head, reflejado en s_stage
+    uint32_t stage_len;
+    uint32_t stage_flushed;
+    uint32_t next_seq;
+    uint32_t next_id;
+    spool_job_t jobs[SPOOL_MAX_JOBS];
+    uint32_t jobs_first;
+    uint32_t jobs_count;
+    uint32_t reserved;          // Lugares del índice tomados por el lote en curso
+    uint32_t outstanding;       // Trabajos entregados al driver (bajo mutex)
+    print_sched_t sched;        // Round-robin entre clientes (bajo mutex)
+    SemaphoreHandle_t mutex;    // Protege el índice
+    QueueHandle_t submit_queue; // spool_req_t*
+    QueueHandle_t done_queue;   // spool_done_t
+    QueueSetHandle_t events;
+    TaskHandle_t writer_hdl;
+    TaskHandle_t feeder_hdl;
+    bool active;
+} print_spool_t;
+
+static print_spool_t s_spool;
+static uint8_t s_stage[SPOOL_SECTOR_SIZE];
+static uint8_t s_read_buf[SPOOL_READ_CHUNK];
+static print_spool_listener_t s_listener = NULL;
+
+// Avisa el progreso de un trabajo con etiqueta. Nunca con el mutex tomado.
+static void notify(uint32_t tag, print_spool_event_t event)
+{
+    if (tag != 0 && s_listener) {
+        s_listener(tag, event);
+    }
+}
+
+// ============================================
+// UTILIDADES DEL LOG
+// ============================================
+
+static inline uint32_t sector_of(uint32_t offset)
+{
+    return offset / SPOOL_SECTOR_SIZE;
+}
+
+static inline uint32_t sector_end(uint32_t offset)
+{
+    return (sector_of(offset) + 1) * SPOOL_SECTOR_SIZE;
+}
+
+static inline uint32_t rec_size(uint16_t length)
+{
+    return SPOOL_HDR_SIZE + SPOOL_ALIGN4(length);
+}
+
+static uint32_t rec_crc(const spool_rec_t *hdr, const uint8_t *payload)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(spool_rec_t, crc));
+    return esp_rom_crc32_le(crc, payload, hdr->length);
+}
+
+// Lee la cabecera del registro en *offset, saltando el resto de sector que
+// el escritor dejó sin usar. Solo valida la forma, no el CRC.
+static esp_err_t read_header(uint32_t *offset, spool_rec_t *hdr)
+{
+    for (int hops = 0; hops < 2; hops++) {
+        uint32_t off = *offset;
+        if (sector_end(off) - off >= SPOOL_HDR_SIZE) {
+            esp_err_t ret = esp_partition_read(s_spool.part, off, hdr, SPOOL_HDR_SIZE);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            if (hdr->magic == SPOOL_MAGIC && hdr->length <= SPOOL_MAX_FRAG &&
+                off + rec_size(hdr->length) <= sector_end(off)) {
+                return ESP_OK;
+            }
+            if (hdr->magic != 0xFFFF) {
+                return ESP_ERR_INVALID_CRC;
+            }
+        }
+        *offset = sector_end(off) % s_spool.part->size;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Primer trabajo del índice que todavía ocupa el log
+static bool oldest_pending(uint32_t *offset)
+{
+    for (uint32_t i = 0; i < s_spool.jobs_count; i++) {
+        const spool_job_t *job = &s_spool.jobs[(s_spool.jobs_first + i) % SPOOL_MAX_JOBS];
+        if (job->state != SPOOL_JOB_DONE) {
+            *offset = job->offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+static spool_job_t *find_job(uint32_t id)
+{
+    for (uint32_t i = 0; i < s_spool.jobs_count; i++) {
+        spool_job_t *job = &s_spool.jobs[(s_spool.jobs_first + i) % SPOOL_MAX_JOBS];
+        if (job->id == id) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+// ============================================
+// ESCRITURA (solo desde la tarea escritora)
+// ============================================
+
+static esp_err_t stage_flush(void)
+{
+    if (s_spool.stage_len == s_spool.stage_flushed) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = esp_partition_write(s_spool.part,
+                                        s_spool.stage_base + s_spool.stage_flushed,
+                                        s_stage + s_spool.stage_flushed,
+                                        s_spool.stage_len - s_spool.stage_flushed);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error escribiendo spool: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    s_spool.stage_flushed = s_spool.stage_len;
+    return ESP_OK;
+}
+
+// Pasa al siguiente sector del anillo, borrándolo. Falla si ahí empieza el
+// trabajo pendiente más antiguo (log lleno).
+static esp_err_t next_sector(void)
+{
+    esp_err_t ret = stage_flush();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uint32_t next = (sector_of(s_spool.stage_base) + 1) % s_spool.sectors;
+    uint32_t tail;
+
+    xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+    bool busy = oldest_pending(&tail) && sector_of(tail) == next;
+    xSemaphoreGive(s_spool.mutex);
+
+    if (busy) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = esp_partition_erase_range(s_spool.part, next * SPOOL_SECTOR_SIZE, SPOOL_SECTOR_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error borrando sector %lu: %s", next, esp_err_to_name(ret));
+        return ret;
+    }
+
+    s_spool.head = next * SPOOL_SECTOR_SIZE;
+    s_spool.stage_base = s_spool.head;
+    s_spool.stage_len = 0;
+    s_spool.stage_flushed = 0;
+    return ESP_OK;
+}
+
+// Agrega un trabajo al sector en preparación. Queda durable en el próximo
+// stage_flush().
+static esp_err_t append_job(const spool_req_t *req, uint32_t *out_offset)
+{
+    const uint8_t *data = req->data;
+    size_t length = req->length;
+    size_t written = 0;
+    uint8_t flags = SPOOL_REC_FIRST;
+
+    *out_offset = UINT32_MAX;
+    while (written < length) {
+        size_t rest = length - written;
+        size_t room = s_spool.stage_base + SPOOL_SECTOR_SIZE - s_spool.head;
+        size_t min_room = SPOOL_HDR_SIZE + (rest < SPOOL_MIN_FRAG ? rest : SPOOL_MIN_FRAG);
+
+        if (room < min_room) {
+            esp_err_t ret = next_sector();
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            continue;
+        }
+
+        size_t frag = room - SPOOL_HDR_SIZE;
+        if (frag > rest) {
+            frag = rest;
+        }
+        if (written + frag == length) {
+            flags |= SPOOL_REC_LAST;
+        }
+
+        spool_rec_t hdr = {
+            .magic = SPOOL_MAGIC,
+            .flags = flags,
+            .prio = req->prio,
+            .seq = s_spool.next_seq++,
+            .job_id = req->id,
+            .client = req->client,
+            .length = frag,
+            .reserved2 = 0xFFFF,
+            .state = SPOOL_STATE_PENDING,
+        };
+        hdr.crc = rec_crc(&hdr, data + written);
+
+        uint8_t *dst = s_stage + (s_spool.head - s_spool.stage_base);
+        memcpy(dst, &hdr, SPOOL_HDR_SIZE);
+        memcpy(dst + SPOOL_HDR_SIZE, data + written, frag);
+        memset(dst + SPOOL_HDR_SIZE + frag, 0xFF, SPOOL_ALIGN4(frag) - frag);
+
+        if (*out_offset == UINT32_MAX) {
+            *out_offset = s_spool.head;
+        }
+        s_spool.head += rec_size(frag);
+        s_spool.stage_len += rec_size(frag);
+        written += frag;
+        flags = 0;
+    }
+
+    return ESP_OK;
+}
+
+// Marca como impresos todos los registros de un trabajo
+static void mark_printed(const spool_job_t *job)
+{
+    const uint32_t printed = SPOOL_STATE_PRINTED;
+    uint32_t offset = job->offset;
+    uint32_t left = job->length;
+
+    while (left > 0) {
+        spool_rec_t hdr;
+        if (read_header(&offset, &hdr) != ESP_OK || hdr.job_id != job->id) {
+            ESP_LOGE(TAG, "❌ Registro inválido marcando trabajo #%lu", job->id);
+            return;
+        }
+        esp_partition_write(s_spool.part, offset + offsetof(spool_rec_t, state),
+                            &printed, sizeof(printed));
+        left -= hdr.length;
+        offset += rec_size(hdr.length);
+    }
+}
+
+// ============================================
+// REPLAY AL ARRANCAR
+// ============================================
+// Recorre el anillo desde el sector siguiente al más reciente, así los
+// registros salen en orden de escritura, y reconstruye el índice con los
+// trabajos completos que no llegaron a imprimirse.
+static void spool_replay(void)
+{
+    uint32_t head_sector = 0;
+    uint32_t max_seq = 0;
+    bool found = false;
+
+    for (uint32_t s = 0; s < s_spool.sectors; s++) {
+        spool_rec_t hdr;
+        if (esp_partition_read(s_spool.part, s * SPOOL_SECTOR_SIZE, &hdr, SPOOL_HDR_SIZE) == ESP_OK &&
+            hdr.magic == SPOOL_MAGIC && (!found || (int32_t)(hdr.seq - max_seq) > 0)) {
+            max_seq = hdr.seq;
+            head_sector = s;
+            found = true;
+        }
+    }
+
+    // Sin registros: simular el último sector lleno para empezar en el 0
+    s_spool.stage_base = (found ? head_sector : s_spool.sectors - 1) * SPOOL_SECTOR_SIZE;
+    s_spool.head = s_spool.stage_base + SPOOL_SECTOR_SIZE;
+    s_spool.next_seq = 0;
+    s_spool.next_id = 1;
+    if (!found) {
+        s_spool.stage_len = SPOOL_SECTOR_SIZE;
+        s_spool.stage_flushed = SPOOL_SECTOR_SIZE;
+        ESP_LOGI(TAG, "📭 Spool vacío");
+        return;
+    }
+
+    spool_job_t cur = {0};
+    bool in_job = false;
+    bool printed = false;
+    uint32_t dropped = 0;
+
+    for (uint32_t n = 1; n <= s_spool.sectors; n++) {
+        uint32_t s = (head_sector + n) % s_spool.sectors;
+        uint32_t offset = s * SPOOL_SECTOR_SIZE;
+        bool clean = true;
+
+        while (sector_end(offset) - offset >= SPOOL_HDR_SIZE) {
+            spool_rec_t hdr;
+            if (esp_partition_read(s_spool.part, offset, &hdr, SPOOL_HDR_SIZE) != ESP_OK) {
+                clean = false;
+                break;
+            }
+            if (hdr.magic != SPOOL_MAGIC) {
+                clean = (hdr.magic == 0xFFFF);
+                break;
+            }
+            if (hdr.length > SPOOL_MAX_FRAG || offset + rec_size(hdr.length) > sector_end(offset)) {
+                clean = false;
+                break;
+            }
+
+            // Validar el payload por partes con el buffer de lectura
+            uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr, offsetof(spool_rec_t, crc));
+            for (uint32_t pos = 0; pos < hdr.length; pos += SPOOL_READ_CHUNK) {
+                uint32_t k = hdr.length - pos;
+                if (k > SPOOL_READ_CHUNK) {
+                    k = SPOOL_READ_CHUNK;
+                }
+                esp_partition_read(s_spool.part, offset + SPOOL_HDR_SIZE + pos, s_read_buf, k);
+                crc = esp_rom_crc32_le(crc, s_read_buf, k);
+            }
+            if (crc != hdr.crc) {
+                clean = false;
+                break;
+            }
+
+            if ((int32_t)(hdr.seq + 1 - s_spool.next_seq) > 0) {
+                s_spool.next_seq = hdr.seq + 1;
+            }
+            if ((int32_t)(hdr.job_id + 1 - s_spool.next_id) > 0) {
+                s_spool.next_id = hdr.job_id + 1;
+            }
+
+            if (hdr.flags & SPOOL_REC_FIRST) {
+                cur = (spool_job_t){
+                    .id = hdr.job_id,
+                    .offset = offset,
+                    .client = hdr.client,
+                    .prio = hdr.prio < PRINTER_PRIO_COUNT ? hdr.prio : PRINTER_PRIO_NORMAL,
+                };
+                in_job = true;
+                printed = false;
+            } else if (!in_job || hdr.job_id != cur.id) {
+                in_job = false;
+            }
+
+            if (in_job) {
+                cur.length += hdr.length;
+                printed |= (hdr.state != SPOOL_STATE_PENDING);
+                if (hdr.flags & SPOOL_REC_LAST) {
+                    if (!printed) {
+                        if (s_spool.jobs_count < SPOOL_MAX_JOBS) {
+                            cur.state = SPOOL_JOB_QUEUED;
+                            s_spool.jobs[s_spool.jobs_count++] = cur;
+                        } else {
+                            dropped++;
+                        }
+                    }
+                    in_job = false;
+                }
+            }
+            offset += rec_size(hdr.length);
+        }
+
+        if (s == head_sector) {
+            // Un registro cortado por un reinicio deja basura: seguir en el
+            // sector siguiente, que se borra antes de usarse
+            if (clean) {
+                s_spool.head = offset;
+            }
+        }
+    }
+
+    // Lo anterior a head ya está en flash y no se vuelve a escribir
+    s_spool.stage_len = s_spool.head - s_spool.stage_base;
+    s_spool.stage_flushed = s_spool.stage_len;
+
+    ESP_LOGI(TAG, "📂 Spool recuperado: %lu trabajos pendientes, head=0x%lx",
+             s_spool.jobs_count, s_spool.head);
+    if (dropped) {
+        ESP_LOGW(TAG, "⚠️ %lu trabajos no entran en el índice y se descartan", dropped);
+    }
+}
+
+// ============================================
+// TAREA ESCRITORA
+// ============================================
+// Agrupa los envíos que llegan dentro de SPOOL_BATCH_MS en una sola
+// escritura de flash y recién entonces los confirma. También procesa los
+// avisos de fin del driver: solo ella escribe en la partición.
+
+static void handle_done(const spool_done_t *done)
+{
+    xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+    spool_job_t *job = find_job(done->id);
+    spool_job_t copy = {0};
+    bool printed = false;
+
+    if (job) {
+        copy = *job;
+        if (done->ok || ++job->attempts >= SPOOL_MAX_ATTEMPTS) {
+            if (!done->ok) {
+                ESP_LOGE(TAG, "❌ Trabajo #%lu descartado tras %d intentos", job->id, SPOOL_MAX_ATTEMPTS);
+            }
+            job->state = SPOOL_JOB_DONE;
+            printed = true;
+        } else {
+            ESP_LOGW(TAG, "🔁 Trabajo #%lu se reintentará", job->id);
+            job->state = SPOOL_JOB_QUEUED;
+        }
+
+        // Recortar el frente del índice
+        while (s_spool.jobs_count > 0 && s_spool.jobs[s_spool.jobs_first].state == SPOOL_JOB_DONE) {
+            s_spool.jobs_first = (s_spool.jobs_first + 1) % SPOOL_MAX_JOBS;
+            s_spool.jobs_count--;
+        }
+    }
+    s_spool.outstanding--;
+    xSemaphoreGive(s_spool.mutex);
+
+    if (printed) {
+        mark_printed(&copy);
+        notify(copy.tag, done->ok ? PRINT_SPOOL_EV_PRINTED : PRINT_SPOOL_EV_FAILED);
+    } else if (job) {
+        notify(copy.tag, PRINT_SPOOL_EV_STORED);
+    }
+    xTaskNotifyGive(s_spool.feeder_hdl);
+}
+
+static void commit_batch(spool_req_t **batch, int count)
+{
+    esp_err_t ret = stage_flush();
+
+    xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+    for (int i = 0; i < count; i++) {
+        spool_req_t *req = batch[i];
+        if (req->result == ESP_OK && ret != ESP_OK) {
+            req->result = ret;
+        }
+        if (req->result == ESP_OK) {
+            spool_job_t *job = &s_spool.jobs[(s_spool.jobs_first + s_spool.jobs_count) % SPOOL_MAX_JOBS];
+            *job = (spool_job_t){
+                .id = req->id,
+                .offset = req->offset,
+                .length = req->length,
+                .client = req->client,
+                .tag = req->tag,
+                .prio = req->prio,
+                .state = SPOOL_JOB_QUEUED,
+            };
+            s_spool.jobs_count++;
+        }
+    }
+    s_spool.reserved = 0;
+    xSemaphoreGive(s_spool.mutex);
+
+    for (int i = 0; i < count; i++) {
+        spool_req_t *req = batch[i];
+        if (req->done) {
+            xSemaphoreGive(req->done);
+        } else {
+            notify(req->tag, req->result == ESP_OK ? PRINT_SPOOL_EV_STORED : PRINT_SPOOL_EV_FAILED);
+            free(req);
+        }
+    }
+    xTaskNotifyGive(s_spool.feeder_hdl);
+}
+
+static void spool_writer_task(void *arg)
+{
+    spool_req_t *batch[SPOOL_SUBMIT_QUEUE];
+    int count = 0;
+    TickType_t deadline = 0;
+
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+        if (count > 0) {
+            TickType_t now = xTaskGetTickCount();
+            wait = (int32_t)(deadline - now) > 0 ? deadline - now : 0;
+        }
+
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(s_spool.events, wait);
+
+        if (member == s_spool.done_queue) {
+            spool_done_t done;
+            if (xQueueReceive(s_spool.done_queue, &done, 0) == pdTRUE) {
+                handle_done(&done);
+            }
+            continue;
+        }
+
+        if (member == s_spool.submit_queue) {
+            spool_req_t *req;
+            if (xQueueReceive(s_spool.submit_queue, &req, 0) != pdTRUE) {
+                continue;
+            }
+
+            // Reservar lugar en el índice antes de tocar la flash
+            xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+            bool room = s_spool.jobs_count + s_spool.reserved < SPOOL_MAX_JOBS;
+            if (room) {
+                s_spool.reserved++;
+            }
+            xSemaphoreGive(s_spool.mutex);
+
+            req->id = s_spool.next_id++;
+            req->result = room ? append_job(req, &req->offset) : ESP_ERR_NO_MEM;
+            if (req->result == ESP_ERR_NO_MEM) {
+                ESP_LOGW(TAG, "⚠️ Spool lleno, trabajo rechazado");
+            }
+
+            if (count == 0) {
+                deadline = xTaskGetTickCount() + pdMS_TO_TICKS(SPOOL_BATCH_MS);
+            }
+            batch[count++] = req;
+            if (count < SPOOL_SUBMIT_QUEUE) {
+                continue;
+            }
+        }
+
+        if (count > 0) {
+            commit_batch(batch, count);
+            count = 0;
+        }
+    }
+}
+
+// ============================================
+// TAREA ALIMENTADORA
+// ============================================
+// Entrega al driver los trabajos pendientes por carril y, dentro de cada
+// carril, alternando entre clientes (el más viejo si empatan), sin pasar de
+// SPOOL_MAX_OUTSTANDING, y solo cuando hay una impresora lista. Un trabajo
+// sigue en el log hasta que el driver confirma que salió completo.
+
+static void spool_job_done(uint32_t job_id, bool ok, void *arg)
+{
+    spool_done_t done = {
+        .id = (uint32_t)(uintptr_t)arg,
+        .ok = ok,
+    };
+    // Nunca se llena: hay lugar para todos los trabajos entregados
+    xQueueSend(s_spool.done_queue, &done, 0);
+}
+
+// Devuelve error solo si el driver no abrió el trabajo. Una vez abierto, el
+// aviso de fin llega siempre (ok=false si algo falló) y es el único lugar
+// que descuenta outstanding.
+static esp_err_t stream_job(const spool_job_t *sj)
+{
+    printer_job_t *job;
+    esp_err_t ret = printer_job_open(&job);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    printer_job_set_done_cb(job, spool_job_done, (void *)(uintptr_t)sj->id);
+    printer_job_set_class(job, sj->prio, sj->client);
+
+    uint32_t offset = sj->offset;
+    uint32_t left = sj->length;
+    while (left > 0 && ret == ESP_OK) {
+        spool_rec_t hdr;
+        ret = read_header(&offset, &hdr);
+        if (ret == ESP_OK && hdr.job_id != sj->id) {
+            ret = ESP_ERR_INVALID_CRC;
+        }
+
+        uint32_t pos = offset + SPOOL_HDR_SIZE;
+        uint32_t n = (ret == ESP_OK) ? hdr.length : 0;
+        while (n > 0 && ret == ESP_OK) {
+            uint32_t k = n < SPOOL_READ_CHUNK ? n : SPOOL_READ_CHUNK;
+            ret = esp_partition_read(s_spool.part, pos, s_read_buf, k);
+            if (ret == ESP_OK) {
+                ret = printer_job_write(job, s_read_buf, k);
+            }
+            pos += k;
+            n -= k;
+        }
+
+        if (ret == ESP_OK) {
+            left -= hdr.length;
+            offset += rec_size(hdr.length);
+        }
+    }
+
+    if (ret != ESP_OK) {
+        // El aviso de fin llega con ok=false y el trabajo se reintenta
+        ESP_LOGE(TAG, "❌ Error enviando trabajo #%lu: %s", sj->id, esp_err_to_name(ret));
+        printer_job_abort(job);
+        return ESP_OK;
+    }
+
+    // Si el cierre falla el driver ya abortó el trabajo y avisó con ok=false:
+    // handle_done lo descuenta y lo reintenta, acá no hay nada más que hacer
+    ret = printer_job_close(job);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error cerrando trabajo #%lu: %s", sj->id, esp_err_to_name(ret));
+    }
+    return ESP_OK;
+}
+
+static void spool_feeder_task(void *arg)
+{
+    while (1) {
+        spool_job_t next;
+        bool found = false;
+
+        xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+        if (s_spool.outstanding < SPOOL_MAX_OUTSTANDING) {
+            uint32_t best_rank = 0;
+            for (uint32_t i = 0; i < s_spool.jobs_count; i++) {
+                spool_job_t *job = &s_spool.jobs[(s_spool.jobs_first + i) % SPOOL_MAX_JOBS];
+                if (job->state != SPOOL_JOB_QUEUED) {
+                    continue;
+                }
+                uint32_t rank = print_sched_rank(&s_spool.sched, job->client);
+                if (!found || job->prio < next.prio || (job->prio == next.prio && rank < best_rank)) {
+                    next = *job;
+                    best_rank = rank;
+                    found = true;
+                }
+            }
+        }
+        xSemaphoreGive(s_spool.mutex);
+
+        if (!found) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Sin impresora los trabajos esperan en flash, no en RAM
+        if (!printer_wait_ready(SPOOL_READY_WAIT_MS)) {
+            continue;
+        }
+
+        xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+        spool_job_t *job = find_job(next.id);
+        if (job) {
+            job->state = SPOOL_JOB_SENDING;
+        }
+        s_spool.outstanding++;
+        print_sched_served(&s_spool.sched, next.client);
+        xSemaphoreGive(s_spool.mutex);
+
+        // Antes de entregarlo: el aviso de fin puede llegar enseguida
+        notify(next.tag, PRINT_SPOOL_EV_PRINTING);
+        esp_err_t ret = stream_job(&next);
+        if (ret != ESP_OK) {
+            // No se pudo abrir el trabajo: sin aviso de fin, reintentar luego
+            xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+            job = find_job(next.id);
+            if (job) {
+                job->state = SPOOL_JOB_QUEUED;
+            }
+            s_spool.outstanding--;
+            xSemaphoreGive(s_spool.mutex);
+            notify(next.tag, PRINT_SPOOL_EV_STORED);
+            vTaskDelay(pdMS_TO_TICKS(100));
+        } else {
+            ESP_LOGI(TAG, "🖨️ Trabajo #%lu entregado a la impresora (%lu bytes)", next.id, next.length);
+        }
+    }
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+esp_err_t print_spool_init(void)
+{
+    if (s_spool.active) {
+        return ESP_OK;
+    }
+
+    s_spool.part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                            ESP_PARTITION_SUBTYPE_ANY,
+                                            SPOOL_PARTITION_LABEL);
+    if (!s_spool.part) {
+        ESP_LOGW(TAG, "⚠️ Partición '%s' no encontrada, spool deshabilitado", SPOOL_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_spool.sectors = s_spool.part->size / SPOOL_SECTOR_SIZE;
+
+    s_spool.mutex = xSemaphoreCreateMutex();
+    s_spool.submit_queue = xQueueCreate(SPOOL_SUBMIT_QUEUE, sizeof(spool_req_t *));
+    s_spool.done_queue = xQueueCreate(SPOOL_MAX_OUTSTANDING, sizeof(spool_done_t));
+    s_spool.events = xQueueCreateSet(SPOOL_SUBMIT_QUEUE + SPOOL_MAX_OUTSTANDING);
+    if (!s_spool.mutex || !s_spool.submit_queue || !s_spool.done_queue || !s_spool.events) {
+        ESP_LOGE(TAG, "❌ Error creando colas del spool");
+        return ESP_ERR_NO_MEM;
+    }
+    xQueueAddToSet(s_spool.submit_queue, s_spool.events);
+    xQueueAddToSet(s_spool.done_queue, s_spool.events);
+
+    spool_replay();
+
+    if (xTaskCreate(spool_writer_task, "spool_wr", 4 * 1024, NULL, 5, &s_spool.writer_hdl) != pdPASS ||
+        xTaskCreate(spool_feeder_task, "spool_feed", 3 * 1024, NULL, 4, &s_spool.feeder_hdl) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Error creando tareas del spool");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_spool.active = true;
+    ESP_LOGI(TAG, "✅ Spool activo en '%s' (%lu KB)", SPOOL_PARTITION_LABEL, s_spool.part->size / 1024);
+    return ESP_OK;
+}
+
+static void direct_job_done(uint32_t job_id, bool ok, void *arg)
+{
+    notify((uint32_t)(uintptr_t)arg, ok ? PRINT_SPOOL_EV_PRINTED : PRINT_SPOOL_EV_FAILED);
+}
+
+// Sin spool el trabajo va directo al driver (puede esperar por buffers)
+static esp_err_t submit_direct(const uint8_t *data, size_t length, printer_prio_t prio,
+                               uint32_t client, uint32_t tag)
+{
+    printer_job_t *job;
+    esp_err_t ret = printer_job_open(&job);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (tag != 0) {
+        printer_job_set_done_cb(job, direct_job_done, (void *)(uintptr_t)tag);
+        notify(tag, PRINT_SPOOL_EV_PRINTING);
+    }
+    printer_job_set_class(job, prio, client);
+    ret = printer_job_write(job, data, length);
+    if (ret != ESP_OK) {
+        printer_job_abort(job);
+        return ret;
+    }
+    return printer_job_close(job);
+}
+
+// Un lote completo debe entrar en el anillo dejando libre el sector que se
+// borra
+static inline size_t max_job_length(void)
+{
+    return (s_spool.sectors - 2) * SPOOL_MAX_FRAG / SPOOL_SUBMIT_QUEUE;
+}
+
+esp_err_t print_spool_submit(const uint8_t *data, size_t length, printer_prio_t prio,
+                             uint32_t client, uint32_t *out_id)
+{
+    if (!data || length == 0 || prio < 0 || prio >= PRINTER_PRIO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!s_spool.active) {
+        return submit_direct(data, length, prio, client, 0);
+    }
+
+    if (length > max_job_length()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    StaticSemaphore_t done_buf;
+    spool_req_t req = {
+        .data = data,
+        .length = length,
+        .prio = prio,
+        .client = client,
+        .done = xSemaphoreCreateBinaryStatic(&done_buf),
+    };
+    spool_req_t *req_ptr = &req;
+
+    if (xQueueSend(s_spool.submit_queue, &req_ptr, pdMS_TO_TICKS(SPOOL_SUBMIT_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG, "❌ Escritor del spool ocupado");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // Una vez encolado, la tarea escritora usa req hasta confirmarlo
+    xSemaphoreTake(req.done, portMAX_DELAY);
+
+    if (req.result == ESP_OK && out_id) {
+        *out_id = req.id;
+    }
+    return req.result;
+}
+
+esp_err_t print_spool_submit_async(const uint8_t *data, size_t length, printer_prio_t prio,
+                                   uint32_t client, uint32_t tag)
+{
+    if (!data || length == 0 || prio < 0 || prio >= PRINTER_PRIO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!s_spool.active) {
+        return submit_direct(data, length, prio, client, tag);
+    }
+
+    if (length > max_job_length()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // La copia viaja pegada al pedido; el escritor libera los dos juntos
+    spool_req_t *req = malloc(sizeof(*req) + length);
+    if (!req) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(req + 1, data, length);
+    *req = (spool_req_t){
+        .data = (const uint8_t *)(req + 1),
+        .length = length,
+        .prio = prio,
+        .client = client,
+        .tag = tag,
+    };
+
+    // Sin esperar: con el escritor atrasado se rechaza y el cliente reintenta
+    if (xQueueSend(s_spool.submit_queue, &req, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "⚠️ Escritor del spool ocupado, envío rechazado");
+        free(req);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+void print_spool_set_listener(print_spool_listener_t listener)
+{
+    s_listener = listener;
+}
+
+uint32_t print_spool_pending(void)
+{
+    if (!s_spool.active) {
+        return 0;
+    }
+
+    uint32_t pending = 0;
+    xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < s_spool.jobs_count; i++) {
+        if (s_spool.jobs[(s_spool.jobs_first + i) % SPOOL_MAX_JOBS].state != SPOOL_JOB_DONE) {
+            pending++;
+        }
+    }
+    xSemaphoreGive(s_spool.mutex);
+    return pending;
+}
+
+uint32_t print_spool_pending_lane(printer_prio_t prio)
+{
+    if (!s_spool.active) {
+        return 0;
+    }
+
+    uint32_t pending = 0;
+    xSemaphoreTake(s_spool.mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < s_spool.jobs_count; i++) {
+        const spool_job_t *job = &s_spool.jobs[(s_spool.jobs_first + i) % SPOOL_MAX_JOBS];
+        if (job->state == SPOOL_JOB_QUEUED && job->prio <= prio) {
+            pending++;
+        }
+    }
+    xSemaphoreGive(s_spool.mutex);
+    return pending;
+}
+
+bool print_spool_is_active(void)
+{
+    return s_spool.active;
+}
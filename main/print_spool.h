@@ -0,0 +1,144 @@
+/**
+ * @file print_spool.h
+ * @brief Flash-backed print spool
+ *
+ * Keeps print jobs in an append-only log on the "storage" data partition so
+ * they survive reboots and printer disconnects. Jobs are acknowledged once
+ * they are durable and are only removed from the log after the printer has
+ * accepted every byte.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "printer_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Progress of a job submitted with print_spool_submit_async()
+ */
+typedef enum {
+    PRINT_SPOOL_EV_STORED,       ///< Durable in flash and waiting (again, after a failed attempt)
+    PRINT_SPOOL_EV_PRINTING,     ///< Handed to the printer driver
+    PRINT_SPOOL_EV_PRINTED,      ///< The printer accepted every byte
+    PRINT_SPOOL_EV_FAILED,       ///< Not stored, or dropped after the last attempt
+} print_spool_event_t;
+
+/**
+ * @brief Job progress listener
+ *
+ * Runs in a spool or driver task: it must not block.
+ *
+ * @param tag Tag given to print_spool_submit_async()
+ * @param event What happened to the job
+ */
+typedef void (*print_spool_listener_t)(uint32_t tag, print_spool_event_t event);
+
+/**
+ * @brief Initialize the spool and replay pending jobs
+ *
+ * Mounts the "storage" partition, rebuilds the job index from the log and
+ * starts the writer and feeder tasks. Jobs left over from a previous boot
+ * are printed as soon as a printer is ready. Call after printer_init().
+ *
+ * @return esp_err_t
+ *         - ESP_OK: Spool ready
+ *         - ESP_ERR_NOT_FOUND: No "storage" partition in the partition table
+ *         - ESP_ERR_NO_MEM: Could not create tasks or queues
+ */
+esp_err_t print_spool_init(void);
+
+/**
+ * @brief Store a print job
+ *
+ * Appends the job to the log and blocks until it is durable in flash.
+ * Several concurrent submissions are committed in one batch. The printer
+ * does not need to be connected.
+ *
+ * Pending jobs are printed lane by lane (see printer_prio_t) and, within a
+ * lane, round-robin across clients.
+ *
+ * If the spool is not initialized the job is handed straight to the driver.
+ *
+ * @param data Raw ESC/POS data
+ * @param length Length of data in bytes
+ * @param prio Priority lane
+ * @param client Opaque client key for fairness (e.g. web_client_id())
+ * @param[out] out_id Spool job number (optional, may be NULL)
+ * @return esp_err_t
+ *         - ESP_OK: Job stored
+ *         - ESP_ERR_INVALID_ARG: Invalid parameters or lane
+ *         - ESP_ERR_INVALID_SIZE: Job larger than the spool
+ *         - ESP_ERR_NO_MEM: Spool full
+ *         - ESP_FAIL: Flash write error
+ */
+esp_err_t print_spool_submit(const uint8_t *data, size_t length, printer_prio_t prio,
+                             uint32_t client, uint32_t *out_id);
+
+/**
+ * @brief Store a print job without waiting for the flash
+ *
+ * Copies the data and hands it to the spool writer, then returns at once.
+ * The result is reported to the listener under the given tag: STORED (or
+ * FAILED) when the batch is committed, then PRINTING and PRINTED or
+ * FAILED as the printer takes it. Meant for HTTP handlers, which must not
+ * wait on the flash or the printer.
+ *
+ * If the spool is not initialized the job is handed straight to the driver
+ * as in print_spool_submit(), which may wait for transfer buffers.
+ *
+ * @param data Raw ESC/POS data (copied)
+ * @param length Length of data in bytes
+ * @param prio Priority lane
+ * @param client Opaque client key for fairness (e.g. web_client_id())
+ * @param tag Non-zero key for the listener, or 0 for no events. Jobs
+ *            replayed after a reboot have no tag.
+ * @return esp_err_t
+ *         - ESP_OK: Job accepted (not yet durable)
+ *         - ESP_ERR_INVALID_ARG: Invalid parameters or lane
+ *         - ESP_ERR_INVALID_SIZE: Job larger than the spool
+ *         - ESP_ERR_NO_MEM: No memory for the copy
+ *         - ESP_ERR_TIMEOUT: Spool writer busy; try again later
+ */
+esp_err_t print_spool_submit_async(const uint8_t *data, size_t length, printer_prio_t prio,
+                                   uint32_t client, uint32_t tag);
+
+/**
+ * @brief Set the listener for tagged jobs
+ *
+ * @param listener Callback, or NULL to stop the events
+ */
+void print_spool_set_listener(print_spool_listener_t listener);
+
+/**
+ * @brief Number of jobs stored and not yet printed
+ *
+ * @return Pending job count (0 if the spool is not initialized)
+ */
+uint32_t print_spool_pending(void);
+
+/**
+ * @brief Number of stored jobs that will be printed before a new job of a lane
+ *
+ * @param prio Lane of the new job
+ * @return Jobs waiting in that lane and in higher ones (0 if the spool is
+ *         not initialized)
+ */
+uint32_t print_spool_pending_lane(printer_prio_t prio);
+
+/**
+ * @brief Check if the spool is backed by flash
+ *
+ * @return true print_spool_init() succeeded
+ */
+bool print_spool_is_active(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,141 @@
+#include "print_upload.h"
+#include "printer_driver.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "PRINT_UPLOAD";
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define UPLOAD_RECV_RETRIES       5
+#define UPLOAD_CHUNK_WAIT_MS      1000  // Espera por buffer antes de volver a intentar
+#define UPLOAD_STALL_TIMEOUT_MS   30000 // Impresora sin avanzar: se corta la subida
+#define UPLOAD_RETRY_AFTER        "5"   // Segundos sugeridos al rechazar por ocupado
+
+// ============================================
+// RESPUESTAS
+// ============================================
+
+static esp_err_t send_error(httpd_req_t *req, const char *status, const char *msg)
+{
+    char json[96];
+    int len = snprintf(json, sizeof(json), "{\"ok\":false,\"error\":\"%s\"}", msg);
+
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    if (strncmp(status, "503", 3) == 0) {
+        httpd_resp_set_hdr(req, "Retry-After", UPLOAD_RETRY_AFTER);
+    }
+    return httpd_resp_send(req, json, len);
+}
+
+// ============================================
+// STREAMING
+// ============================================
+
+// Recibe el cuerpo directo en los chunks del trabajo. Mientras la impresora
+// no libera buffers no se lee el socket: TCP frena al cliente. Corre en
+// web_worker (ver web_defer()).
+static esp_err_t stream_upload(httpd_req_t *req)
+{
+    printer_job_t *job = NULL;
+    size_t remaining = req->content_len;
+    esp_err_t ret = printer_job_open(&job);
+
+    if (ret != ESP_OK) {
+        return send_error(req, "503 Service Unavailable", "cola de impresion llena");
+    }
+    printer_job_set_class(job, PRINTER_PRIO_NORMAL, web_client_id(req));
+    printer_job_set_optimize(job, false);
+    uint32_t job_id = printer_job_get_id(job);
+
+    ESP_LOGI(TAG, "📥 Trabajo #%lu: recibiendo %u bytes", job_id, req->content_len);
+
+    int retries = 0;
+    while (remaining > 0) {
+        uint8_t *buf;
+        size_t space;
+        uint32_t stalled_ms = 0;
+        do {
+            ret = printer_job_get_buffer(job, UPLOAD_CHUNK_WAIT_MS, &buf, &space);
+            stalled_ms += UPLOAD_CHUNK_WAIT_MS;
+        } while (ret == ESP_ERR_TIMEOUT && stalled_ms < UPLOAD_STALL_TIMEOUT_MS);
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        int n = httpd_req_recv(req, (char *)buf, space < remaining ? space : remaining);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++retries < UPLOAD_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            ret = ESP_FAIL;
+            break;
+        }
+        retries = 0;
+        printer_job_commit(job, n);
+        remaining -= n;
+    }
+
+    // Un ticket a medias no se imprime (salvo lo que ya salió por USB)
+    if (ret != ESP_OK) {
+        printer_job_abort(job);
+        ESP_LOGE(TAG, "❌ Trabajo #%lu cortado a %u/%u bytes: %s", job_id,
+                 req->content_len - remaining, req->content_len, esp_err_to_name(ret));
+        if (ret == ESP_ERR_TIMEOUT) {
+            return send_error(req, "503 Service Unavailable", "impresora sin avanzar");
+        }
+        return send_error(req, "400 Bad Request", "cuerpo incompleto");
+    }
+
+    ret = printer_job_close(job);
+    if (ret != ESP_OK) {
+        return send_error(req, "500 Internal Server Error", esp_err_to_name(ret));
+    }
+
+    ESP_LOGI(TAG, "✅ Trabajo #%lu encolado (%u bytes)", job_id, req->content_len);
+
+    char json[64];
+    int len = snprintf(json, sizeof(json), "{\"ok\":true,\"job\":%lu,\"bytes\":%u}",
+                       job_id, req->content_len);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// ============================================
+// HANDLER HTTP
+// ============================================
+
+static esp_err_t print_post_handler(httpd_req_t *req)
+{
+    if (req->content_len == 0) {
+        return send_error(req, "400 Bad Request", "cuerpo vacio");
+    }
+    if (!printer_is_ready()) {
+        return send_error(req, "503 Service Unavailable", "impresora no lista");
+    }
+
+    // Una subida en curso y otra esperando (compartido con /print_image)
+    esp_err_t ret = web_defer(req, stream_upload);
+    if (ret == ESP_ERR_TIMEOUT) {
+        return send_error(req, "503 Service Unavailable", "otra impresion en curso");
+    }
+    if (ret != ESP_OK) {
+        return send_error(req, "500 Internal Server Error", "sin memoria");
+    }
+    return ESP_OK;
+}
+
+esp_err_t print_upload_register(httpd_handle_t server)
+{
+    httpd_uri_t print_uri = {
+        .uri = "/print",
+        .method = HTTP_POST,
+        .handler = print_post_handler,
+        .user_ctx = NULL
+    };
+    return httpd_register_uri_handler(server, &print_uri);
+}
@@ -0,0 +1,38 @@
+/**
+ * @file print_upload.h
+ * @brief Raw HTTP print endpoint
+ *
+ * `POST /print` takes an application/octet-stream body of ESC/POS bytes of
+ * any size and streams it into a print job as it arrives, for integrations
+ * that render tickets server-side. The body is received straight into the
+ * driver's transfer buffers, so RAM use does not depend on the payload size.
+ *
+ * The upload runs on the web worker task as an async httpd request (see
+ * web_defer()), so the HTTP server keeps serving other clients while a slow
+ * printer throttles the upload. One upload (this or `/print_image`) is
+ * streamed at a time and one more may wait for it; further ones get
+ * `503 Service Unavailable` with `Retry-After`.
+ *
+ * Responses are JSON: `{"ok":true,"job":<id>,"bytes":<n>}` on success.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register `POST /print`
+ *
+ * @param server Running HTTP server
+ * @return esp_err_t Result of httpd_register_uri_handler()
+ */
+esp_err_t print_upload_register(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
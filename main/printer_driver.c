@@ -4,7 +4,10 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "usb/usb_host.h"
+#include "print_sched.h"
+#include "escpos_opt.h"
 #include <string.h>
 
 static const char *TAG = "PRINTER";
@@ -14,35 +17,163 @@ static const char *TAG = "PRINTER";
 #define CLASS_TASK_PRIORITY       3     // Mismo que el código que funciona
 #define PRINTER_INTERFACE_CLASS   0x07
 #define PRINTER_VENDOR_CLASS      0xFF
-#define PRINTER_INTERFACE_NUMBER  0
-#define PRINTER_ENDPOINT_OUT      0x01
 
 #define PRINT_QUEUE_SIZE          10
-#define PRINT_BUFFER_SIZE         512
+#define PRINT_BUFFER_SIZE         512   // Tamaño de chunk (múltiplo de cualquier MPS bulk válido)
+#define PRINT_CHUNK_COUNT         16    // Chunks de la arena (16 * 512 = 8 KB)
+#define PRINT_CHUNK_TIMEOUT_MS    1000  // Espera máxima por un chunk libre
+#define PRINTER_MAX_INFLIGHT      3     // Transferencias bulk OUT en vuelo por impresora (2 = doble buffer)
+#define PRINTER_XFER_TIMEOUT_MS   5000
+#define PRINTER_XFER_MAX_SIZE     2048  // Tope de una transferencia bulk OUT (varios chunks)
+#define PRINTER_COALESCE_LINGER_MS 10   // Espera por más datos antes de enviar una transferencia a medio llenar
+#define PRINTER_DEV_BACKLOG       2     // Trabajos asignados por impresora (en curso + siguiente)
+#define PRINTER_OPTIMIZE_DEFAULT  true  // Pasar los trabajos por el optimizador ESC/POS
+#define PRINTER_DONE_SLOTS        16    // Trabajos esperando sus últimas transferencias (ver dev_job_done_notify)
+#define PRINTER_DONE_WAIT_MS      10    // Reintento mientras los avisos de fin están llenos
+#define PRINTER_JOB_MS_DEFAULT    2000  // Duración estimada de un trabajo antes de medir
 #define CLIENT_NUM_EVENT_MSG      5
+#define STATUS_TASK_PRIORITY      1     // Consulta de estado, por debajo de todo el resto
+#define PRINTER_STATUS_POLL_MS    1000  // Período de consulta de estado
+#define PRINTER_STATUS_TIMEOUT_MS 200   // Espera máxima de una respuesta de estado
 
-// Estructura de trabajo de impresión
-typedef struct {
-    uint8_t data[PRINT_BUFFER_SIZE];
+// Petición de clase USB Printer y bits de su respuesta
+#define USB_PRINTER_GET_PORT_STATUS 1
+#define PORT_STATUS_PAPER_EMPTY   (1 << 5)
+#define PORT_STATUS_SELECT        (1 << 4)
+#define PORT_STATUS_NOT_ERROR     (1 << 3)
+
+// Bits del event group del driver
+#define PRINTER_EVT_READY         (1 << 0) // Al menos una impresora reclamada y lista
+#define PRINTER_EVT_IDLE          (1 << 1) // Sin trabajos pendientes ni transferencias en vuelo
+#define PRINTER_EVT_SLOT          (1 << 2) // Alguna impresora liberó capacidad para el dispatcher
+#define PRINTER_EVT_DEV_READY(i)  (1 << (8 + (i))) // Impresora i lista
+#define PRINTER_EVT_DEV_OK(i)     (1 << (16 + (i))) // Impresora i sin error de estado
+
+// Chunk de datos de un trabajo.
+// Los chunks viven en una arena preasignada y se pasan por propiedad:
+// el productor escribe los bytes una única vez, la tarea de impresión los
+// envía y el callback de transferencia los devuelve a la lista libre.
+typedef struct print_chunk {
+    struct print_chunk *next;
     size_t length;
-} print_job_t;
+    uint8_t data[PRINT_BUFFER_SIZE];
+} print_chunk_t;
+
+// Trabajo de impresión: una secuencia ordenada de chunks que la cola trata
+// como una unidad. La tarea de impresión empieza a transmitir en cuanto se
+// publica el primer chunk, aunque el productor no haya cerrado el trabajo.
+struct printer_job {
+    uint32_t id;
+    print_chunk_t *fill;    // Chunk que está llenando el productor
+    print_chunk_t *head;    // Chunks completos pendientes de envío (FIFO)
+    print_chunk_t *tail;
+    TaskHandle_t worker;    // Tarea de la impresora que lo está drenando
+    struct printer_job *next; // Siguiente en su carril (bajo job_lock)
+    printer_prio_t prio;
+    uint32_t client;
+    printer_job_done_cb_t done_cb;
+    void *done_arg;
+    size_t total;
+    escpos_opt_t opt;       // Optimizador del flujo (si optimize)
+    bool optimize;
+    bool queued;
+    bool closed;
+    bool aborted;
+};
+typedef struct printer_job print_job_t;
+
+// Aviso de fin de trabajo pendiente de que el endpoint complete la
+// transferencia número last_xfer de la impresora
+typedef struct {
+    uint32_t first_xfer;
+    uint32_t last_xfer;
+    printer_job_done_cb_t cb;
+    void *arg;
+    uint32_t job_id;
+    bool ok;
+} job_done_t;
+
+// Transferencia de consulta de estado: el callback marca done y despierta
+// a la tarea de estado
+typedef struct {
+    TaskHandle_t task;
+    volatile bool done;
+} status_xfer_t;
+
+// Impresora reclamada. Cada una tiene su propio pool de transferencias,
+// su cola de trabajos asignados y una tarea que los transmite.
+typedef struct {
+    int index;
+    usb_device_handle_t dev_hdl;    // NULL si el slot está libre
+    uint8_t dev_addr;
+    uint16_t vid;
+    uint16_t pid;
+    uint8_t intf_num;               // Interfaz reclamada
+    uint8_t ep_out;                 // Endpoint bulk OUT real
+    uint8_t ep_in;                  // Endpoint bulk IN (0 si no tiene)
+    uint16_t mps_out;               // wMaxPacketSize del bulk OUT
+    uint16_t mps_in;                // wMaxPacketSize del bulk IN
+    size_t xfer_size;               // Tamaño de transferencia, múltiplo de mps_out
+    usb_transfer_t *xfer_pool[PRINTER_MAX_INFLIGHT]; // Transferencias vigentes
+    QueueHandle_t xfer_free;        // usb_transfer_t* libres (NULL = despertar por desconexión)
+    QueueHandle_t job_queue;        // print_job_t* asignados por el dispatcher
+    TaskHandle_t task_hdl;
+    uint32_t assigned;              // Trabajos asignados sin terminar (bajo job_lock)
+    uint32_t inflight;              // Transferencias en vuelo (bajo job_lock)
+    uint32_t xfer_submitted;        // Transferencias enviadas desde el arranque (bajo job_lock)
+    uint32_t xfer_completed;        // Transferencias completadas, en orden FIFO (bajo job_lock)
+    uint32_t xfer_error_seq;        // Número de la última transferencia fallida (bajo job_lock)
+    usb_transfer_t *coalesce;       // Transferencia a medio llenar (solo la tarea de la impresora)
+    size_t coalesce_len;
+    job_done_t done[PRINTER_DONE_SLOTS]; // Avisos de fin pendientes, en orden (bajo job_lock)
+    uint8_t done_head;
+    uint8_t done_count;
+    bool polling;                   // Consulta DLE EOT en curso (bajo job_lock)
+    usb_transfer_t *status_in;      // Transferencia bulk IN de la tarea de estado
+    status_xfer_t status_in_ctx;
+    printer_status_t status;        // Último estado leído (bajo mutex)
+    bool rt_fault;                  // Error según la última consulta DLE EOT
+    uint32_t jobs_done;
+    uint32_t jobs_failed;
+    uint32_t bytes_sent;
+    uint32_t xfer_errors;
+} printer_dev_t;
 
 // Estructura del driver
 typedef struct {
     usb_host_client_handle_t client_hdl;
-    usb_device_handle_t dev_hdl;
-    uint8_t dev_addr;
-    bool printer_ready;
-    QueueHandle_t print_queue;
-    SemaphoreHandle_t mutex;
+    printer_dev_t devs[PRINTER_MAX_DEVICES];
+    EventGroupHandle_t events;      // PRINTER_EVT_*
+    print_job_t *lane_head[PRINTER_PRIO_COUNT]; // Trabajos pendientes de asignar (bajo job_lock)
+    print_job_t *lane_tail[PRINTER_PRIO_COUNT];
+    uint32_t lane_count[PRINTER_PRIO_COUNT];
+    SemaphoreHandle_t lane_sem;     // Cuenta los trabajos en los carriles
+    print_sched_t sched;            // Round-robin entre clientes (bajo job_lock)
+    uint32_t avg_job_ms;            // Media móvil de la duración de un trabajo (bajo job_lock)
+    QueueHandle_t free_jobs;        // print_job_t* libres
+    QueueHandle_t free_chunks;      // print_chunk_t* libres de la arena
+    portMUX_TYPE job_lock;          // Protege listas de chunks y contadores
+    uint32_t next_job_id;
+    bool optimize;                  // Valor de optimize para los trabajos nuevos
+    uint32_t opt_bytes_in;          // Bytes recibidos por el optimizador (bajo job_lock)
+    uint32_t opt_bytes_saved;       // Bytes que el optimizador no envió (bajo job_lock)
+    uint32_t jobs_pending;          // Trabajos encolados o en envío (bajo job_lock)
+    uint32_t inflight;              // Transferencias enviadas al host (bajo job_lock)
+    SemaphoreHandle_t mutex;        // Protege los slots de impresora y sus pools
     TaskHandle_t usb_host_task_hdl;
     TaskHandle_t client_task_hdl;
-    TaskHandle_t print_task_hdl;
+    TaskHandle_t print_task_hdl;    // Dispatcher
+    TaskHandle_t status_task_hdl;
     bool initialized;
     bool stop_usb_host;
 } printer_driver_t;
 
-static printer_driver_t s_printer = {0};
+static printer_driver_t s_printer = {
+    .job_lock = portMUX_INITIALIZER_UNLOCKED,
+    .optimize = PRINTER_OPTIMIZE_DEFAULT,
+};
+static print_job_t s_job_pool[PRINT_QUEUE_SIZE];
+static print_chunk_t s_chunk_arena[PRINT_CHUNK_COUNT];
 
 // ============================================
 // PROTOTIPOS INTERNOS
@@ -50,51 +181,296 @@ static printer_driver_t s_printer = {0};
 static void usb_host_lib_task(void *arg);
 static void client_task(void *arg);
 static void printer_process_task(void *arg);
+static void printer_worker_task(void *arg);
+static void printer_status_task(void *arg);
 static void client_event_callback(const usb_host_client_event_msg_t *event_msg, void *arg);
 static void transfer_callback(usb_transfer_t *transfer);
-static esp_err_t open_printer_device(uint8_t dev_addr);
-static esp_err_t send_to_usb_printer(const uint8_t *data, size_t length);
+static esp_err_t open_printer_device(printer_dev_t *dev, uint8_t dev_addr);
+static void close_printer_device(printer_dev_t *dev);
+static esp_err_t send_to_usb_printer(printer_dev_t *dev, usb_transfer_t *transfer, size_t length);
+static esp_err_t xfer_pool_alloc(printer_dev_t *dev, size_t xfer_size);
+static void xfer_pool_retire(printer_dev_t *dev);
+static usb_transfer_t *xfer_get(printer_dev_t *dev, TickType_t wait);
+static void xfer_put(printer_dev_t *dev, usb_transfer_t *transfer);
+static void job_publish_chunk(print_job_t *job, bool close);
+static void job_release(print_job_t *job);
+static esp_err_t job_append(void *ctx, const uint8_t *data, size_t length);
+static void update_idle(printer_dev_t *dev, int jobs_delta, int inflight_delta);
+static void update_ready_bits(void);
+static void dev_xfer_completed(printer_dev_t *dev, bool ok);
+static void coalesce_flush(printer_dev_t *dev);
+
 
 // ============================================
 // CALLBACK DE TRANSFERENCIA USB
 // ============================================
 static void transfer_callback(usb_transfer_t *transfer)
 {
+    printer_dev_t *dev = (printer_dev_t *)transfer->context;
+    
     if (transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
-        ESP_LOGE(TAG, "Transfer failed, status: %d", transfer->status);
+        ESP_LOGE(TAG, "Transfer failed on printer %d, status: %d", dev->index, transfer->status);
+        dev->xfer_errors++;
+    }
+    
+    // Devolver la transferencia al pool. La tarea de la impresora (más
+    // prioritaria) se despierta y vuelve a llenar el pipeline antes de que
+    // se vacíe la cola del endpoint.
+    xfer_put(dev, transfer);
+    update_idle(dev, 0, -1);
+    dev_xfer_completed(dev, transfer->status == USB_TRANSFER_STATUS_COMPLETED);
+}
+
+// Cuenta una transferencia completada y dispara los avisos de fin de los
+// trabajos cuya última transferencia ya salió. El endpoint bulk completa en
+// orden, así que basta con comparar contadores.
+static void dev_xfer_completed(printer_dev_t *dev, bool ok)
+{
+    job_done_t fired[PRINTER_DONE_SLOTS];
+    int n = 0;
+    
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    dev->xfer_completed++;
+    if (!ok) {
+        dev->xfer_error_seq = dev->xfer_completed;
+    }
+    while (dev->done_count > 0) {
+        job_done_t *entry = &dev->done[dev->done_head];
+        if ((int32_t)(dev->xfer_completed - entry->last_xfer) < 0) {
+            break;
+        }
+        if ((int32_t)(dev->xfer_error_seq - entry->first_xfer) > 0 &&
+            (int32_t)(dev->xfer_error_seq - entry->last_xfer) <= 0) {
+            entry->ok = false;
+        }
+        fired[n++] = *entry;
+        dev->done_head = (dev->done_head + 1) % PRINTER_DONE_SLOTS;
+        dev->done_count--;
+    }
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    for (int i = 0; i < n; i++) {
+        fired[i].cb(fired[i].job_id, fired[i].ok, fired[i].arg);
+    }
+}
+
+// Registra el aviso de fin de un trabajo cuyas transferencias son las
+// números (first_xfer, last_xfer]. Si ya completaron, avisa enseguida.
+// Solo desde la tarea de la impresora (puede enviar su transferencia en curso).
+static void dev_job_done_notify(printer_dev_t *dev, print_job_t *job,
+                                uint32_t first_xfer, uint32_t last_xfer, bool ok)
+{
+    if (!job->done_cb) {
+        return;
+    }
+    
+    job_done_t entry = {
+        .first_xfer = first_xfer,
+        .last_xfer = last_xfer,
+        .cb = job->done_cb,
+        .arg = job->done_arg,
+        .job_id = job->id,
+        .ok = ok,
+    };
+    bool fire_now = false;
+    bool warned = false;
+    
+    // Los descriptores se liberan apenas sus bytes pasan a la transferencia,
+    // así que los avisos pendientes no están acotados por PRINT_QUEUE_SIZE:
+    // muchos trabajos chicos caben en las transferencias en vuelo. Con la
+    // cola llena se manda la transferencia a medio llenar y se espera a que
+    // completen las anteriores; solo la tarea de la impresora llega acá.
+    while (1) {
+        bool full = false;
+        
+        taskENTER_CRITICAL(&s_printer.job_lock);
+        if (dev->done_count == 0 && (int32_t)(dev->xfer_completed - last_xfer) >= 0) {
+            if ((int32_t)(dev->xfer_error_seq - first_xfer) > 0 &&
+                (int32_t)(dev->xfer_error_seq - last_xfer) <= 0) {
+                entry.ok = false;
+            }
+            fire_now = true;
+        } else if (dev->done_count < PRINTER_DONE_SLOTS) {
+            dev->done[(dev->done_head + dev->done_count) % PRINTER_DONE_SLOTS] = entry;
+            dev->done_count++;
+        } else {
+            full = true;
+        }
+        taskEXIT_CRITICAL(&s_printer.job_lock);
+        
+        if (!full) {
+            break;
+        }
+        if (!warned) {
+            ESP_LOGW(TAG, "⚠️ Impresora %d: %d avisos de fin pendientes, esperando",
+                     dev->index, PRINTER_DONE_SLOTS);
+            warned = true;
+        }
+        coalesce_flush(dev);
+        vTaskDelay(pdMS_TO_TICKS(PRINTER_DONE_WAIT_MS));
+    }
+    
+    if (fire_now) {
+        entry.cb(entry.job_id, entry.ok, entry.arg);
+    }
+}
+
+// Actualiza los contadores de trabajo pendiente y señaliza PRINTER_EVT_IDLE
+// cuando llegan a cero, para que quien espere no tenga que hacer polling
+static void update_idle(printer_dev_t *dev, int jobs_delta, int inflight_delta)
+{
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    s_printer.jobs_pending += jobs_delta;
+    s_printer.inflight += inflight_delta;
+    if (dev) {
+        dev->inflight += inflight_delta;
+    }
+    bool idle = (s_printer.jobs_pending == 0 && s_printer.inflight == 0);
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    if (idle) {
+        xEventGroupSetBits(s_printer.events, PRINTER_EVT_IDLE);
+    } else {
+        xEventGroupClearBits(s_printer.events, PRINTER_EVT_IDLE);
+    }
+}
+
+// Recalcula PRINTER_EVT_READY a partir de los bits de cada impresora
+static void update_ready_bits(void)
+{
+    EventBits_t dev_mask = 0;
+    for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+        dev_mask |= PRINTER_EVT_DEV_READY(i);
     }
-    usb_host_transfer_free(transfer);
+    
+    if (xEventGroupGetBits(s_printer.events) & dev_mask) {
+        xEventGroupSetBits(s_printer.events, PRINTER_EVT_READY);
+    } else {
+        xEventGroupClearBits(s_printer.events, PRINTER_EVT_READY);
+    }
+}
+
+static bool dev_is_ready(const printer_dev_t *dev)
+{
+    return (xEventGroupGetBits(s_printer.events) & PRINTER_EVT_DEV_READY(dev->index)) != 0;
 }
 
 // ============================================
-// ENVÍO USB DIRECTO
+// POOL DE TRANSFERENCIAS
 // ============================================
-static esp_err_t send_to_usb_printer(const uint8_t *data, size_t length)
+// Las transferencias se reservan una sola vez al reclamar la impresora y se
+// reciclan desde el callback, así no hay allocs DMA en el camino caliente.
+// Cada impresora recuerda qué transferencias forman su pool vigente: las que
+// vuelven después de una desconexión ya no figuran y se liberan.
+
+static esp_err_t xfer_pool_alloc(printer_dev_t *dev, size_t xfer_size)
 {
-    if (!s_printer.printer_ready || !s_printer.dev_hdl) {
-        ESP_LOGE(TAG, "Impresora no lista");
-        return ESP_ERR_NOT_FOUND;
+    esp_err_t ret = ESP_OK;
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    xQueueReset(dev->xfer_free);
+    for (int i = 0; i < PRINTER_MAX_INFLIGHT; i++) {
+        usb_transfer_t *transfer = NULL;
+        ret = usb_host_transfer_alloc(xfer_size, 0, &transfer);
+        if (ret != ESP_OK) {
+            break;
+        }
+        transfer->callback = transfer_callback;
+        transfer->context = dev;
+        transfer->timeout_ms = PRINTER_XFER_TIMEOUT_MS;
+        dev->xfer_pool[i] = transfer;
+        xQueueSend(dev->xfer_free, &transfer, 0);
     }
+    xSemaphoreGive(s_printer.mutex);
     
-    usb_transfer_t *transfer = NULL;
-    esp_err_t ret = usb_host_transfer_alloc(length, 0, &transfer);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error allocating transfer: %s", esp_err_to_name(ret));
-        return ret;
+        ESP_LOGE(TAG, "❌ Error reservando pool de transferencias: %s", esp_err_to_name(ret));
+        xfer_pool_retire(dev);
+    }
+    return ret;
+}
+
+static void xfer_pool_retire(printer_dev_t *dev)
+{
+    usb_transfer_t *transfer;
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    while (xQueueReceive(dev->xfer_free, &transfer, 0) == pdTRUE) {
+        if (transfer) {
+            usb_host_transfer_free(transfer);
+        }
+    }
+    for (int i = 0; i < PRINTER_MAX_INFLIGHT; i++) {
+        dev->xfer_pool[i] = NULL;
+    }
+    
+    // Despertar a la tarea de la impresora si estaba esperando transferencia
+    transfer = NULL;
+    xQueueSend(dev->xfer_free, &transfer, 0);
+    xSemaphoreGive(s_printer.mutex);
+}
+
+// Devuelve NULL si vence la espera o si la impresora se desconectó
+static usb_transfer_t *xfer_get(printer_dev_t *dev, TickType_t wait)
+{
+    usb_transfer_t *transfer = NULL;
+    if (xQueueReceive(dev->xfer_free, &transfer, wait) != pdTRUE) {
+        return NULL;
+    }
+    return transfer;
+}
+
+static void xfer_put(printer_dev_t *dev, usb_transfer_t *transfer)
+{
+    bool owned = false;
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    for (int i = 0; i < PRINTER_MAX_INFLIGHT; i++) {
+        if (dev->xfer_pool[i] == transfer) {
+            owned = true;
+            break;
+        }
+    }
+    if (owned) {
+        xQueueSend(dev->xfer_free, &transfer, 0);
+    } else {
+        usb_host_transfer_free(transfer);
+    }
+    xSemaphoreGive(s_printer.mutex);
+}
+
+// ============================================
+// ENVÍO USB DIRECTO
+// ============================================
+// Envía los primeros `length` bytes ya copiados en transfer->data_buffer.
+// Toma la propiedad de la transferencia: vuelve al pool al completarse o
+// inmediatamente si no se pudo enviar.
+static esp_err_t send_to_usb_printer(printer_dev_t *dev, usb_transfer_t *transfer, size_t length)
+{
+    // Numerar la transferencia aunque no salga: los avisos de fin de los
+    // trabajos que la comparten esperan ese número
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    dev->xfer_submitted++;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    if (!dev_is_ready(dev) || !dev->dev_hdl) {
+        ESP_LOGE(TAG, "Impresora %d no lista", dev->index);
+        xfer_put(dev, transfer);
+        dev_xfer_completed(dev, false);
+        return ESP_ERR_NOT_FOUND;
     }
     
-    memcpy(transfer->data_buffer, data, length);
-    transfer->device_handle = s_printer.dev_hdl;
+    transfer->device_handle = dev->dev_hdl;
     transfer->num_bytes = length;
-    transfer->callback = transfer_callback;
-    transfer->context = NULL;
-    transfer->bEndpointAddress = PRINTER_ENDPOINT_OUT;
-    transfer->timeout_ms = 5000;
+    transfer->bEndpointAddress = dev->ep_out;
     
-    ret = usb_host_transfer_submit(transfer);
+    update_idle(dev, 0, 1);
+    esp_err_t ret = usb_host_transfer_submit(transfer);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error submitting transfer: %s", esp_err_to_name(ret));
-        usb_host_transfer_free(transfer);
+        xfer_put(dev, transfer);
+        update_idle(dev, 0, -1);
+        dev_xfer_completed(dev, false);
         return ret;
     }
     
@@ -109,27 +485,49 @@ static void client_event_callback(const usb_host_client_event_msg_t *event_msg,
     ESP_LOGI(TAG, "📢 Evento USB: %d", event_msg->event);
     
     switch (event_msg->event) {
-        case USB_HOST_CLIENT_EVENT_NEW_DEV:
-            ESP_LOGI(TAG, "🔌 Nueva impresora detectada en addr %d", event_msg->new_dev.address);
+        case USB_HOST_CLIENT_EVENT_NEW_DEV: {
+            ESP_LOGI(TAG, "🔌 Nuevo dispositivo detectado en addr %d", event_msg->new_dev.address);
             
+            // Buscar un slot libre (los hubs también generan NEW_DEV y se
+            // descartan al no tener interfaz de impresora)
+            printer_dev_t *dev = NULL;
             xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
-            s_printer.dev_addr = event_msg->new_dev.address;
+            for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+                if (!s_printer.devs[i].dev_hdl) {
+                    dev = &s_printer.devs[i];
+                    break;
+                }
+            }
             xSemaphoreGive(s_printer.mutex);
             
+            if (!dev) {
+                ESP_LOGW(TAG, "⚠️ Ya hay %d impresoras, ignorando addr %d",
+                         PRINTER_MAX_DEVICES, event_msg->new_dev.address);
+                break;
+            }
+            
             // Abrir y reclamar en esta misma tarea
-            open_printer_device(event_msg->new_dev.address);
+            open_printer_device(dev, event_msg->new_dev.address);
             break;
+        }
             
-        case USB_HOST_CLIENT_EVENT_DEV_GONE:
-            ESP_LOGW(TAG, "❌ Impresora desconectada");
+        case USB_HOST_CLIENT_EVENT_DEV_GONE: {
+            printer_dev_t *dev = NULL;
             xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
-            if (s_printer.dev_hdl == event_msg->dev_gone.dev_hdl) {
-                s_printer.printer_ready = false;
-                s_printer.dev_hdl = NULL;
-                s_printer.dev_addr = 0;
+            for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+                if (s_printer.devs[i].dev_hdl == event_msg->dev_gone.dev_hdl) {
+                    dev = &s_printer.devs[i];
+                    break;
+                }
             }
             xSemaphoreGive(s_printer.mutex);
+            
+            if (dev) {
+                ESP_LOGW(TAG, "❌ Impresora %d desconectada", dev->index);
+                close_printer_device(dev);
+            }
             break;
+        }
             
         default:
             ESP_LOGW(TAG, "Evento USB no manejado: %d", event_msg->event);
@@ -140,7 +538,7 @@ static void client_event_callback(const usb_host_client_event_msg_t *event_msg,
 // ============================================
 // ABRIR Y RECLAMAR IMPRESORA
 // ============================================
-static esp_err_t open_printer_device(uint8_t dev_addr)
+static esp_err_t open_printer_device(printer_dev_t *dev, uint8_t dev_addr)
 {
     esp_err_t ret;
     usb_device_handle_t dev_hdl = NULL;
@@ -180,16 +578,24 @@ static esp_err_t open_printer_device(uint8_t dev_addr)
     ESP_LOGI(TAG, "📋 Num Interfaces: %d, Total Length: %d", 
              config_desc->bNumInterfaces, config_desc->wTotalLength);
     
-    // Buscar interfaz de impresora
+    // Buscar interfaz de impresora con endpoint bulk OUT
     bool found_printer = false;
+    const usb_intf_desc_t *printer_intf = NULL;
+    const usb_intf_desc_t *intf = NULL;
     uint8_t interface_number = 0;
+    uint8_t alt_setting = 0;
+    uint8_t ep_out = 0;
+    uint8_t ep_in = 0;
+    uint16_t mps_out = 0;
+    uint16_t mps_in = 0;
     
     const uint8_t *p = (const uint8_t *)(config_desc + 1);
     const uint8_t *end = ((const uint8_t *)config_desc) + config_desc->wTotalLength;
     
-    while (p < end) {
+    while (p + 2 <= end && p[0] >= 2 && !found_printer) {
         if (p[1] == USB_B_DESCRIPTOR_TYPE_INTERFACE) {
-            const usb_intf_desc_t *intf = (const usb_intf_desc_t *)p;
+            intf = (const usb_intf_desc_t *)p;
+            printer_intf = NULL;
             
             ESP_LOGI(TAG, "🔍 Interface %d: Class 0x%02x, SubClass 0x%02x", 
                      intf->bInterfaceNumber, intf->bInterfaceClass, intf->bInterfaceSubClass);
@@ -197,14 +603,39 @@ static esp_err_t open_printer_device(uint8_t dev_addr)
             // Buscar clase impresora (0x07) o vendor-specific (0xFF)
             if (intf->bInterfaceClass == PRINTER_INTERFACE_CLASS || 
                 intf->bInterfaceClass == PRINTER_VENDOR_CLASS) {
-                found_printer = true;
-                interface_number = intf->bInterfaceNumber;
-                ESP_LOGI(TAG, "✅ Interfaz impresora encontrada: %d (clase 0x%02x)", 
-                         interface_number, intf->bInterfaceClass);
-                break;
+                printer_intf = intf;
+                ep_out = 0;
+                ep_in = 0;
+                mps_out = 0;
+                mps_in = 0;
             }
+        } else if (p[1] == USB_B_DESCRIPTOR_TYPE_ENDPOINT && printer_intf) {
+            // Endpoints de la interfaz candidata: quedarse con los bulk
+            const usb_ep_desc_t *ep = (const usb_ep_desc_t *)p;
+            if ((ep->bmAttributes & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_BULK) {
+                if (ep->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) {
+                    if (!ep_in) {
+                        ep_in = ep->bEndpointAddress;
+                        mps_in = USB_EP_DESC_GET_MPS(ep);
+                    }
+                } else if (!ep_out) {
+                    ep_out = ep->bEndpointAddress;
+                    mps_out = USB_EP_DESC_GET_MPS(ep);
+                }
+            }
+        }
+        
+        // Interfaz candidata completa: todos sus endpoints ya se recorrieron
+        const uint8_t *next = p + p[0];
+        bool intf_done = (next + 2 > end) || next[1] == USB_B_DESCRIPTOR_TYPE_INTERFACE;
+        if (printer_intf && intf_done && ep_out && mps_out) {
+            found_printer = true;
+            interface_number = printer_intf->bInterfaceNumber;
+            alt_setting = printer_intf->bAlternateSetting;
+            ESP_LOGI(TAG, "✅ Interfaz impresora encontrada: %d (clase 0x%02x)", 
+                     interface_number, printer_intf->bInterfaceClass);
         }
-        p += p[0]; // Siguiente descriptor
+        p = next; // Siguiente descriptor
     }
     
     if (!found_printer) {
@@ -213,35 +644,115 @@ static esp_err_t open_printer_device(uint8_t dev_addr)
         return ESP_ERR_NOT_FOUND;
     }
     
+    // Transferencias de varios chunks redondeadas a múltiplo de MPS, así
+    // ningún paquete intermedio sale corto y los trabajos chicos que llegan
+    // juntos viajan en una sola transferencia
+    size_t xfer_size = (PRINTER_XFER_MAX_SIZE / mps_out) * mps_out;
+    if (xfer_size < mps_out) {
+        xfer_size = mps_out;
+    }
+    
+    ESP_LOGI(TAG, "📋 EP OUT 0x%02x (MPS %d), EP IN 0x%02x, transferencias de %d bytes",
+             ep_out, mps_out, ep_in, xfer_size);
+    
     ESP_LOGI(TAG, "🔧 Reclamando interfaz %d...", interface_number);
     
     // Reclamar interfaz
-    ret = usb_host_interface_claim(s_printer.client_hdl, dev_hdl, interface_number, 0);
+    ret = usb_host_interface_claim(s_printer.client_hdl, dev_hdl, interface_number, alt_setting);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "❌ Error reclamando interfaz: %s", esp_err_to_name(ret));
         usb_host_device_close(s_printer.client_hdl, dev_hdl);
         return ret;
     }
     
+    // Reservar el pool de transferencias una sola vez para este dispositivo
+    ret = xfer_pool_alloc(dev, xfer_size);
+    if (ret != ESP_OK) {
+        usb_host_interface_release(s_printer.client_hdl, dev_hdl, interface_number);
+        usb_host_device_close(s_printer.client_hdl, dev_hdl);
+        return ret;
+    }
+    
     // Guardar handle
     xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
-    s_printer.dev_hdl = dev_hdl;
-    s_printer.dev_addr = dev_addr;
-    s_printer.printer_ready = true;
+    dev->dev_hdl = dev_hdl;
+    dev->dev_addr = dev_addr;
+    dev->vid = dev_desc->idVendor;
+    dev->pid = dev_desc->idProduct;
+    dev->intf_num = interface_number;
+    dev->ep_out = ep_out;
+    dev->ep_in = ep_in;
+    dev->mps_out = mps_out;
+    dev->mps_in = mps_in;
+    memset(&dev->status, 0, sizeof(dev->status));
+    dev->rt_fault = false;
+    dev->xfer_size = xfer_size;
     xSemaphoreGive(s_printer.mutex);
     
-    ESP_LOGI(TAG, "🎉 ✅ Impresora reclamada y lista en addr %d", dev_addr);
+    // Tomar la primera transferencia para ESC @ antes de marcar la impresora
+    // como lista, así la inicialización sale antes que cualquier trabajo
+    usb_transfer_t *transfer = xfer_get(dev, 0);
+    xEventGroupSetBits(s_printer.events, PRINTER_EVT_DEV_READY(dev->index) |
+                       PRINTER_EVT_DEV_OK(dev->index) | PRINTER_EVT_SLOT);
+    update_ready_bits();
+    
+    ESP_LOGI(TAG, "🎉 ✅ Impresora %d reclamada y lista en addr %d", dev->index, dev_addr);
     
     // Enviar comando de inicialización
-    vTaskDelay(pdMS_TO_TICKS(200));
     const uint8_t init_cmd[] = {0x1B, 0x40}; // ESC @
-    send_to_usb_printer(init_cmd, sizeof(init_cmd));
+    if (transfer) {
+        memcpy(transfer->data_buffer, init_cmd, sizeof(init_cmd));
+        send_to_usb_printer(dev, transfer, sizeof(init_cmd));
+    }
     
     ESP_LOGI(TAG, "📤 Comando de inicialización enviado");
     
     return ESP_OK;
 }
 
+// ============================================
+// LIBERAR IMPRESORA
+// ============================================
+// Marca la impresora como no lista, cancela lo que quede en vuelo y libera
+// la interfaz. Las transferencias canceladas se liberan al volver y la
+// tarea de la impresora devuelve al dispatcher los trabajos no empezados.
+static void close_printer_device(printer_dev_t *dev)
+{
+    // Bajar el bit de lista bajo el mutex: la tarea de estado lo revisa
+    // con el mutex tomado antes de enviar una consulta
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    usb_device_handle_t dev_hdl = dev->dev_hdl;
+    uint8_t intf_num = dev->intf_num;
+    uint8_t ep_out = dev->ep_out;
+    uint8_t ep_in = dev->ep_in;
+    xEventGroupClearBits(s_printer.events, PRINTER_EVT_DEV_READY(dev->index));
+    xSemaphoreGive(s_printer.mutex);
+    
+    if (!dev_hdl) {
+        return;
+    }
+    
+    update_ready_bits();
+    
+    xfer_pool_retire(dev);
+    usb_host_endpoint_halt(dev_hdl, ep_out);
+    usb_host_endpoint_flush(dev_hdl, ep_out);
+    usb_host_endpoint_clear(dev_hdl, ep_out);
+    if (ep_in) {
+        // Cancela una consulta de estado pendiente
+        usb_host_endpoint_halt(dev_hdl, ep_in);
+        usb_host_endpoint_flush(dev_hdl, ep_in);
+        usb_host_endpoint_clear(dev_hdl, ep_in);
+    }
+    usb_host_interface_release(s_printer.client_hdl, dev_hdl, intf_num);
+    usb_host_device_close(s_printer.client_hdl, dev_hdl);
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    dev->dev_hdl = NULL;
+    dev->dev_addr = 0;
+    xSemaphoreGive(s_printer.mutex);
+}
+
 // ============================================
 // TAREA USB HOST LIBRARY (igual al código que funciona)
 // ============================================
@@ -337,10 +848,13 @@ static void client_task(void *arg)
     
     ESP_LOGI(TAG, "✅ Cliente USB registrado");
     
-    // Loop de eventos del cliente
+    // Notificar que el cliente está registrado
+    xTaskNotifyGive((TaskHandle_t)arg);
+    
+    // Loop de eventos del cliente: bloquea hasta que haya un evento o una
+    // transferencia completada; printer_deinit() lo despierta con unblock
     while (!s_printer.stop_usb_host) {
-        usb_host_client_handle_events(s_printer.client_hdl, pdMS_TO_TICKS(100));
-        vTaskDelay(pdMS_TO_TICKS(10));
+        usb_host_client_handle_events(s_printer.client_hdl, portMAX_DELAY);
     }
     
     ESP_LOGI(TAG, "🛑 Desregistrando cliente");
@@ -352,63 +866,732 @@ static void client_task(void *arg)
 // ============================================
 // TAREA PROCESADORA DE COLA DE IMPRESIÓN
 // ============================================
+// Saca el siguiente chunk publicado de un trabajo. Si no hay ninguno,
+// *done indica si el trabajo ya terminó (cerrado o abortado).
+static print_chunk_t *job_pop_chunk(print_job_t *job, bool *done)
+{
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    print_chunk_t *chunk = job->aborted ? NULL : job->head;
+    if (chunk) {
+        job->head = chunk->next;
+        if (!job->head) {
+            job->tail = NULL;
+        }
+        chunk->next = NULL;
+    }
+    *done = job->aborted || (job->closed && !job->head);
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    return chunk;
+}
+
+// Devuelve un chunk a la cabeza del trabajo (no se llegó a enviar)
+static void job_unpop_chunk(print_job_t *job, print_chunk_t *chunk)
+{
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    chunk->next = job->head;
+    job->head = chunk;
+    if (!job->tail) {
+        job->tail = chunk;
+    }
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+}
+
+// Elige la impresora lista y sin error con menos trabajos asignados que
+// todavía tenga lugar en su backlog. NULL si ninguna puede aceptar trabajo.
+static printer_dev_t *pick_least_loaded(void)
+{
+    printer_dev_t *best = NULL;
+    uint32_t best_load = UINT32_MAX;
+    EventBits_t bits = xEventGroupGetBits(s_printer.events);
+    
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+        printer_dev_t *dev = &s_printer.devs[i];
+        uint32_t load = dev->assigned * PRINTER_MAX_INFLIGHT + dev->inflight;
+        EventBits_t usable = PRINTER_EVT_DEV_READY(i) | PRINTER_EVT_DEV_OK(i);
+        if ((bits & usable) == usable && !dev->polling &&
+            dev->assigned < PRINTER_DEV_BACKLOG && load < best_load) {
+            best = dev;
+            best_load = load;
+        }
+    }
+    if (best) {
+        best->assigned++;
+    }
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    return best;
+}
+
+// Agrega un trabajo a su carril (al final, o al frente si se devuelve)
+static void lane_push(print_job_t *job, bool front)
+{
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    int lane = job->prio;
+    if (front) {
+        job->next = s_printer.lane_head[lane];
+        s_printer.lane_head[lane] = job;
+        if (!s_printer.lane_tail[lane]) {
+            s_printer.lane_tail[lane] = job;
+        }
+    } else {
+        job->next = NULL;
+        if (s_printer.lane_tail[lane]) {
+            s_printer.lane_tail[lane]->next = job;
+        } else {
+            s_printer.lane_head[lane] = job;
+        }
+        s_printer.lane_tail[lane] = job;
+    }
+    s_printer.lane_count[lane]++;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    xSemaphoreGive(s_printer.lane_sem);
+}
+
+// Saca el próximo trabajo: el carril más prioritario con trabajos y,
+// dentro de él, el del cliente atendido hace más tiempo (el más viejo si
+// empatan). Llamar solo después de tomar lane_sem.
+static print_job_t *lane_pop(void)
+{
+    print_job_t *best = NULL;
+    print_job_t *best_prev = NULL;
+    int lane = 0;
+    
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    for (lane = 0; lane < PRINTER_PRIO_COUNT && !s_printer.lane_head[lane]; lane++) {
+    }
+    
+    if (lane < PRINTER_PRIO_COUNT) {
+        uint32_t best_rank = UINT32_MAX;
+        print_job_t *prev = NULL;
+        for (print_job_t *job = s_printer.lane_head[lane]; job; prev = job, job = job->next) {
+            uint32_t rank = print_sched_rank(&s_printer.sched, job->client);
+            if (rank < best_rank) {
+                best = job;
+                best_prev = prev;
+                best_rank = rank;
+            }
+        }
+        
+        if (best_prev) {
+            best_prev->next = best->next;
+        } else {
+            s_printer.lane_head[lane] = best->next;
+        }
+        if (s_printer.lane_tail[lane] == best) {
+            s_printer.lane_tail[lane] = best_prev;
+        }
+        best->next = NULL;
+        s_printer.lane_count[lane]--;
+        print_sched_served(&s_printer.sched, best->client);
+    }
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    return best;
+}
+
+// Dispatcher: reparte los trabajos de los carriles entre las impresoras
+// listas. Asigna tarde (backlog corto por impresora) para que un trabajo no
+// quede esperando detrás de una impresora lenta mientras otra está libre.
 static void printer_process_task(void *arg)
 {
-    print_job_t job;
+    ESP_LOGI(TAG, "🖨️ Dispatcher de impresión iniciado");
+    
+    while (1) {
+        // Esperar trabajos en los carriles
+        if (xSemaphoreTake(s_printer.lane_sem, portMAX_DELAY)) {
+            printer_dev_t *dev;
+            
+            // Esperar una impresora lista con capacidad (sin polling)
+            while ((dev = pick_least_loaded()) == NULL) {
+                xEventGroupWaitBits(s_printer.events, PRINTER_EVT_SLOT,
+                                    pdTRUE, pdFALSE, portMAX_DELAY);
+            }
+            
+            // Elegir el trabajo recién ahora, para que lo que llegó mientras
+            // se esperaba impresora compita por prioridad y equidad
+            print_job_t *job = lane_pop();
+            
+            ESP_LOGD(TAG, "Trabajo #%lu (carril %d, cliente %08lx) → impresora %d",
+                     job->id, job->prio, job->client, dev->index);
+            xQueueSend(dev->job_queue, &job, portMAX_DELAY);
+        }
+    }
+}
+
+// Termina la asignación de un trabajo en una impresora y avisa al dispatcher
+static void dev_job_finished(printer_dev_t *dev)
+{
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    dev->assigned--;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    xEventGroupSetBits(s_printer.events, PRINTER_EVT_SLOT);
+}
+
+// Tarea de una impresora: transmite en orden los trabajos que le asigna el
+// dispatcher. Si la impresora se desconecta antes de empezar un trabajo, lo
+// devuelve al frente de la cola global para que lo tome otra.
+// Envía la transferencia a medio llenar, si hay. Mientras se llena cuenta
+// como en vuelo para que printer_wait_idle() no termine antes de tiempo.
+static void coalesce_flush(printer_dev_t *dev)
+{
+    if (!dev->coalesce) {
+        return;
+    }
+    
+    send_to_usb_printer(dev, dev->coalesce, dev->coalesce_len);
+    update_idle(dev, 0, -1);
+    dev->coalesce = NULL;
+    dev->coalesce_len = 0;
+}
+
+// Copia un chunk a la transferencia en curso y envía cada transferencia que
+// se llena. Devuelve false si la impresora se desconectó.
+static bool coalesce_append(printer_dev_t *dev, const uint8_t *data, size_t length)
+{
+    size_t offset = 0;
+    
+    while (offset < length) {
+        if (!dev->coalesce) {
+            // Sin papel o con la tapa abierta: esperar en vez de dejar
+            // que cada transferencia venza por timeout
+            while (dev_is_ready(dev) &&
+                   !(xEventGroupGetBits(s_printer.events) & PRINTER_EVT_DEV_OK(dev->index))) {
+                xEventGroupWaitBits(s_printer.events, PRINTER_EVT_DEV_OK(dev->index),
+                                    pdFALSE, pdTRUE, pdMS_TO_TICKS(PRINTER_STATUS_POLL_MS));
+            }
+            
+            usb_transfer_t *transfer = xfer_get(dev, portMAX_DELAY);
+            if (!transfer) {
+                // Despertada por desconexión
+                if (!dev_is_ready(dev)) {
+                    return false;
+                }
+                continue;
+            }
+            dev->coalesce = transfer;
+            dev->coalesce_len = 0;
+            update_idle(dev, 0, 1);
+        }
+        
+        size_t max = dev->xfer_size;
+        if (max == 0 || max > dev->coalesce->data_buffer_size) {
+            max = dev->coalesce->data_buffer_size;
+        }
+        size_t n = length - offset;
+        if (n > max - dev->coalesce_len) {
+            n = max - dev->coalesce_len;
+        }
+        memcpy(dev->coalesce->data_buffer + dev->coalesce_len, data + offset, n);
+        dev->coalesce_len += n;
+        dev->bytes_sent += n;
+        offset += n;
+        
+        if (dev->coalesce_len == max) {
+            coalesce_flush(dev);
+        }
+    }
     
-    ESP_LOGI(TAG, "🖨️ Tarea de impresión iniciada");
+    return true;
+}
+
+static void printer_worker_task(void *arg)
+{
+    printer_dev_t *dev = (printer_dev_t *)arg;
+    print_job_t *job;
     
     while (1) {
-        // Esperar trabajos en la cola
-        if (xQueueReceive(s_printer.print_queue, &job, portMAX_DELAY)) {
+        // Con una transferencia a medio llenar, esperar un poco por el
+        // próximo trabajo para mandarlos juntos
+        TickType_t linger = dev->coalesce ? pdMS_TO_TICKS(PRINTER_COALESCE_LINGER_MS) : portMAX_DELAY;
+        if (xQueueReceive(dev->job_queue, &job, linger) != pdTRUE) {
+            coalesce_flush(dev);
+            continue;
+        }
+        
+        taskENTER_CRITICAL(&s_printer.job_lock);
+        job->worker = xTaskGetCurrentTaskHandle();
+        taskEXIT_CRITICAL(&s_printer.job_lock);
+        
+        size_t sent = 0;
+        bool started = false;
+        bool failed = false;
+        bool requeued = false;
+        
+        taskENTER_CRITICAL(&s_printer.job_lock);
+        uint32_t first_xfer = dev->xfer_submitted;
+        taskEXIT_CRITICAL(&s_printer.job_lock);
+        TickType_t job_start = xTaskGetTickCount();
+        
+        // Drenar los chunks del trabajo en orden; si el productor todavía
+        // no publicó más datos, esperar su notificación
+        while (1) {
+            bool done = false;
+            print_chunk_t *chunk = job_pop_chunk(job, &done);
+            
+            if (!chunk) {
+                if (done) {
+                    break;
+                }
+                // Si el productor tarda, no retener lo que ya está copiado
+                if (dev->coalesce) {
+                    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PRINTER_COALESCE_LINGER_MS)) == 0) {
+                        coalesce_flush(dev);
+                    }
+                } else {
+                    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                }
+                continue;
+            }
+            
+            if (!failed && !dev_is_ready(dev)) {
+                // Lo pendiente de trabajos anteriores se da por fallido
+                coalesce_flush(dev);
+                if (!started) {
+                    // Nada salió todavía: que lo tome otra impresora
+                    job_unpop_chunk(job, chunk);
+                    requeued = true;
+                    break;
+                }
+                ESP_LOGE(TAG, "❌ Impresora %d desconectada a mitad del trabajo #%lu",
+                         dev->index, job->id);
+                failed = true;
+            }
             
-            // Esperar que la impresora esté lista
-            while (!s_printer.printer_ready) {
-                vTaskDelay(pdMS_TO_TICKS(100));
+            // Un trabajo cortado se descarta hasta que el productor lo cierre
+            if (failed) {
+                xQueueSend(s_printer.free_chunks, &chunk, 0);
+                continue;
             }
+            started = true;
             
-            // Enviar a USB
-            esp_err_t ret = send_to_usb_printer(job.data, job.length);
-            if (ret == ESP_OK) {
-                ESP_LOGI(TAG, "✅ Enviados %d bytes a impresora", job.length);
+            // Copiar a la transferencia en curso: con PRINTER_MAX_INFLIGHT > 1
+            // el host ya tiene la anterior encolada mientras llenamos esta, así
+            // el bus no queda ocioso. Los bytes de un trabajo pueden compartir
+            // transferencia con el anterior y el siguiente.
+            if (!coalesce_append(dev, chunk->data, chunk->length)) {
+                failed = true;
             } else {
-                ESP_LOGE(TAG, "❌ Error enviando a impresora");
+                sent += chunk->length;
             }
             
-            // Pequeño delay entre trabajos
-            vTaskDelay(pdMS_TO_TICKS(50));
+            // El chunk vuelve a la arena en cuanto se copió a los buffers DMA
+            xQueueSend(s_printer.free_chunks, &chunk, 0);
         }
+        
+        taskENTER_CRITICAL(&s_printer.job_lock);
+        job->worker = NULL;
+        taskEXIT_CRITICAL(&s_printer.job_lock);
+        
+        if (requeued) {
+            ESP_LOGW(TAG, "↩️ Trabajo #%lu devuelto al dispatcher", job->id);
+            lane_push(job, true);
+            dev_job_finished(dev);
+            continue;
+        }
+        
+        if (failed) {
+            dev->jobs_failed++;
+        } else {
+            dev->jobs_done++;
+            
+            // Media móvil (1/4) para estimar esperas
+            uint32_t job_ms = pdTICKS_TO_MS(xTaskGetTickCount() - job_start);
+            taskENTER_CRITICAL(&s_printer.job_lock);
+            s_printer.avg_job_ms = (3 * s_printer.avg_job_ms + job_ms) / 4;
+            taskEXIT_CRITICAL(&s_printer.job_lock);
+        }
+        ESP_LOGI(TAG, "✅ Trabajo #%lu: enviados %d bytes a impresora %d", job->id, sent, dev->index);
+        
+        // La última transferencia del trabajo puede ser la que sigue
+        // llenándose; su aviso de fin espera a que salga y se complete
+        taskENTER_CRITICAL(&s_printer.job_lock);
+        uint32_t last_xfer = dev->xfer_submitted + (dev->coalesce ? 1 : 0);
+        bool ok = !failed && !job->aborted;
+        taskEXIT_CRITICAL(&s_printer.job_lock);
+        dev_job_done_notify(dev, job, first_xfer, last_xfer, ok);
+        
+        job_release(job);
+        dev_job_finished(dev);
+        update_idle(NULL, -1, 0);
     }
 }
 
 // ============================================
-// API PÚBLICA
+// TAREA DE ESTADO
 // ============================================
+// Consulta periódicamente el estado real de cada impresora con la
+// petición de clase GET_PORT_STATUS (por el endpoint de control, no toca
+// el flujo de datos) y, cuando la impresora está ociosa y tiene bulk IN,
+// con DLE EOT 1..4. Mientras hay un error se pausa el envío a esa impresora.
 
-esp_err_t printer_init(void)
+static void status_xfer_callback(usb_transfer_t *transfer)
 {
-    if (s_printer.initialized) {
-        ESP_LOGW(TAG, "⚠️ Driver ya inicializado");
-        return ESP_OK;
-    }
-    
-    ESP_LOGI(TAG, "🚀 Inicializando driver de impresora USB...");
+    status_xfer_t *ctx = (status_xfer_t *)transfer->context;
+    ctx->done = true;
+    xTaskNotifyGive(ctx->task);
+}
+
+// Espera a que el callback marque la transferencia como terminada
+static bool status_xfer_wait(status_xfer_t *ctx, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
     
-    // Crear mutex
-    s_printer.mutex = xSemaphoreCreateMutex();
-    if (!s_printer.mutex) {
-        ESP_LOGE(TAG, "❌ Error creando mutex");
-        return ESP_ERR_NO_MEM;
+    while (!ctx->done) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - elapsed);
     }
+    return true;
+}
+
+// Envía la transferencia solo si la impresora sigue lista. El mutex
+// ordena el envío respecto de close_printer_device(), que baja el bit de
+// lista con el mutex tomado antes de cancelar los endpoints.
+static esp_err_t status_xfer_submit(printer_dev_t *dev, usb_transfer_t *transfer, bool control)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
     
-    // Crear cola de impresión
-    s_printer.print_queue = xQueueCreate(PRINT_QUEUE_SIZE, sizeof(print_job_t));
-    if (!s_printer.print_queue) {
-        ESP_LOGE(TAG, "❌ Error creando cola");
-        vSemaphoreDelete(s_printer.mutex);
-        return ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    if (dev_is_ready(dev) && dev->dev_hdl) {
+        transfer->device_handle = dev->dev_hdl;
+        ((status_xfer_t *)transfer->context)->done = false;
+        ret = control ? usb_host_transfer_submit_control(s_printer.client_hdl, transfer)
+                      : usb_host_transfer_submit(transfer);
     }
-    
+    xSemaphoreGive(s_printer.mutex);
+    return ret;
+}
+
+// GET_PORT_STATUS. Devuelve false si la impresora no respondió; en ese
+// caso la transferencia de control sigue ocupada hasta que vuelva.
+static bool read_port_status(printer_dev_t *dev, usb_transfer_t *ctrl, uint8_t *port)
+{
+    usb_setup_packet_t *setup = (usb_setup_packet_t *)ctrl->data_buffer;
+    setup->bmRequestType = USB_BM_REQUEST_TYPE_DIR_IN | USB_BM_REQUEST_TYPE_TYPE_CLASS |
+                           USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+    setup->bRequest = USB_PRINTER_GET_PORT_STATUS;
+    setup->wValue = 0;
+    setup->wIndex = dev->intf_num;
+    setup->wLength = 1;
+    ctrl->num_bytes = sizeof(usb_setup_packet_t) + 1;
+    ctrl->bEndpointAddress = 0;
+    
+    if (status_xfer_submit(dev, ctrl, true) != ESP_OK) {
+        return false;
+    }
+    if (!status_xfer_wait((status_xfer_t *)ctrl->context, PRINTER_STATUS_TIMEOUT_MS)) {
+        return false;
+    }
+    if (ctrl->status != USB_TRANSFER_STATUS_COMPLETED ||
+        ctrl->actual_num_bytes < (int)sizeof(usb_setup_packet_t) + 1) {
+        return false;
+    }
+    
+    *port = ctrl->data_buffer[sizeof(usb_setup_packet_t)];
+    return true;
+}
+
+// DLE EOT n: la pregunta sale por el bulk OUT y la respuesta (un byte)
+// vuelve por el bulk IN. Solo se llama con la impresora reservada (polling).
+static bool read_realtime_status(printer_dev_t *dev, uint8_t n, uint8_t *out)
+{
+    if (dev->status_in && dev->status_in->data_buffer_size < dev->mps_in) {
+        usb_host_transfer_free(dev->status_in);
+        dev->status_in = NULL;
+    }
+    if (!dev->status_in) {
+        if (usb_host_transfer_alloc(dev->mps_in, 0, &dev->status_in) != ESP_OK) {
+            dev->status_in = NULL;
+            return false;
+        }
+        dev->status_in_ctx.task = xTaskGetCurrentTaskHandle();
+        dev->status_in->callback = status_xfer_callback;
+        dev->status_in->context = &dev->status_in_ctx;
+    }
+    
+    usb_transfer_t *query = xfer_get(dev, 0);
+    if (!query) {
+        return false;
+    }
+    
+    // La respuesta se espera antes de preguntar para no perderla
+    usb_transfer_t *in = dev->status_in;
+    in->bEndpointAddress = dev->ep_in;
+    in->num_bytes = dev->mps_in;
+    if (status_xfer_submit(dev, in, false) != ESP_OK) {
+        xfer_put(dev, query);
+        return false;
+    }
+    
+    const uint8_t cmd[] = {0x10, 0x04, n}; // DLE EOT n
+    memcpy(query->data_buffer, cmd, sizeof(cmd));
+    send_to_usb_printer(dev, query, sizeof(cmd));
+    
+    if (!status_xfer_wait(&dev->status_in_ctx, PRINTER_STATUS_TIMEOUT_MS)) {
+        // Sin respuesta: cancelar la lectura pendiente
+        xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+        if (dev_is_ready(dev) && dev->dev_hdl) {
+            usb_host_endpoint_halt(dev->dev_hdl, dev->ep_in);
+            usb_host_endpoint_flush(dev->dev_hdl, dev->ep_in);
+            usb_host_endpoint_clear(dev->dev_hdl, dev->ep_in);
+        }
+        xSemaphoreGive(s_printer.mutex);
+        
+        if (!status_xfer_wait(&dev->status_in_ctx, PRINTER_STATUS_POLL_MS)) {
+            // No volvió nunca: se abandona en vez de liberarla en vuelo
+            ESP_LOGW(TAG, "⚠️ Impresora %d: lectura de estado sin cancelar", dev->index);
+            dev->status_in = NULL;
+        }
+        return false;
+    }
+    
+    // Toda respuesta de estado tiene el formato 0xx1xx10
+    if (in->status != USB_TRANSFER_STATUS_COMPLETED || in->actual_num_bytes < 1 ||
+        (in->data_buffer[0] & 0x93) != 0x12) {
+        return false;
+    }
+    
+    *out = in->data_buffer[0];
+    return true;
+}
+
+// Reserva la impresora para DLE EOT si no tiene trabajos ni transferencias
+static bool claim_for_polling(printer_dev_t *dev)
+{
+    bool claimed = false;
+    
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    if (dev->assigned == 0 && dev->inflight == 0 && !dev->polling) {
+        dev->polling = true;
+        claimed = true;
+    }
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    return claimed;
+}
+
+static void poll_device(printer_dev_t *dev, usb_transfer_t *ctrl)
+{
+    printer_status_t st;
+    uint8_t port;
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    st = dev->status;
+    xSemaphoreGive(s_printer.mutex);
+    
+    bool port_fault = false;
+    if (((status_xfer_t *)ctrl->context)->done && read_port_status(dev, ctrl, &port)) {
+        st.valid = true;
+        st.port_status = port;
+        port_fault = (port & PORT_STATUS_PAPER_EMPTY) || !(port & PORT_STATUS_NOT_ERROR);
+    }
+    
+    uint8_t rt[4];
+    bool claimed = dev->ep_in && dev->mps_in && claim_for_polling(dev);
+    if (claimed) {
+        bool answered = true;
+        for (int n = 1; n <= 4 && answered; n++) {
+            answered = read_realtime_status(dev, n, &rt[n - 1]);
+        }
+        
+        st.realtime = answered;
+        if (answered) {
+            st.valid = true;
+            st.online = !(rt[0] & (1 << 3));
+            st.cover_open = rt[1] & (1 << 2);
+            st.feed_button = rt[1] & (1 << 3);
+            st.paper_end = (rt[1] & (1 << 5)) || (rt[3] & ((1 << 5) | (1 << 6)));
+            st.paper_near_end = rt[3] & ((1 << 2) | (1 << 3));
+            st.cutter_error = rt[2] & (1 << 3);
+            st.unrecoverable_error = rt[2] & (1 << 5);
+            st.auto_recoverable_error = rt[2] & (1 << 6);
+            st.error = (rt[1] & (1 << 6)) || (rt[2] & ((1 << 2) | (1 << 3) | (1 << 5) | (1 << 6)));
+            dev->rt_fault = !st.online || st.cover_open || st.paper_end || st.error;
+        }
+    } else if (dev->rt_fault) {
+        // Ocupada con un error de DLE EOT pendiente: un trabajo asignado
+        // antes de la pausa no deja volver a consultar. Se sigue con
+        // GET_PORT_STATUS para no quedar pausada para siempre; si el error
+        // sigue, la próxima consulta con la impresora libre lo vuelve a ver.
+        st.realtime = false;
+    }
+    
+    // Sin DLE EOT, lo que diga GET_PORT_STATUS
+    if (!st.realtime) {
+        st.online = !st.valid || (st.port_status & PORT_STATUS_SELECT);
+        st.paper_end = st.valid && (st.port_status & PORT_STATUS_PAPER_EMPTY);
+        st.error = st.valid && !(st.port_status & PORT_STATUS_NOT_ERROR);
+        dev->rt_fault = false;
+    }
+    
+    bool was_fault = dev->status.fault;
+    st.fault = port_fault || dev->rt_fault;
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    dev->status = st;
+    xSemaphoreGive(s_printer.mutex);
+    
+    if (st.fault && !was_fault) {
+        ESP_LOGW(TAG, "⛔ Impresora %d pausada: %s", dev->index, printer_status_reason(&st));
+        xEventGroupClearBits(s_printer.events, PRINTER_EVT_DEV_OK(dev->index));
+    } else if (!st.fault && was_fault) {
+        ESP_LOGI(TAG, "✅ Impresora %d sin errores, reanudando", dev->index);
+        xEventGroupSetBits(s_printer.events, PRINTER_EVT_DEV_OK(dev->index) | PRINTER_EVT_SLOT);
+    }
+    
+    // Liberarla recién con el estado publicado y DEV_OK al día, así el
+    // despachador no le asigna un trabajo sin ver el error recién leído
+    if (claimed) {
+        taskENTER_CRITICAL(&s_printer.job_lock);
+        dev->polling = false;
+        taskEXIT_CRITICAL(&s_printer.job_lock);
+        xEventGroupSetBits(s_printer.events, PRINTER_EVT_SLOT);
+    }
+}
+
+static void printer_status_task(void *arg)
+{
+    static status_xfer_t ctrl_ctx;
+    usb_transfer_t *ctrl = NULL;
+    
+    ctrl_ctx.task = xTaskGetCurrentTaskHandle();
+    ctrl_ctx.done = true;
+    if (usb_host_transfer_alloc(sizeof(usb_setup_packet_t) + 8, 0, &ctrl) != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error reservando transferencia de estado");
+        vTaskDelete(NULL);
+        return;
+    }
+    ctrl->callback = status_xfer_callback;
+    ctrl->context = &ctrl_ctx;
+    
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(PRINTER_STATUS_POLL_MS));
+        
+        for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+            printer_dev_t *dev = &s_printer.devs[i];
+            if (dev_is_ready(dev)) {
+                poll_device(dev, ctrl);
+            } else if (dev->status_in && dev->status_in_ctx.done) {
+                // La impresora se fue: liberar su lectura de estado
+                usb_host_transfer_free(dev->status_in);
+                dev->status_in = NULL;
+            }
+        }
+    }
+}
+
+// Borra colas, event group y mutex (los que existan)
+static void printer_deinit_queues(void)
+{
+    for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+        printer_dev_t *dev = &s_printer.devs[i];
+        if (dev->xfer_free) {
+            vQueueDelete(dev->xfer_free);
+            dev->xfer_free = NULL;
+        }
+        if (dev->job_queue) {
+            vQueueDelete(dev->job_queue);
+            dev->job_queue = NULL;
+        }
+    }
+    
+    if (s_printer.lane_sem) {
+        vSemaphoreDelete(s_printer.lane_sem);
+        s_printer.lane_sem = NULL;
+    }
+    
+    if (s_printer.free_jobs) {
+        vQueueDelete(s_printer.free_jobs);
+        s_printer.free_jobs = NULL;
+    }
+    
+    if (s_printer.free_chunks) {
+        vQueueDelete(s_printer.free_chunks);
+        s_printer.free_chunks = NULL;
+    }
+    
+    if (s_printer.events) {
+        vEventGroupDelete(s_printer.events);
+        s_printer.events = NULL;
+    }
+    
+    if (s_printer.mutex) {
+        vSemaphoreDelete(s_printer.mutex);
+        s_printer.mutex = NULL;
+    }
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+esp_err_t printer_init(void)
+{
+    if (s_printer.initialized) {
+        ESP_LOGW(TAG, "⚠️ Driver ya inicializado");
+        return ESP_OK;
+    }
+    
+    ESP_LOGI(TAG, "🚀 Inicializando driver de impresora USB...");
+    
+    // Crear mutex, event group y lista libre del pool de transferencias
+    s_printer.mutex = xSemaphoreCreateMutex();
+    if (!s_printer.mutex) {
+        ESP_LOGE(TAG, "❌ Error creando mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    s_printer.events = xEventGroupCreate();
+    if (!s_printer.events) {
+        ESP_LOGE(TAG, "❌ Error creando event group");
+        vSemaphoreDelete(s_printer.mutex);
+        s_printer.mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    xEventGroupSetBits(s_printer.events, PRINTER_EVT_IDLE);
+    
+    // Listas libres de transferencias (+1 lugar para el aviso de
+    // desconexión) y colas de trabajos asignados de cada impresora
+    for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+        printer_dev_t *dev = &s_printer.devs[i];
+        dev->index = i;
+        dev->xfer_free = xQueueCreate(PRINTER_MAX_INFLIGHT + 1, sizeof(usb_transfer_t *));
+        dev->job_queue = xQueueCreate(PRINT_QUEUE_SIZE, sizeof(print_job_t *));
+        if (!dev->xfer_free || !dev->job_queue) {
+            ESP_LOGE(TAG, "❌ Error creando colas de impresora %d", i);
+            printer_deinit_queues();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
+    // Crear cola de impresión y listas libres de la arena (solo punteros)
+    s_printer.lane_sem = xSemaphoreCreateCounting(PRINT_QUEUE_SIZE, 0);
+    memset(s_printer.lane_head, 0, sizeof(s_printer.lane_head));
+    memset(s_printer.lane_tail, 0, sizeof(s_printer.lane_tail));
+    memset(s_printer.lane_count, 0, sizeof(s_printer.lane_count));
+    memset(&s_printer.sched, 0, sizeof(s_printer.sched));
+    s_printer.avg_job_ms = PRINTER_JOB_MS_DEFAULT;
+    s_printer.free_jobs = xQueueCreate(PRINT_QUEUE_SIZE, sizeof(print_job_t *));
+    s_printer.free_chunks = xQueueCreate(PRINT_CHUNK_COUNT, sizeof(print_chunk_t *));
+    if (!s_printer.lane_sem || !s_printer.free_jobs || !s_printer.free_chunks) {
+        ESP_LOGE(TAG, "❌ Error creando cola");
+        printer_deinit_queues();
+        return ESP_ERR_NO_MEM;
+    }
+    
+    for (int i = 0; i < PRINT_QUEUE_SIZE; i++) {
+        print_job_t *job = &s_job_pool[i];
+        xQueueSend(s_printer.free_jobs, &job, 0);
+    }
+    for (int i = 0; i < PRINT_CHUNK_COUNT; i++) {
+        print_chunk_t *chunk = &s_chunk_arena[i];
+        xQueueSend(s_printer.free_chunks, &chunk, 0);
+    }
+    
     s_printer.initialized = true;
     s_printer.stop_usb_host = false;
     
@@ -439,7 +1622,7 @@ esp_err_t printer_init(void)
         client_task,
         "usb_client",
         5 * 1024,  // Mismo stack que el código que funciona
-        NULL,
+        xTaskGetCurrentTaskHandle(),
         CLASS_TASK_PRIORITY,
         &s_printer.client_task_hdl,
         0
@@ -451,10 +1634,30 @@ esp_err_t printer_init(void)
         return ESP_FAIL;
     }
     
-    // Delay para que el cliente se registre
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // Esperar que el cliente se registre
+    ulTaskNotifyTake(false, pdMS_TO_TICKS(1000));
+    
+    // 3. Crear tareas de cada impresora y el dispatcher (prioridad 4)
+    for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "print_dev%d", i);
+        ret = xTaskCreatePinnedToCore(
+            printer_worker_task,
+            name,
+            3 * 1024,
+            &s_printer.devs[i],
+            4,
+            &s_printer.devs[i].task_hdl,
+            0
+        );
+        
+        if (ret != pdTRUE) {
+            ESP_LOGE(TAG, "❌ Error creando tarea de impresora %d", i);
+            printer_deinit();
+            return ESP_FAIL;
+        }
+    }
     
-    // 3. Crear tarea procesadora de impresión (prioridad 4)
     ret = xTaskCreatePinnedToCore(
         printer_process_task,
         "print_queue",
@@ -471,10 +1674,356 @@ esp_err_t printer_init(void)
         return ESP_FAIL;
     }
     
+    // 4. Crear tarea de consulta de estado (prioridad mínima)
+    ret = xTaskCreatePinnedToCore(
+        printer_status_task,
+        "print_status",
+        3 * 1024,
+        NULL,
+        STATUS_TASK_PRIORITY,
+        &s_printer.status_task_hdl,
+        0
+    );
+    
+    if (ret != pdTRUE) {
+        ESP_LOGE(TAG, "❌ Error creando tarea de estado");
+        printer_deinit();
+        return ESP_FAIL;
+    }
+    
     ESP_LOGI(TAG, "✅ Driver inicializado, esperando impresora USB...");
     return ESP_OK;
 }
 
+// ============================================
+// TRABAJOS EN STREAMING
+// ============================================
+
+// Despierta a la tarea de impresora que está drenando el trabajo, si hay una
+static void job_notify_worker(print_job_t *job)
+{
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    TaskHandle_t worker = job->worker;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    if (worker) {
+        xTaskNotifyGive(worker);
+    }
+}
+
+// Publica el chunk en llenado al final de la lista del trabajo y, si es el
+// primero, encola el trabajo. Con close, el trabajo queda cerrado en la misma
+// sección: si ya estaba en cola, desde ahí la tarea de impresión puede
+// terminarlo y liberar el descriptor, así que después no se lo toca más.
+// Llamar solo desde el productor.
+static void job_publish_chunk(print_job_t *job, bool close)
+{
+    print_chunk_t *chunk = job->fill;
+    bool enqueue = false;
+    
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    if (chunk) {
+        job->fill = NULL;
+        if (job->tail) {
+            job->tail->next = chunk;
+        } else {
+            job->head = chunk;
+        }
+        job->tail = chunk;
+    }
+    if (close) {
+        job->closed = true;
+    }
+    if (!job->queued) {
+        job->queued = true;
+        enqueue = true;
+    }
+    TaskHandle_t worker = job->worker;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    // Siempre hay lugar en los carriles: el semáforo cuenta hasta la
+    // cantidad de descriptores. Sin encolar nadie lo libera todavía.
+    if (enqueue) {
+        update_idle(NULL, 1, 0);
+        lane_push(job, false);
+    }
+    if (worker) {
+        xTaskNotifyGive(worker);
+    }
+}
+
+// Devuelve a la arena todos los chunks que queden y libera el descriptor
+static void job_release(print_job_t *job)
+{
+    print_chunk_t *chunk = job->head;
+    while (chunk) {
+        print_chunk_t *next = chunk->next;
+        xQueueSend(s_printer.free_chunks, &chunk, 0);
+        chunk = next;
+    }
+    job->head = NULL;
+    job->tail = NULL;
+    xQueueSend(s_printer.free_jobs, &job, 0);
+}
+
+esp_err_t printer_job_open(printer_job_t **out_job)
+{
+    if (!s_printer.initialized) {
+        ESP_LOGE(TAG, "❌ Driver no inicializado");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (!out_job) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Tomar un descriptor libre (con timeout de 1 segundo)
+    print_job_t *job = NULL;
+    if (xQueueReceive(s_printer.free_jobs, &job, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        ESP_LOGE(TAG, "❌ Cola de impresión llena");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    memset(job, 0, sizeof(*job));
+    // Se abren trabajos desde varias tareas a la vez (HTTP, RAW, spool)
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    job->id = ++s_printer.next_job_id;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    job->prio = PRINTER_PRIO_NORMAL;
+    job->optimize = s_printer.optimize;
+    if (job->optimize) {
+        escpos_opt_init(&job->opt, job_append, job);
+    }
+    *out_job = job;
+    return ESP_OK;
+}
+
+// Copia bytes ya optimizados a los chunks del trabajo
+static esp_err_t job_append(void *ctx, const uint8_t *data, size_t length)
+{
+    print_job_t *job = (print_job_t *)ctx;
+    
+    while (length > 0) {
+        if (!job->fill) {
+            // Backpressure: esperar a que el USB devuelva un chunk
+            if (xQueueReceive(s_printer.free_chunks, &job->fill,
+                              pdMS_TO_TICKS(PRINT_CHUNK_TIMEOUT_MS)) != pdTRUE) {
+                job->fill = NULL;
+                ESP_LOGE(TAG, "❌ Sin chunks libres para trabajo #%lu", job->id);
+                return ESP_ERR_TIMEOUT;
+            }
+            job->fill->next = NULL;
+            job->fill->length = 0;
+        }
+        
+        print_chunk_t *chunk = job->fill;
+        size_t n = PRINT_BUFFER_SIZE - chunk->length;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(chunk->data + chunk->length, data, n);
+        chunk->length += n;
+        job->total += n;
+        data += n;
+        length -= n;
+        
+        // Chunk lleno: publicarlo para que empiece a transmitirse
+        if (chunk->length == PRINT_BUFFER_SIZE) {
+            job_publish_chunk(job, false);
+        }
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t printer_job_write(printer_job_t *job, const uint8_t *data, size_t length)
+{
+    if (!job || (!data && length > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (job->closed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (job->optimize) {
+        return escpos_opt_write(&job->opt, data, length);
+    }
+    return job_append(job, data, length);
+}
+
+esp_err_t printer_job_get_buffer(printer_job_t *job, uint32_t timeout_ms,
+                                 uint8_t **out_buf, size_t *out_space)
+{
+    if (!job || !out_buf || !out_space) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (job->closed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // El optimizador necesita ver los bytes antes de que lleguen al chunk
+    if (job->optimize) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    
+    if (!job->fill) {
+        if (xQueueReceive(s_printer.free_chunks, &job->fill, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+            job->fill = NULL;
+            return ESP_ERR_TIMEOUT;
+        }
+        job->fill->next = NULL;
+        job->fill->length = 0;
+    }
+    
+    *out_buf = job->fill->data + job->fill->length;
+    *out_space = PRINT_BUFFER_SIZE - job->fill->length;
+    return ESP_OK;
+}
+
+esp_err_t printer_job_commit(printer_job_t *job, size_t length)
+{
+    if (!job || !job->fill || length > PRINT_BUFFER_SIZE - job->fill->length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    job->fill->length += length;
+    job->total += length;
+    
+    if (job->fill->length == PRINT_BUFFER_SIZE) {
+        job_publish_chunk(job, false);
+    }
+    return ESP_OK;
+}
+
+esp_err_t printer_job_flush(printer_job_t *job)
+{
+    if (!job) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (job->closed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Un chunk a medio llenar sale igual; el siguiente byte abre otro
+    if (job->fill && job->fill->length > 0) {
+        job_publish_chunk(job, false);
+    }
+    return ESP_OK;
+}
+
+esp_err_t printer_job_set_optimize(printer_job_t *job, bool enable)
+{
+    if (!job || job->queued || job->total > 0 || (job->optimize && job->opt.bytes_in > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (enable && !job->optimize) {
+        escpos_opt_init(&job->opt, job_append, job);
+    }
+    job->optimize = enable;
+    return ESP_OK;
+}
+
+uint32_t printer_job_get_id(const printer_job_t *job)
+{
+    return job ? job->id : 0;
+}
+
+esp_err_t printer_job_set_done_cb(printer_job_t *job, printer_job_done_cb_t cb, void *arg)
+{
+    if (!job || job->queued) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    job->done_cb = cb;
+    job->done_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t printer_job_set_class(printer_job_t *job, printer_prio_t prio, uint32_t client)
+{
+    if (!job || job->queued || prio < 0 || prio >= PRINTER_PRIO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    job->prio = prio;
+    job->client = client;
+    return ESP_OK;
+}
+
+esp_err_t printer_job_close(printer_job_t *job)
+{
+    if (!job) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Lo que el optimizador retiene (avances, cambios de modo) sale ahora
+    if (job->optimize) {
+        esp_err_t ret = escpos_opt_finish(&job->opt);
+        if (ret != ESP_OK) {
+            printer_job_abort(job);
+            return ret;
+        }
+        
+        uint32_t saved = job->opt.bytes_in - job->opt.bytes_out;
+        taskENTER_CRITICAL(&s_printer.job_lock);
+        s_printer.opt_bytes_in += job->opt.bytes_in;
+        s_printer.opt_bytes_saved += saved;
+        taskEXIT_CRITICAL(&s_printer.job_lock);
+        ESP_LOGD(TAG, "🗜️ Trabajo #%lu: %lu → %lu bytes", job->id,
+                 job->opt.bytes_in, job->opt.bytes_out);
+    }
+    
+    if (job->fill && job->fill->length == 0) {
+        xQueueSend(s_printer.free_chunks, &job->fill, 0);
+        job->fill = NULL;
+    }
+    
+    // Un trabajo vacío nunca llegó a la cola: liberarlo directamente
+    if (!job->fill && !job->queued) {
+        if (job->done_cb) {
+            job->done_cb(job->id, true, job->done_arg);
+        }
+        xQueueSend(s_printer.free_jobs, &job, 0);
+        return ESP_OK;
+    }
+    
+    job_publish_chunk(job, true);
+    return ESP_OK;
+}
+
+void printer_job_abort(printer_job_t *job)
+{
+    if (!job) {
+        return;
+    }
+    
+    if (job->fill) {
+        xQueueSend(s_printer.free_chunks, &job->fill, 0);
+        job->fill = NULL;
+    }
+    
+    if (!job->queued) {
+        if (job->done_cb) {
+            job->done_cb(job->id, false, job->done_arg);
+        }
+        xQueueSend(s_printer.free_jobs, &job, 0);
+        return;
+    }
+    
+    // La tarea de impresión descarta lo pendiente y libera el descriptor
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    job->aborted = true;
+    job->closed = true;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    job_notify_worker(job);
+    ESP_LOGW(TAG, "⚠️ Trabajo #%lu abortado", job->id);
+}
+
 esp_err_t printer_send_raw(const uint8_t *data, size_t length)
 {
     if (!s_printer.initialized) {
@@ -487,23 +2036,19 @@ esp_err_t printer_send_raw(const uint8_t *data, size_t length)
         return ESP_ERR_INVALID_ARG;
     }
     
-    if (length > PRINT_BUFFER_SIZE) {
-        ESP_LOGE(TAG, "❌ Datos muy largos (%d bytes, máx %d)", length, PRINT_BUFFER_SIZE);
-        return ESP_ERR_INVALID_SIZE;
+    printer_job_t *job = NULL;
+    esp_err_t ret = printer_job_open(&job);
+    if (ret != ESP_OK) {
+        return ret;
     }
     
-    // Crear trabajo de impresión
-    print_job_t job;
-    memcpy(job.data, data, length);
-    job.length = length;
-    
-    // Encolar (con timeout de 1 segundo)
-    if (xQueueSend(s_printer.print_queue, &job, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        ESP_LOGE(TAG, "❌ Cola de impresión llena");
-        return ESP_ERR_NO_MEM;
+    ret = printer_job_write(job, data, length);
+    if (ret != ESP_OK) {
+        printer_job_abort(job);
+        return ret;
     }
     
-    return ESP_OK;
+    return printer_job_close(job);
 }
 
 esp_err_t printer_send_text(const char *text)
@@ -519,13 +2064,167 @@ esp_err_t printer_send_text(const char *text)
 
 bool printer_is_ready(void)
 {
-    bool ready = false;
-    if (s_printer.mutex) {
-        xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
-        ready = s_printer.printer_ready;
-        xSemaphoreGive(s_printer.mutex);
+    if (!s_printer.events) {
+        return false;
+    }
+    return (xEventGroupGetBits(s_printer.events) & PRINTER_EVT_READY) != 0;
+}
+
+bool printer_wait_ready(uint32_t timeout_ms)
+{
+    if (!s_printer.events) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_printer.events, PRINTER_EVT_READY,
+                                           pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & PRINTER_EVT_READY) != 0;
+}
+
+bool printer_wait_idle(uint32_t timeout_ms)
+{
+    if (!s_printer.events) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_printer.events, PRINTER_EVT_IDLE,
+                                           pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & PRINTER_EVT_IDLE) != 0;
+}
+
+uint32_t printer_estimate_wait_ms(printer_prio_t prio, uint32_t extra_jobs)
+{
+    if (!s_printer.initialized || prio < 0 || prio >= PRINTER_PRIO_COUNT) {
+        return 0;
+    }
+    
+    EventBits_t bits = xEventGroupGetBits(s_printer.events);
+    uint32_t ahead = extra_jobs;
+    uint32_t usable = 0;
+    
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    for (int lane = 0; lane <= prio; lane++) {
+        ahead += s_printer.lane_count[lane];
+    }
+    for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+        EventBits_t ok = PRINTER_EVT_DEV_READY(i) | PRINTER_EVT_DEV_OK(i);
+        ahead += s_printer.devs[i].assigned;
+        if ((bits & ok) == ok) {
+            usable++;
+        }
+    }
+    uint32_t avg_ms = s_printer.avg_job_ms;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    return ahead * avg_ms / (usable ? usable : 1);
+}
+
+void printer_set_optimizer(bool enable)
+{
+    s_printer.optimize = enable;
+    ESP_LOGI(TAG, "🗜️ Optimizador ESC/POS %s", enable ? "activado" : "desactivado");
+}
+
+uint32_t printer_get_bytes_saved(uint32_t *bytes_in)
+{
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    uint32_t saved = s_printer.opt_bytes_saved;
+    if (bytes_in) {
+        *bytes_in = s_printer.opt_bytes_in;
+    }
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    return saved;
+}
+
+int printer_get_device_count(void)
+{
+    return PRINTER_MAX_DEVICES;
+}
+
+bool printer_device_is_ready(int index)
+{
+    if (!s_printer.events || index < 0 || index >= PRINTER_MAX_DEVICES) {
+        return false;
+    }
+    return dev_is_ready(&s_printer.devs[index]);
+}
+
+esp_err_t printer_get_status(int index, printer_status_t *status)
+{
+    if (!status || index < 0 || index >= PRINTER_MAX_DEVICES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!s_printer.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    const printer_dev_t *dev = &s_printer.devs[index];
+    if (!dev_is_ready(dev)) {
+        return ESP_ERR_NOT_FOUND;
     }
-    return ready;
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    *status = dev->status;
+    xSemaphoreGive(s_printer.mutex);
+    return ESP_OK;
+}
+
+const char *printer_status_reason(const printer_status_t *status)
+{
+    if (!status) {
+        return "unknown";
+    }
+    if (status->cover_open) {
+        return "cover_open";
+    }
+    if (status->paper_end) {
+        return "paper_end";
+    }
+    if (status->cutter_error) {
+        return "cutter_error";
+    }
+    if (status->error || status->unrecoverable_error || status->auto_recoverable_error) {
+        return "error";
+    }
+    if (!status->online) {
+        return "offline";
+    }
+    if (status->paper_near_end) {
+        return "paper_near_end";
+    }
+    return "ok";
+}
+
+esp_err_t printer_get_stats(int index, printer_stats_t *stats)
+{
+    if (!stats || index < 0 || index >= PRINTER_MAX_DEVICES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!s_printer.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    const printer_dev_t *dev = &s_printer.devs[index];
+    
+    xSemaphoreTake(s_printer.mutex, portMAX_DELAY);
+    stats->ready = dev_is_ready(dev);
+    stats->dev_addr = dev->dev_addr;
+    stats->vid = dev->dev_hdl ? dev->vid : 0;
+    stats->pid = dev->dev_hdl ? dev->pid : 0;
+    xSemaphoreGive(s_printer.mutex);
+    
+    taskENTER_CRITICAL(&s_printer.job_lock);
+    stats->jobs_assigned = dev->assigned;
+    stats->transfers_inflight = dev->inflight;
+    stats->transfers_sent = dev->xfer_submitted;
+    taskEXIT_CRITICAL(&s_printer.job_lock);
+    
+    stats->jobs_done = dev->jobs_done;
+    stats->jobs_failed = dev->jobs_failed;
+    stats->bytes_sent = dev->bytes_sent;
+    stats->transfer_errors = dev->xfer_errors;
+    return ESP_OK;
 }
 
 void printer_deinit(void)
@@ -539,36 +2238,47 @@ void printer_deinit(void)
     s_printer.initialized = false;
     s_printer.stop_usb_host = true;
     
-    // Liberar impresora si está conectada
-    if (s_printer.dev_hdl) {
-        usb_host_interface_release(s_printer.client_hdl, s_printer.dev_hdl, PRINTER_INTERFACE_NUMBER);
-        usb_host_device_close(s_printer.client_hdl, s_printer.dev_hdl);
-        s_printer.dev_hdl = NULL;
+    // Despertar la tarea cliente bloqueada esperando eventos
+    if (s_printer.client_hdl) {
+        usb_host_client_unblock(s_printer.client_hdl);
+    }
+    
+    // Eliminar tareas de impresión antes de soltar los dispositivos
+    if (s_printer.status_task_hdl) {
+        vTaskDelete(s_printer.status_task_hdl);
+        s_printer.status_task_hdl = NULL;
     }
     
-    // Eliminar tareas
     if (s_printer.print_task_hdl) {
         vTaskDelete(s_printer.print_task_hdl);
         s_printer.print_task_hdl = NULL;
     }
     
-    if (s_printer.client_task_hdl) {
-        vTaskDelete(s_printer.client_task_hdl);
-        s_printer.client_task_hdl = NULL;
+    for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+        if (s_printer.devs[i].task_hdl) {
+            vTaskDelete(s_printer.devs[i].task_hdl);
+            s_printer.devs[i].task_hdl = NULL;
+        }
+        if (s_printer.devs[i].coalesce) {
+            usb_host_transfer_free(s_printer.devs[i].coalesce);
+            s_printer.devs[i].coalesce = NULL;
+        }
     }
     
-    // Eliminar cola y mutex
-    if (s_printer.print_queue) {
-        vQueueDelete(s_printer.print_queue);
-        s_printer.print_queue = NULL;
+    // Liberar impresoras conectadas
+    if (s_printer.mutex) {
+        for (int i = 0; i < PRINTER_MAX_DEVICES; i++) {
+            close_printer_device(&s_printer.devs[i]);
+        }
     }
     
-    if (s_printer.mutex) {
-        vSemaphoreDelete(s_printer.mutex);
-        s_printer.mutex = NULL;
+    if (s_printer.client_task_hdl) {
+        vTaskDelete(s_printer.client_task_hdl);
+        s_printer.client_task_hdl = NULL;
     }
     
-    s_printer.printer_ready = false;
+    // Eliminar colas y mutex
+    printer_deinit_queues();
     
     ESP_LOGI(TAG, "✅ Driver detenido");
 }
\ No newline at end of file
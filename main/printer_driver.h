@@ -46,6 +46,7 @@ void printer_deinit(void);
  * 
  * Sends raw binary data to the printer. The data is queued and sent
  * asynchronously. Supports ESC/POS commands and any printer-specific protocols.
+ * Equivalent to opening a job, writing the whole buffer and closing it.
  * 
  * @param data Pointer to data buffer
  * @param length Length of data in bytes
@@ -53,11 +54,221 @@ void printer_deinit(void);
  *         - ESP_OK: Data queued successfully
  *         - ESP_ERR_INVALID_STATE: Driver not initialized
  *         - ESP_ERR_INVALID_ARG: Invalid parameters
- *         - ESP_ERR_INVALID_SIZE: Data too large
  *         - ESP_ERR_NO_MEM: Print queue full
+ *         - ESP_ERR_TIMEOUT: No free buffers while streaming the data
  */
 esp_err_t printer_send_raw(const uint8_t *data, size_t length);
 
+// ============================================
+// STREAMING PRINT JOBS
+// ============================================
+
+/**
+ * @brief Opaque handle of a streaming print job
+ */
+typedef struct printer_job printer_job_t;
+
+/**
+ * @brief Priority lanes of the print queue
+ * 
+ * A lane is only served when every higher lane is empty. Inside a lane,
+ * jobs are served round-robin across clients.
+ */
+typedef enum {
+    PRINTER_PRIO_OPERATOR = 0,   ///< Operator and test prints
+    PRINTER_PRIO_NORMAL,         ///< Attendee tickets (default)
+    PRINTER_PRIO_BULK,           ///< Batches and reprints
+    PRINTER_PRIO_COUNT
+} printer_prio_t;
+
+/**
+ * @brief Job completion callback
+ * 
+ * Called once per job after its last bulk transfer has completed, or right
+ * away if the job ends without reaching the printer. Runs in the context
+ * of a driver task (possibly the USB client task): it must not block.
+ * 
+ * @param job_id Driver-assigned job number
+ * @param ok true if every byte of the job was accepted by the printer
+ * @param arg User argument given to printer_job_set_done_cb()
+ */
+typedef void (*printer_job_done_cb_t)(uint32_t job_id, bool ok, void *arg);
+
+/**
+ * @brief Open a streaming print job
+ * 
+ * A job is an ordered byte stream of arbitrary length that the print queue
+ * treats as one unit: data from different jobs is never interleaved.
+ * The data is split into bulk-transfer sized chunks and transmission starts
+ * as soon as the first chunk is full, before the job is closed.
+ * 
+ * @param[out] out_job Handle of the new job
+ * @return esp_err_t 
+ *         - ESP_OK: Job opened
+ *         - ESP_ERR_INVALID_STATE: Driver not initialized
+ *         - ESP_ERR_INVALID_ARG: Invalid parameters
+ *         - ESP_ERR_NO_MEM: Print queue full
+ */
+esp_err_t printer_job_open(printer_job_t **out_job);
+
+/**
+ * @brief Append data to an open job
+ * 
+ * Copies the data into driver-owned chunks. Blocks while all chunks are in
+ * use, so a producer can never run ahead of the printer by more than the
+ * driver's buffer pool.
+ * 
+ * @param job Job handle from printer_job_open()
+ * @param data Pointer to data buffer
+ * @param length Length of data in bytes
+ * @return esp_err_t 
+ *         - ESP_OK: Data appended
+ *         - ESP_ERR_INVALID_ARG: Invalid parameters
+ *         - ESP_ERR_INVALID_STATE: Job already closed
+ *         - ESP_ERR_TIMEOUT: No chunk became free in time
+ */
+esp_err_t printer_job_write(printer_job_t *job, const uint8_t *data, size_t length);
+
+/**
+ * @brief Get the free space of the job's current chunk for zero-copy writes
+ * 
+ * Lets a producer (e.g. a socket reader) receive data straight into the
+ * driver's transfer buffers. Waits up to timeout_ms for a free chunk, which
+ * is the backpressure point: while it times out the producer should stop
+ * reading its source. Fill the space and call printer_job_commit().
+ * Only available for jobs with the optimizer disabled.
+ * 
+ * @param job Job handle from printer_job_open()
+ * @param timeout_ms Maximum wait for a free chunk
+ * @param[out] out_buf Where to write
+ * @param[out] out_space Bytes available at out_buf (always > 0)
+ * @return esp_err_t 
+ *         - ESP_OK: Buffer available
+ *         - ESP_ERR_INVALID_ARG: Invalid parameters
+ *         - ESP_ERR_INVALID_STATE: Job already closed
+ *         - ESP_ERR_NOT_SUPPORTED: The job goes through the optimizer
+ *         - ESP_ERR_TIMEOUT: No chunk became free in time
+ */
+esp_err_t printer_job_get_buffer(printer_job_t *job, uint32_t timeout_ms,
+                                 uint8_t **out_buf, size_t *out_space);
+
+/**
+ * @brief Account bytes written into the buffer from printer_job_get_buffer()
+ * 
+ * @param job Job handle from printer_job_open()
+ * @param length Bytes written, at most the space returned
+ * @return esp_err_t 
+ *         - ESP_OK: Bytes appended
+ *         - ESP_ERR_INVALID_ARG: No buffer taken or length too large
+ */
+esp_err_t printer_job_commit(printer_job_t *job, size_t length);
+
+/**
+ * @brief Queue the partially filled chunk of a job for transmission
+ * 
+ * Normally chunks are sent once full or when the job is closed. Producers
+ * that go idle mid-job call this so the printer does not wait for more
+ * data that may take a while to arrive.
+ * 
+ * @param job Job handle from printer_job_open()
+ * @return esp_err_t 
+ *         - ESP_OK: Pending data queued (or nothing pending)
+ *         - ESP_ERR_INVALID_ARG: Invalid job handle
+ *         - ESP_ERR_INVALID_STATE: Job already closed
+ */
+esp_err_t printer_job_flush(printer_job_t *job);
+
+/**
+ * @brief Enable or disable the ESC/POS optimizer for one job
+ * 
+ * Must be called before any data is written. Jobs start with the setting
+ * given to printer_set_optimizer().
+ * 
+ * @param job Job handle from printer_job_open()
+ * @param enable true to optimize this job
+ * @return esp_err_t 
+ *         - ESP_OK: Setting changed
+ *         - ESP_ERR_INVALID_ARG: Invalid handle or data already written
+ */
+esp_err_t printer_job_set_optimize(printer_job_t *job, bool enable);
+
+/**
+ * @brief Close a job
+ * 
+ * Flushes the last partial chunk. The handle must not be used afterwards.
+ * 
+ * @param job Job handle from printer_job_open()
+ * @return esp_err_t 
+ *         - ESP_OK: Job closed
+ *         - ESP_ERR_INVALID_ARG: Invalid job handle
+ */
+esp_err_t printer_job_close(printer_job_t *job);
+
+/**
+ * @brief Get the id of a job
+ * 
+ * Ids are assigned by printer_job_open() and are the ones passed to the
+ * done callback.
+ * 
+ * @param job Job handle from printer_job_open()
+ * @return Job id, 0 for a NULL handle
+ */
+uint32_t printer_job_get_id(const printer_job_t *job);
+
+/**
+ * @brief Request a callback when a job has been fully transferred
+ * 
+ * Must be called before the first chunk of the job is published, i.e.
+ * right after printer_job_open().
+ * 
+ * @param job Job handle from printer_job_open()
+ * @param cb Callback, or NULL to remove it
+ * @param arg User argument passed to the callback
+ * @return esp_err_t 
+ *         - ESP_OK: Callback set
+ *         - ESP_ERR_INVALID_ARG: Invalid handle or job already queued
+ */
+esp_err_t printer_job_set_done_cb(printer_job_t *job, printer_job_done_cb_t cb, void *arg);
+
+/**
+ * @brief Set the lane and the submitting client of a job
+ * 
+ * Must be called right after printer_job_open(). Jobs default to
+ * PRINTER_PRIO_NORMAL and client 0.
+ * 
+ * @param job Job handle from printer_job_open()
+ * @param prio Priority lane
+ * @param client Opaque client key used for round-robin fairness
+ *               (e.g. a hash of the peer address)
+ * @return esp_err_t 
+ *         - ESP_OK: Class set
+ *         - ESP_ERR_INVALID_ARG: Invalid handle or lane, or job already queued
+ */
+esp_err_t printer_job_set_class(printer_job_t *job, printer_prio_t prio, uint32_t client);
+
+/**
+ * @brief Estimate the wait of a new job in a lane
+ * 
+ * Counts the jobs queued in that lane and higher ones plus the jobs already
+ * assigned to printers, and multiplies by the average job time divided by
+ * the number of usable printers.
+ * 
+ * @param prio Lane of the new job
+ * @param extra_jobs Jobs ahead that are queued upstream (e.g. in the spool)
+ * @return Estimated wait in milliseconds
+ */
+uint32_t printer_estimate_wait_ms(printer_prio_t prio, uint32_t extra_jobs);
+
+/**
+ * @brief Abort a job that has not been closed yet
+ * 
+ * Discards any data not yet sent to the printer. Bytes already transmitted
+ * cannot be recalled. The handle must not be used afterwards.
+ * 
+ * @param job Job handle from printer_job_open()
+ */
+void printer_job_abort(printer_job_t *job);
+
 /**
  * @brief Send text string to printer
  * 
@@ -72,18 +283,172 @@ esp_err_t printer_send_raw(const uint8_t *data, size_t length);
  */
 esp_err_t printer_send_text(const char *text);
 
+/**
+ * @brief Enable or disable the ESC/POS optimizer for new jobs
+ * 
+ * When enabled (the default), job data goes through a peephole pass that
+ * drops redundant mode switches and merges feeds before it is queued (see
+ * escpos_opt.h). Jobs already open keep their setting.
+ * 
+ * @param enable true to optimize new jobs
+ */
+void printer_set_optimizer(bool enable);
+
+/**
+ * @brief Bytes the optimizer removed since boot
+ * 
+ * @param[out] bytes_in Bytes the optimizer received (may be NULL)
+ * @return Bytes not sent to the printers
+ */
+uint32_t printer_get_bytes_saved(uint32_t *bytes_in);
+
 /**
  * @brief Check if printer is ready
  * 
  * Returns the current readiness state of the printer.
- * The printer is ready when a compatible USB printer is connected,
- * claimed, and initialized.
+ * The printer is ready when at least one compatible USB printer is
+ * connected, claimed, and initialized.
  * 
  * @return true Printer is connected and ready
  * @return false Printer is not connected or not ready
  */
 bool printer_is_ready(void);
 
+/**
+ * @brief Wait until a printer is ready
+ * 
+ * Blocks on the driver's event group (no polling) until a printer has been
+ * claimed or the timeout expires. Returns immediately if already ready.
+ * 
+ * @param timeout_ms Maximum time to wait in milliseconds
+ * @return true Printer is ready
+ * @return false Timeout expired or driver not initialized
+ */
+bool printer_wait_ready(uint32_t timeout_ms);
+
+/**
+ * @brief Wait until all queued data has been transferred
+ * 
+ * Returns once no job is queued or being sent and every USB transfer has
+ * completed, as signalled from the transfer completion callback.
+ * 
+ * @param timeout_ms Maximum time to wait in milliseconds
+ * @return true Driver is idle
+ * @return false Timeout expired or driver not initialized
+ */
+bool printer_wait_idle(uint32_t timeout_ms);
+
+// ============================================
+// MULTIPLE PRINTERS
+// ============================================
+
+/**
+ * @brief Maximum number of printers claimed at once
+ * 
+ * Printers may be attached directly or behind a USB hub. Jobs are assigned
+ * to the ready printer with the least outstanding work.
+ */
+#define PRINTER_MAX_DEVICES 2
+
+/**
+ * @brief Per-printer counters reported by printer_get_stats()
+ */
+typedef struct {
+    bool ready;                  ///< Printer slot is claimed and accepting jobs
+    uint8_t dev_addr;            ///< USB device address (0 if slot is empty)
+    uint16_t vid;                ///< USB vendor ID
+    uint16_t pid;                ///< USB product ID
+    uint32_t jobs_assigned;      ///< Jobs currently assigned to this printer
+    uint32_t transfers_inflight; ///< Bulk OUT transfers submitted and not completed
+    uint32_t transfers_sent;     ///< Bulk OUT transfers submitted since boot (small jobs share one)
+    uint32_t jobs_done;          ///< Jobs fully sent
+    uint32_t jobs_failed;        ///< Jobs cut short by a disconnect
+    uint32_t bytes_sent;         ///< Bytes submitted to the bulk OUT endpoint
+    uint32_t transfer_errors;    ///< Transfers completed with an error status
+} printer_stats_t;
+
+/**
+ * @brief Get the number of printer slots
+ * 
+ * @return Number of slots, valid indexes are 0 to count - 1
+ */
+int printer_get_device_count(void);
+
+/**
+ * @brief Check if a specific printer is ready
+ * 
+ * @param index Printer slot index
+ * @return true Printer in that slot is connected and ready
+ * @return false Slot is empty, not ready, or index is out of range
+ */
+bool printer_device_is_ready(int index);
+
+/**
+ * @brief Read the counters of a printer slot
+ * 
+ * Counters are kept across reconnects of the slot.
+ * 
+ * @param index Printer slot index
+ * @param stats Output structure
+ * @return 
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: NULL stats or index out of range
+ *     - ESP_ERR_INVALID_STATE: Driver not initialized
+ */
+esp_err_t printer_get_stats(int index, printer_stats_t *stats);
+
+// ============================================
+// PRINTER STATUS
+// ============================================
+
+/**
+ * @brief Printer status decoded from the device
+ * 
+ * Polled in the background with the USB Printer Class GET_PORT_STATUS
+ * request and, when the printer is idle and has a bulk IN endpoint, with
+ * ESC/POS DLE EOT 1-4. Fields that need DLE EOT stay false without it.
+ */
+typedef struct {
+    bool valid;                  ///< At least one status query was answered
+    bool realtime;               ///< Last DLE EOT query was answered
+    bool online;
+    bool cover_open;
+    bool paper_end;
+    bool paper_near_end;
+    bool feed_button;            ///< Paper being fed with the FEED button
+    bool error;                  ///< Any error condition reported
+    bool cutter_error;
+    bool unrecoverable_error;
+    bool auto_recoverable_error;
+    bool fault;                  ///< Dispatch to this printer is paused
+    uint8_t port_status;         ///< Raw GET_PORT_STATUS byte
+} printer_status_t;
+
+/**
+ * @brief Read the last polled status of a printer
+ * 
+ * Jobs are not sent to a printer while status.fault is set. A job already
+ * being sent waits for the fault to clear instead of timing out.
+ * 
+ * @param index Printer slot index
+ * @param status Output structure
+ * @return 
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: NULL status or index out of range
+ *     - ESP_ERR_INVALID_STATE: Driver not initialized
+ *     - ESP_ERR_NOT_FOUND: No printer in that slot
+ */
+esp_err_t printer_get_status(int index, printer_status_t *status);
+
+/**
+ * @brief Short machine-readable reason for a status
+ * 
+ * @param status Status from printer_get_status()
+ * @return One of "ok", "cover_open", "paper_end", "cutter_error", "error",
+ *         "offline", "paper_near_end" or "unknown"
+ */
+const char *printer_status_reason(const printer_status_t *status);
+
 // ============================================
 // ESC/POS COMMAND DEFINITIONS
 // ============================================
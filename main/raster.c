@@ -0,0 +1,237 @@
+#include "raster.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "RASTER";
+
+// Los kernels cargan 8 píxeles en un uint64_t con el píxel 0 en el byte
+// menos significativo
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "raster.c asume una CPU little-endian"
+#endif
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define RASTER_LANES_HI           0x8080808080808080ULL
+#define RASTER_LANES_LO7          0x7F7F7F7F7F7F7F7FULL
+#define RASTER_THRESHOLD_U        0x3F3F3F3F3F3F3F3FULL // gris < 128 en 7 bits
+#define RASTER_GATHER_MAGIC       0x8040201008040201ULL // Bit alto del byte i → bit 7-i
+
+// Matriz de Bayer 8x8 (0..63)
+static const uint8_t s_bayer8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+struct raster {
+    printer_job_t *job;
+    uint16_t width;
+    uint16_t row_bytes;
+    raster_dither_t dither;
+    uint32_t y;                 // Filas procesadas (fase de la matriz de Bayer)
+    uint16_t band_rows;         // Filas ya empaquetadas en band
+    uint8_t *band;              // row_bytes * RASTER_BAND_ROWS
+    int16_t *err;               // Dos filas de error (x16) con un margen a cada lado
+    uint64_t bayer[8];          // Umbrales de 7 bits por fila, 8 carriles
+    esp_err_t error;            // Primer error al escribir en el trabajo
+};
+
+// ============================================
+// KERNELS
+// ============================================
+// Umbral fijo y Bayer: 8 píxeles por iteración en un registro de 64 bits
+// (SWAR). Con el gris reducido a 7 bits, (u | 0x80) - g no pide prestado
+// entre carriles y su bit alto queda en 1 justo cuando g <= u (punto negro).
+// Una multiplicación junta los 8 bits altos en un byte con el píxel 0 en el
+// bit 7, que es el orden de GS v 0.
+
+static inline uint8_t pack8(uint64_t g, uint64_t u)
+{
+    g = (g >> 1) & RASTER_LANES_LO7;
+    uint64_t m = ((u | RASTER_LANES_HI) - g) & RASTER_LANES_HI;
+    return (uint8_t)(((m >> 7) * RASTER_GATHER_MAGIC) >> 56);
+}
+
+static void pack_ordered(const uint8_t *gray, uint8_t *out, uint16_t width, uint64_t u)
+{
+    uint16_t full = width / 8;
+
+    for (uint16_t i = 0; i < full; i++) {
+        uint64_t g;
+        memcpy(&g, gray + 8 * i, sizeof(g));
+        out[i] = pack8(g, u);
+    }
+
+    // Los puntos que sobran del último byte quedan en blanco
+    if (width & 7) {
+        uint8_t tail[8];
+        memset(tail, 0xFF, sizeof(tail));
+        memcpy(tail, gray + 8 * full, width & 7);
+        uint64_t g;
+        memcpy(&g, tail, sizeof(g));
+        out[full] = pack8(g, u);
+    }
+}
+
+// Floyd–Steinberg en enteros con el error escalado x16. El 7/16 hacia la
+// derecha viaja en un registro y la fila siguiente se escribe una sola vez
+// por píxel; los bits se acumulan en un byte en vez de tocar la salida por
+// cada punto.
+static void pack_floyd_steinberg(raster_t *r, const uint8_t *gray, uint8_t *out)
+{
+    int16_t *cur = r->err + 1 + (r->y & 1) * (r->width + 2);
+    int16_t *next = r->err + 1 + (~r->y & 1) * (r->width + 2);
+    int right = 0;
+    uint8_t bits = 0;
+
+    next[-1] = 0;
+    next[0] = 0;
+    for (uint16_t x = 0; x < r->width; x++) {
+        int v = gray[x] + ((cur[x] + right + 8) >> 4);
+        if (v < 0) {
+            v = 0;
+        } else if (v > 255) {
+            v = 255;
+        }
+
+        int black = v < 128;
+        int e = black ? v : v - 255;
+
+        right = 7 * e;
+        next[x - 1] += 3 * e;
+        next[x] += 5 * e;
+        next[x + 1] = e;
+
+        bits = (bits << 1) | black;
+        if ((x & 7) == 7) {
+            *out++ = bits;
+            bits = 0;
+        }
+    }
+
+    if (r->width & 7) {
+        *out = bits << (8 - (r->width & 7));
+    }
+}
+
+// ============================================
+// BANDAS
+// ============================================
+
+static void flush_band(raster_t *r)
+{
+    if (r->band_rows == 0) {
+        return;
+    }
+
+    // GS v 0 m xL xH yL yH: m = 0 (densidad normal), x en bytes, y en puntos
+    const uint8_t cmd[8] = {
+        0x1D, 0x76, 0x30, 0x00,
+        r->row_bytes & 0xFF, r->row_bytes >> 8,
+        r->band_rows & 0xFF, r->band_rows >> 8,
+    };
+
+    if (r->error == ESP_OK) {
+        r->error = printer_job_write(r->job, cmd, sizeof(cmd));
+    }
+    if (r->error == ESP_OK) {
+        r->error = printer_job_write(r->job, r->band, (size_t)r->row_bytes * r->band_rows);
+    }
+    if (r->error != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Error enviando banda: %s", esp_err_to_name(r->error));
+    }
+    r->band_rows = 0;
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+esp_err_t raster_begin(printer_job_t *job, uint16_t width, raster_dither_t dither, raster_t **out)
+{
+    if (!job || !out || width == 0 || width > RASTER_MAX_WIDTH ||
+        dither < RASTER_DITHER_THRESHOLD || dither > RASTER_DITHER_FLOYD_STEINBERG) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    raster_t *r = calloc(1, sizeof(*r));
+    if (!r) {
+        return ESP_ERR_NO_MEM;
+    }
+    r->job = job;
+    r->width = width;
+    r->row_bytes = (width + 7) / 8;
+    r->dither = dither;
+    r->band = malloc((size_t)r->row_bytes * RASTER_BAND_ROWS);
+    if (dither == RASTER_DITHER_FLOYD_STEINBERG) {
+        r->err = calloc(2 * (width + 2), sizeof(int16_t));
+    }
+    if (!r->band || (dither == RASTER_DITHER_FLOYD_STEINBERG && !r->err)) {
+        free(r->band);
+        free(r->err);
+        free(r);
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int row = 0; row < 8; row++) {
+        uint64_t u = RASTER_THRESHOLD_U;
+        if (dither == RASTER_DITHER_BAYER) {
+            u = 0;
+            for (int i = 0; i < 8; i++) {
+                u |= (uint64_t)(2 * s_bayer8[row][i]) << (8 * i);
+            }
+        }
+        r->bayer[row] = u;
+    }
+
+    *out = r;
+    return ESP_OK;
+}
+
+esp_err_t raster_write_rows(raster_t *raster, const uint8_t *gray, size_t stride, uint16_t rows)
+{
+    if (!raster || (!gray && rows > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint16_t i = 0; i < rows && raster->error == ESP_OK; i++) {
+        uint8_t *out = raster->band + (size_t)raster->band_rows * raster->row_bytes;
+        if (raster->dither == RASTER_DITHER_FLOYD_STEINBERG) {
+            pack_floyd_steinberg(raster, gray, out);
+        } else {
+            pack_ordered(gray, out, raster->width, raster->bayer[raster->y & 7]);
+        }
+        gray += stride;
+        raster->y++;
+
+        if (++raster->band_rows == RASTER_BAND_ROWS) {
+            flush_band(raster);
+        }
+    }
+
+    return raster->error;
+}
+
+esp_err_t raster_end(raster_t *raster)
+{
+    if (!raster) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    flush_band(raster);
+    esp_err_t ret = raster->error;
+
+    ESP_LOGD(TAG, "Imagen de %dx%lu enviada", raster->width, raster->y);
+    free(raster->band);
+    free(raster->err);
+    free(raster);
+    return ret;
+}
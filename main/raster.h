@@ -0,0 +1,83 @@
+/**
+ * @file raster.h
+ * @brief Streaming raster image printing
+ *
+ * Converts 8-bit grayscale rows into 1bpp with a selectable dither and sends
+ * them to a print job as ESC/POS `GS v 0` bands. Rows are consumed as they
+ * arrive, so memory use is bounded by one band regardless of the image
+ * height.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "printer_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RASTER_MAX_WIDTH 1024   ///< Widest image in dots (576 for 80 mm heads)
+#define RASTER_BAND_ROWS 24     ///< Rows sent per `GS v 0` command
+
+/**
+ * @brief Grayscale to 1bpp conversion
+ */
+typedef enum {
+    RASTER_DITHER_THRESHOLD,        ///< Fixed threshold at 50% (logos, text)
+    RASTER_DITHER_BAYER,            ///< 8x8 ordered dither (fast, regular pattern)
+    RASTER_DITHER_FLOYD_STEINBERG,  ///< Error diffusion (best for photos)
+} raster_dither_t;
+
+/**
+ * @brief Opaque handle of a raster image being streamed
+ */
+typedef struct raster raster_t;
+
+/**
+ * @brief Start an image inside a print job
+ *
+ * @param job Open print job the bands are written to
+ * @param width Image width in dots (1..RASTER_MAX_WIDTH)
+ * @param dither Conversion to apply
+ * @param[out] out Raster handle
+ * @return esp_err_t
+ *         - ESP_OK: Ready for rows
+ *         - ESP_ERR_INVALID_ARG: Invalid job, width or dither
+ *         - ESP_ERR_NO_MEM: No memory for the band buffer
+ */
+esp_err_t raster_begin(printer_job_t *job, uint16_t width, raster_dither_t dither, raster_t **out);
+
+/**
+ * @brief Add grayscale rows to the image
+ *
+ * Every completed band is sent to the job immediately.
+ *
+ * @param raster Handle from raster_begin()
+ * @param gray First row, one byte per dot (0 = black, 255 = white)
+ * @param stride Distance in bytes between consecutive rows
+ * @param rows Number of rows
+ * @return esp_err_t
+ *         - ESP_OK: Rows consumed
+ *         - ESP_ERR_INVALID_ARG: Invalid parameters
+ *         - Any error from printer_job_write()
+ */
+esp_err_t raster_write_rows(raster_t *raster, const uint8_t *gray, size_t stride, uint16_t rows);
+
+/**
+ * @brief Send the last partial band and free the handle
+ *
+ * The print job stays open. The handle is freed even on error.
+ *
+ * @param raster Handle from raster_begin()
+ * @return esp_err_t
+ *         - ESP_OK: Image complete
+ *         - Any error from printer_job_write()
+ */
+esp_err_t raster_end(raster_t *raster);
+
+#ifdef __cplusplus
+}
+#endif
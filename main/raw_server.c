@@ -0,0 +1,258 @@
+#include "raw_server.h"
+#include "printer_driver.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "RAW9100";
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define RAW_SERVER_BACKLOG        4     // Conexiones esperando turno
+#define RAW_SERVER_TASK_STACK     4096
+#define RAW_SERVER_TASK_PRIORITY  3
+#define RAW_FLUSH_IDLE_MS         100   // Sin datos por este tiempo: enviar lo recibido
+#define RAW_IDLE_TIMEOUT_MS       30000 // Sin datos por este tiempo: cerrar el trabajo
+#define RAW_CHUNK_WAIT_MS         1000  // Espera por buffer antes de volver a intentar
+#define RAW_STALL_TIMEOUT_MS      60000 // Impresora sin avanzar: abandonar la conexión
+
+static raw_server_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task_hdl = NULL;
+
+// ============================================
+// CONEXIÓN
+// ============================================
+
+// Un trabajo por conexión. Se abre con el primer byte, así un escaneo de
+// puertos no deja trabajos vacíos.
+static void serve_connection(int sock)
+{
+    printer_job_t *job = NULL;
+    uint32_t client = web_sockfd_client_id(sock);
+    uint32_t received = 0;
+    uint32_t idle_ms = 0;
+    int64_t start_us = 0;
+    bool flushed = true;
+    uint8_t probe;
+    esp_err_t ret = ESP_OK;
+
+    struct timeval tv = {
+        .tv_sec = 0,
+        .tv_usec = RAW_FLUSH_IDLE_MS * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    while (ret == ESP_OK) {
+        uint8_t *buf = NULL;
+        size_t space = 0;
+
+        if (job) {
+            // Backpressure: mientras no haya buffer no se lee el socket
+            uint32_t stalled_ms = 0;
+            while ((ret = printer_job_get_buffer(job, RAW_CHUNK_WAIT_MS, &buf, &space)) == ESP_ERR_TIMEOUT) {
+                if (stalled_ms == 0) {
+                    taskENTER_CRITICAL(&s_stats_lock);
+                    s_stats.stalls++;
+                    taskEXIT_CRITICAL(&s_stats_lock);
+                }
+                stalled_ms += RAW_CHUNK_WAIT_MS;
+                if (stalled_ms >= RAW_STALL_TIMEOUT_MS) {
+                    ESP_LOGE(TAG, "❌ Impresora sin avanzar, se abandona la conexión");
+                    break;
+                }
+            }
+            if (ret != ESP_OK) {
+                break;
+            }
+        } else {
+            // Antes del primer byte basta con mirar si hay datos
+            buf = &probe;
+        }
+
+        int n = recv(sock, buf, space ? space : 1, space ? 0 : MSG_PEEK);
+        if (n == 0) {
+            break;                      // El cliente terminó de enviar
+        }
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                ESP_LOGW(TAG, "⚠️ Error de socket: %d", errno);
+                break;
+            }
+            // Pausa del cliente: que la impresora no espere el resto del chunk
+            if (job && !flushed) {
+                printer_job_flush(job);
+                flushed = true;
+            }
+            idle_ms += RAW_FLUSH_IDLE_MS;
+            if (idle_ms >= RAW_IDLE_TIMEOUT_MS) {
+                ESP_LOGW(TAG, "⚠️ Conexión inactiva, se cierra el trabajo");
+                break;
+            }
+            continue;
+        }
+        idle_ms = 0;
+
+        if (!job) {
+            ret = printer_job_open(&job);
+            if (ret == ESP_OK) {
+                printer_job_set_class(job, PRINTER_PRIO_NORMAL, client);
+                // Flujo ajeno: se envía tal cual
+                printer_job_set_optimize(job, false);
+                start_us = esp_timer_get_time();
+            }
+            continue;
+        }
+
+        printer_job_commit(job, n);
+        received += n;
+        flushed = false;
+    }
+
+    if (!job) {
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "❌ No se pudo abrir trabajo: %s", esp_err_to_name(ret));
+        }
+        return;
+    }
+
+    // Lo recibido se imprime aunque la conexión termine mal, como JetDirect
+    if (received > 0) {
+        ret = printer_job_close(job);
+    } else {
+        printer_job_abort(job);
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    uint32_t bps = elapsed_us > 0 ? (uint32_t)((uint64_t)received * 1000000 / elapsed_us) : 0;
+
+    taskENTER_CRITICAL(&s_stats_lock);
+    s_stats.jobs += received > 0;
+    s_stats.bytes += received;
+    s_stats.last_bytes = received;
+    s_stats.last_bytes_per_s = bps;
+    taskEXIT_CRITICAL(&s_stats_lock);
+
+    ESP_LOGI(TAG, "✅ Trabajo de %lu bytes en %lld ms (%lu B/s) → %s",
+             received, elapsed_us / 1000, bps, esp_err_to_name(ret));
+}
+
+// ============================================
+// TAREA DEL SERVIDOR
+// ============================================
+
+static void raw_server_task(void *arg)
+{
+    struct sockaddr_in bind_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(RAW_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int opt = 1;
+
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (listen_sock < 0) {
+        ESP_LOGE(TAG, "❌ No se pudo crear el socket: %d", errno);
+        s_task_hdl = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    if (bind(listen_sock, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) != 0 ||
+        listen(listen_sock, RAW_SERVER_BACKLOG) != 0) {
+        ESP_LOGE(TAG, "❌ No se pudo escuchar en el puerto %d: %d", RAW_SERVER_PORT, errno);
+        close(listen_sock);
+        s_task_hdl = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    ESP_LOGI(TAG, "🖨️ Servidor RAW escuchando en el puerto %d", RAW_SERVER_PORT);
+
+    while (1) {
+        struct sockaddr_storage peer;
+        socklen_t peer_len = sizeof(peer);
+        int sock = accept(listen_sock, (struct sockaddr *)&peer, &peer_len);
+        if (sock < 0) {
+            ESP_LOGW(TAG, "⚠️ Error en accept: %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.connections++;
+        s_stats.busy = true;
+        taskEXIT_CRITICAL(&s_stats_lock);
+
+        ESP_LOGI(TAG, "🔌 Conexión #%lu", s_stats.connections);
+        serve_connection(sock);
+        shutdown(sock, SHUT_RDWR);
+        close(sock);
+
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.busy = false;
+        taskEXIT_CRITICAL(&s_stats_lock);
+    }
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+esp_err_t raw_server_start(void)
+{
+    if (s_task_hdl) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xTaskCreate(raw_server_task, "raw9100", RAW_SERVER_TASK_STACK, NULL,
+                    RAW_SERVER_TASK_PRIORITY, &s_task_hdl) != pdPASS) {
+        s_task_hdl = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void raw_server_get_stats(raw_server_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_stats_lock);
+}
+
+static esp_err_t raw_status_handler(httpd_req_t *req)
+{
+    raw_server_stats_t st;
+    char json[192];
+
+    raw_server_get_stats(&st);
+    int len = snprintf(json, sizeof(json),
+                       "{\"port\":%d,\"busy\":%s,\"connections\":%lu,\"jobs\":%lu,"
+                       "\"bytes\":%lu,\"stalls\":%lu,\"last_bytes\":%lu,\"last_bytes_per_s\":%lu}",
+                       RAW_SERVER_PORT, st.busy ? "true" : "false", st.connections, st.jobs,
+                       st.bytes, st.stalls, st.last_bytes, st.last_bytes_per_s);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, json, len);
+}
+
+esp_err_t raw_server_register(httpd_handle_t server)
+{
+    httpd_uri_t status_uri = {
+        .uri = "/raw_status",
+        .method = HTTP_GET,
+        .handler = raw_status_handler,
+        .user_ctx = NULL
+    };
+    return httpd_register_uri_handler(server, &status_uri);
+}
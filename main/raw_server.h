@@ -0,0 +1,68 @@
+/**
+ * @file raw_server.h
+ * @brief Raw TCP print server (port 9100, JetDirect style)
+ *
+ * Accepts ESC/POS byte streams from PCs and POS systems and forwards them to
+ * the printer unchanged. Each connection is one print job. Connections are
+ * served one at a time; others wait in the listen backlog.
+ *
+ * Data is received straight into the driver's transfer buffers. While all
+ * buffers are in use the server stops reading the socket, so TCP flow
+ * control pushes back on the sender instead of anything being buffered on
+ * the device.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RAW_SERVER_PORT 9100
+
+/**
+ * @brief Throughput counters
+ */
+typedef struct {
+    uint32_t connections;           ///< Connections accepted since boot
+    uint32_t jobs;                  ///< Jobs queued (connections that sent data)
+    uint32_t bytes;                 ///< Bytes received since boot
+    uint32_t stalls;                ///< Times the printer pipeline was full
+    uint32_t last_bytes;            ///< Bytes of the last finished job
+    uint32_t last_bytes_per_s;      ///< Throughput of the last finished job
+    bool busy;                      ///< A connection is being served
+} raw_server_stats_t;
+
+/**
+ * @brief Start listening on RAW_SERVER_PORT
+ *
+ * Call after the network is up and printer_init() has run.
+ *
+ * @return esp_err_t
+ *         - ESP_OK: Server task started
+ *         - ESP_ERR_INVALID_STATE: Already started
+ *         - ESP_ERR_NO_MEM: Could not create the task
+ */
+esp_err_t raw_server_start(void);
+
+/**
+ * @brief Read the throughput counters
+ */
+void raw_server_get_stats(raw_server_stats_t *stats);
+
+/**
+ * @brief Register `GET /raw_status`, which returns the counters as JSON
+ *
+ * @param server Running HTTP server
+ * @return esp_err_t Result of httpd_register_uri_handler()
+ */
+esp_err_t raw_server_register(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
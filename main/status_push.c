@@ -0,0 +1,204 @@
+#include "status_push.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+static const char *TAG = "STATUS_PUSH";
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define STATUS_PUSH_MAX_FDS       CONFIG_LWIP_MAX_SOCKETS
+#define STATUS_PUSH_RX_MAX        32    // Los clientes no mandan nada útil
+
+static httpd_handle_t s_server = NULL;
+static status_push_snapshot_fn_t s_snapshot = NULL;
+static esp_timer_handle_t s_timer = NULL;
+static volatile bool s_check_queued = false;
+
+// Último snapshot enviado; solo se toca desde la tarea del servidor HTTP
+static char s_last[STATUS_PUSH_MAX_LEN];
+static int s_last_len = 0;
+
+// ============================================
+// ENVÍO
+// ============================================
+
+static void send_text(int fd, const char *text, size_t len)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)text,
+        .len = len,
+    };
+
+    if (httpd_ws_send_frame_async(s_server, fd, &frame) != ESP_OK) {
+        ESP_LOGD(TAG, "Cliente %d no responde, se cierra", fd);
+        httpd_sess_trigger_close(s_server, fd);
+    }
+}
+
+// Arma el snapshot una sola vez y lo manda a todos si cambió. Devuelve si
+// hubo envío.
+static bool check_and_broadcast(void)
+{
+    int fds[STATUS_PUSH_MAX_FDS];
+    size_t count = STATUS_PUSH_MAX_FDS;
+    size_t ws_count = 0;
+    char snap[STATUS_PUSH_MAX_LEN];
+
+    if (httpd_get_client_list(s_server, &count, fds) != ESP_OK) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (httpd_ws_get_fd_info(s_server, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            fds[ws_count++] = fds[i];
+        }
+    }
+    // Sin nadie escuchando no se consulta al driver
+    if (ws_count == 0) {
+        return false;
+    }
+
+    int len = s_snapshot(snap, sizeof(snap));
+    if (len < 0 || len >= (int)sizeof(snap)) {
+        return false;
+    }
+    if (len == s_last_len && memcmp(snap, s_last, len) == 0) {
+        return false;
+    }
+    memcpy(s_last, snap, len);
+    s_last_len = len;
+
+    for (size_t i = 0; i < ws_count; i++) {
+        send_text(fds[i], s_last, s_last_len);
+    }
+    return true;
+}
+
+static void check_work(void *arg)
+{
+    s_check_queued = false;
+    check_and_broadcast();
+}
+
+// Cliente recién conectado: si el chequeo no le mandó nada, recibe el
+// último snapshot (que sigue vigente)
+static void welcome_work(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+
+    if (!check_and_broadcast() && s_last_len > 0 &&
+        httpd_ws_get_fd_info(s_server, fd) == HTTPD_WS_CLIENT_WEBSOCKET) {
+        send_text(fd, s_last, s_last_len);
+    }
+}
+
+static void check_timer_cb(void *arg)
+{
+    status_push_notify();
+}
+
+// ============================================
+// HANDLER WEBSOCKET
+// ============================================
+
+static esp_err_t status_ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // Handshake: el socket pasa a WebSocket al volver de acá
+        int fd = httpd_req_to_sockfd(req);
+        ESP_LOGI(TAG, "🔌 Cliente de estado conectado (fd %d)", fd);
+        httpd_queue_work(req->handle, welcome_work, (void *)(intptr_t)fd);
+        return ESP_OK;
+    }
+
+    // Se lee y descarta lo que llegue; PING y CLOSE los atiende el servidor
+    uint8_t buf[STATUS_PUSH_RX_MAX];
+    httpd_ws_frame_t frame = { 0 };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK || frame.len == 0) {
+        return ret;
+    }
+    if (frame.len > sizeof(buf)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    frame.payload = buf;
+    return httpd_ws_recv_frame(req, &frame, frame.len);
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+esp_err_t status_push_register(httpd_handle_t server, const char *uri,
+                               status_push_snapshot_fn_t snapshot)
+{
+    if (s_server) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Antes de registrar: el primer handshake puede llegar enseguida
+    s_server = server;
+    s_snapshot = snapshot;
+
+    httpd_uri_t ws_uri = {
+        .uri = uri,
+        .method = HTTP_GET,
+        .handler = status_ws_handler,
+        .user_ctx = NULL,
+        .is_websocket = true,
+    };
+    esp_err_t ret = httpd_register_uri_handler(server, &ws_uri);
+    if (ret != ESP_OK) {
+        s_server = NULL;
+        return ret;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = check_timer_cb,
+        .name = "status_push",
+    };
+    ret = esp_timer_create(&timer_args, &s_timer);
+    if (ret != ESP_OK) {
+        httpd_unregister_uri_handler(server, uri, HTTP_GET);
+        s_server = NULL;
+        return ret;
+    }
+
+    esp_timer_start_periodic(s_timer, STATUS_PUSH_CHECK_MS * 1000);
+
+    ESP_LOGI(TAG, "📡 Estado por WebSocket en %s", uri);
+    return ESP_OK;
+}
+
+void status_push_notify(void)
+{
+    if (!s_server || s_check_queued) {
+        return;
+    }
+    s_check_queued = true;
+    if (httpd_queue_work(s_server, check_work, NULL) != ESP_OK) {
+        s_check_queued = false;
+    }
+}
+
+#else
+
+esp_err_t status_push_register(httpd_handle_t server, const char *uri,
+                               status_push_snapshot_fn_t snapshot)
+{
+    ESP_LOGW(TAG, "⚠️ CONFIG_HTTPD_WS_SUPPORT desactivado: los clientes consultan el estado");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void status_push_notify(void)
+{
+}
+
+#endif // CONFIG_HTTPD_WS_SUPPORT
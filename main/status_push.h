@@ -0,0 +1,64 @@
+/**
+ * @file status_push.h
+ * @brief Printer status pushed to browsers over WebSocket
+ *
+ * Instead of every open page polling a status endpoint, pages open one
+ * WebSocket and the server sends them a JSON snapshot when it changes.
+ * The snapshot is built once per check no matter how many clients are
+ * connected, and nothing is sent while it stays the same. A new client
+ * gets the current snapshot right after the handshake.
+ *
+ * Needs CONFIG_HTTPD_WS_SUPPORT. Without it status_push_register() returns
+ * ESP_ERR_NOT_SUPPORTED and pages fall back to polling.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATUS_PUSH_CHECK_MS   500     ///< How often the snapshot is compared
+#define STATUS_PUSH_MAX_LEN    320     ///< Largest snapshot
+
+/**
+ * @brief Snapshot builder
+ *
+ * @param buf Destination
+ * @param size Size of buf
+ * @return Length written (not counting the terminator), or < 0 on error
+ */
+typedef int (*status_push_snapshot_fn_t)(char *buf, size_t size);
+
+/**
+ * @brief Register the WebSocket endpoint and start watching the snapshot
+ *
+ * Only one endpoint is supported.
+ *
+ * @param server Running HTTP server
+ * @param uri WebSocket URI, e.g. "/status_ws"
+ * @param snapshot Builds the JSON sent to clients (runs on the HTTP server task)
+ * @return esp_err_t
+ *         - ESP_OK: Endpoint registered
+ *         - ESP_ERR_NOT_SUPPORTED: WebSocket support disabled in sdkconfig
+ *         - ESP_ERR_INVALID_STATE: Already registered
+ *         - Any error from esp_timer_create() or httpd_register_uri_handler()
+ */
+esp_err_t status_push_register(httpd_handle_t server, const char *uri,
+                               status_push_snapshot_fn_t snapshot);
+
+/**
+ * @brief Check the snapshot now instead of at the next period
+ *
+ * Call after something that changes the snapshot (e.g. a new message).
+ * Safe from any task; does nothing if the endpoint is not registered.
+ */
+void status_push_notify(void);
+
+#ifdef __cplusplus
+}
+#endif
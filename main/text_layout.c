@@ -0,0 +1,309 @@
+#include "text_layout.h"
+#include <stdbool.h>
+#include <string.h>
+
+// ============================================
+// TABLAS
+// ============================================
+// Tablas fijas en flash (generadas de los mapeos estándar de CP850, CP858
+// y Windows-1252); convertir un carácter es una indexación o una búsqueda
+// binaria, nunca un cálculo.
+
+// U+00A0..U+00FF → CP850. CP858 coincide en este rango y WPC1252 es la
+// identidad.
+static const uint8_t s_latin1_cp850[96] = {
+    0xFF, 0xAD, 0xBD, 0x9C, 0xCF, 0xBE, 0xDD, 0xF5, 0xF9, 0xB8, 0xA6, 0xAE, 0xAA, 0xF0, 0xA9, 0xEE,
+    0xF8, 0xF1, 0xFD, 0xFC, 0xEF, 0xE6, 0xF4, 0xFA, 0xF7, 0xFB, 0xA7, 0xAF, 0xAC, 0xAB, 0xF3, 0xA8,
+    0xB7, 0xB5, 0xB6, 0xC7, 0x8E, 0x8F, 0x92, 0x80, 0xD4, 0x90, 0xD2, 0xD3, 0xDE, 0xD6, 0xD7, 0xD8,
+    0xD1, 0xA5, 0xE3, 0xE0, 0xE2, 0xE5, 0x99, 0x9E, 0x9D, 0xEB, 0xE9, 0xEA, 0x9A, 0xED, 0xE8, 0xE1,
+    0x85, 0xA0, 0x83, 0xC6, 0x84, 0x86, 0x91, 0x87, 0x8A, 0x82, 0x88, 0x89, 0x8D, 0xA1, 0x8C, 0x8B,
+    0xD0, 0xA4, 0x95, 0xA2, 0x93, 0xE4, 0x94, 0xF6, 0x9B, 0x97, 0xA3, 0x96, 0x81, 0xEC, 0xE7, 0x98,
+};
+
+// Caracteres fuera de Latin-1 que aparecen en mensajes reales (teclados de
+// celulares ponen comillas tipográficas y guiones largos). 0 = la página no
+// lo tiene y se usa el reemplazo. Ordenada por código para búsqueda binaria.
+typedef struct {
+    uint16_t cp;
+    uint8_t cp850;
+    uint8_t cp858;
+    uint8_t wpc1252;
+    char fallback[4];
+} text_extra_t;
+
+static const text_extra_t s_extras[] = {
+    { 0x0131, 0xD5, 0x00, 0x00, "i" },      // ı
+    { 0x0152, 0x00, 0x00, 0x8C, "OE" },     // Œ
+    { 0x0153, 0x00, 0x00, 0x9C, "oe" },     // œ
+    { 0x0160, 0x00, 0x00, 0x8A, "S" },      // Š
+    { 0x0161, 0x00, 0x00, 0x9A, "s" },      // š
+    { 0x0178, 0x00, 0x00, 0x9F, "Y" },      // Ÿ
+    { 0x017D, 0x00, 0x00, 0x8E, "Z" },      // Ž
+    { 0x017E, 0x00, 0x00, 0x9E, "z" },      // ž
+    { 0x0192, 0x9F, 0x9F, 0x83, "f" },      // ƒ
+    { 0x02C6, 0x00, 0x00, 0x88, "^" },      // ˆ
+    { 0x02DC, 0x00, 0x00, 0x98, "~" },      // ˜
+    { 0x2013, 0x00, 0x00, 0x96, "-" },      // –
+    { 0x2014, 0x00, 0x00, 0x97, "-" },      // —
+    { 0x2018, 0x00, 0x00, 0x91, "'" },      // ‘
+    { 0x2019, 0x00, 0x00, 0x92, "'" },      // ’
+    { 0x201A, 0x00, 0x00, 0x82, "," },      // ‚
+    { 0x201C, 0x00, 0x00, 0x93, "\"" },     // “
+    { 0x201D, 0x00, 0x00, 0x94, "\"" },     // ”
+    { 0x201E, 0x00, 0x00, 0x84, "\"" },     // „
+    { 0x2020, 0x00, 0x00, 0x86, "+" },      // †
+    { 0x2021, 0x00, 0x00, 0x87, "+" },      // ‡
+    { 0x2022, 0x00, 0x00, 0x95, "*" },      // •
+    { 0x2026, 0x00, 0x00, 0x85, "..." },    // …
+    { 0x2030, 0x00, 0x00, 0x89, "%o" },     // ‰
+    { 0x2039, 0x00, 0x00, 0x8B, "<" },      // ‹
+    { 0x203A, 0x00, 0x00, 0x9B, ">" },      // ›
+    { 0x20AC, 0x00, 0xD5, 0x80, "EUR" },    // €
+    { 0x2122, 0x00, 0x00, 0x99, "TM" },     // ™
+};
+
+#define TEXT_EXTRAS_COUNT         (sizeof(s_extras) / sizeof(s_extras[0]))
+#define TEXT_REPLACEMENT          '?'
+
+static text_layout_t s_layout = {
+    .codepage = TEXT_CODEPAGE_CP858,
+    .columns = 32,
+};
+
+// ============================================
+// SALIDA CON CORTE DE LÍNEA
+// ============================================
+// La palabra en curso se arma en un buffer del tamaño de una línea. Sin
+// corte (columns = 0) el mismo buffer agrupa bytes para no llamar al
+// builder por cada carácter.
+
+typedef struct {
+    escpos_t *b;
+    uint8_t columns;
+    uint8_t col;                // Columna actual de la línea
+    uint8_t wlen;               // Bytes en word
+    bool space;                 // Hay un espacio pendiente antes de la palabra
+    uint8_t word[TEXT_LAYOUT_MAX_COLUMNS];
+} wrap_t;
+
+static void wrap_flush(wrap_t *w)
+{
+    if (w->wlen == 0) {
+        return;
+    }
+
+    if (w->columns) {
+        if (w->col > 0 && w->col + w->space + w->wlen > w->columns) {
+            escpos_raw(w->b, "\n", 1);
+            w->col = 0;
+            w->space = false;
+        }
+        if (w->space) {
+            escpos_raw(w->b, " ", 1);
+            w->col++;
+            w->space = false;
+        }
+        w->col += w->wlen;
+    }
+
+    escpos_raw(w->b, w->word, w->wlen);
+    w->wlen = 0;
+}
+
+static void wrap_put(wrap_t *w, uint8_t c)
+{
+    if (w->columns) {
+        if (c == ' ') {
+            wrap_flush(w);
+            w->space = (w->col > 0);
+            return;
+        }
+        if (c == '\n') {
+            wrap_flush(w);
+            escpos_raw(w->b, "\n", 1);
+            w->col = 0;
+            w->space = false;
+            return;
+        }
+    }
+
+    w->word[w->wlen++] = c;
+
+    // Palabra del ancho de una línea (o buffer lleno sin corte): se parte
+    if (w->wlen == (w->columns ? w->columns : sizeof(w->word))) {
+        wrap_flush(w);
+    }
+}
+
+static void wrap_puts(wrap_t *w, const char *s)
+{
+    while (*s) {
+        wrap_put(w, (uint8_t)*s++);
+    }
+}
+
+// ============================================
+// TRANSCODIFICACIÓN
+// ============================================
+
+static const text_extra_t *find_extra(uint32_t cp)
+{
+    int lo = 0;
+    int hi = TEXT_EXTRAS_COUNT - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (s_extras[mid].cp == cp) {
+            return &s_extras[mid];
+        }
+        if (s_extras[mid].cp < cp) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+// Marcas combinantes, espacios de ancho cero, selectores de variante y
+// modificadores de tono de emoji: no ocupan lugar, se descartan
+static bool is_invisible(uint32_t cp)
+{
+    return (cp >= 0x0300 && cp <= 0x036F) ||
+           (cp >= 0x200B && cp <= 0x200F) ||
+           cp == 0x2060 || cp == 0xFEFF ||
+           (cp >= 0xFE00 && cp <= 0xFE0F) ||
+           (cp >= 0x1F3FB && cp <= 0x1F3FF);
+}
+
+static void emit_codepoint(wrap_t *w, uint32_t cp, text_codepage_t page)
+{
+    if (cp >= 0xA0 && cp <= 0xFF) {
+        if (cp == 0xAD) {
+            return;                         // Guion opcional
+        }
+        // NBSP (0xA0) no es ' ': se imprime como carácter y no corta
+        wrap_put(w, page == TEXT_CODEPAGE_WPC1252 ? (uint8_t)cp : s_latin1_cp850[cp - 0xA0]);
+        return;
+    }
+    if (cp < 0xA0 || is_invisible(cp)) {
+        return;                             // Controles C1
+    }
+
+    const text_extra_t *extra = find_extra(cp);
+    if (!extra) {
+        wrap_put(w, TEXT_REPLACEMENT);
+        return;
+    }
+
+    uint8_t c = page == TEXT_CODEPAGE_WPC1252 ? extra->wpc1252 :
+                page == TEXT_CODEPAGE_CP858 ? extra->cp858 : extra->cp850;
+    if (c) {
+        wrap_put(w, c);
+    } else {
+        wrap_puts(w, extra->fallback);
+    }
+}
+
+static void transcode(wrap_t *w, const uint8_t *s, size_t len, text_codepage_t page)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        uint8_t c = s[i];
+
+        // ASCII: el caso común, sin tablas
+        if (c < 0x80) {
+            i++;
+            if (c >= 0x20 && c != 0x7F) {
+                wrap_put(w, c);
+            } else if (c == '\n') {
+                wrap_put(w, '\n');
+            } else if (c == '\t') {
+                wrap_put(w, ' ');
+            }
+            continue;
+        }
+
+        uint32_t cp;
+        size_t n;
+        if ((c & 0xE0) == 0xC0) {
+            cp = c & 0x1F;
+            n = 1;
+        } else if ((c & 0xF0) == 0xE0) {
+            cp = c & 0x0F;
+            n = 2;
+        } else if ((c & 0xF8) == 0xF0) {
+            cp = c & 0x07;
+            n = 3;
+        } else {
+            // Byte de continuación suelto o inválido
+            wrap_put(w, TEXT_REPLACEMENT);
+            i++;
+            continue;
+        }
+
+        size_t k = 1;
+        while (k <= n && i + k < len && (s[i + k] & 0xC0) == 0x80) {
+            cp = (cp << 6) | (s[i + k] & 0x3F);
+            k++;
+        }
+        if (k <= n) {
+            // Secuencia cortada: reemplazar y seguir desde el byte que la cortó
+            wrap_put(w, TEXT_REPLACEMENT);
+            i += k;
+            continue;
+        }
+        i += k;
+        emit_codepoint(w, cp, page);
+    }
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+const text_layout_t *text_layout_get(void)
+{
+    return &s_layout;
+}
+
+esp_err_t text_layout_set(const text_layout_t *layout)
+{
+    if (!layout || layout->columns > TEXT_LAYOUT_MAX_COLUMNS ||
+        (layout->codepage != TEXT_CODEPAGE_CP850 &&
+         layout->codepage != TEXT_CODEPAGE_CP858 &&
+         layout->codepage != TEXT_CODEPAGE_WPC1252)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_layout = *layout;
+    return ESP_OK;
+}
+
+esp_err_t text_layout_select(escpos_t *b, const text_layout_t *layout)
+{
+    const uint8_t cmd[] = { 0x1B, 0x74, (uint8_t)layout->codepage };
+    return escpos_raw(b, cmd, sizeof(cmd));
+}
+
+esp_err_t text_layout_write_raw(escpos_t *b, const char *utf8, size_t length,
+                                const text_layout_t *layout)
+{
+    wrap_t w = { .b = b, .columns = 0 };
+
+    transcode(&w, (const uint8_t *)utf8, length, layout->codepage);
+    wrap_flush(&w);
+    return escpos_error(b);
+}
+
+esp_err_t text_layout_write(escpos_t *b, const char *utf8, const text_layout_t *layout)
+{
+    wrap_t w = {
+        .b = b,
+        .columns = layout->columns > TEXT_LAYOUT_MAX_COLUMNS ? TEXT_LAYOUT_MAX_COLUMNS : layout->columns,
+    };
+
+    transcode(&w, (const uint8_t *)utf8, strlen(utf8), layout->codepage);
+    wrap_flush(&w);
+    return escpos_error(b);
+}
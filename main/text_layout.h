@@ -0,0 +1,81 @@
+/**
+ * @file text_layout.h
+ * @brief UTF-8 to printer code page transcoding and word wrapping
+ *
+ * User messages arrive as UTF-8. This stage converts them to a single-byte
+ * ESC/POS code page with table lookups, substitutes glyphs the code page
+ * lacks (curly quotes, dashes, euro sign, emoji...) and word-wraps to the
+ * paper width, all in one pass and without heap allocations. Control
+ * characters other than newline are dropped, so user text cannot inject
+ * ESC/POS commands.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "escpos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEXT_LAYOUT_MAX_COLUMNS 64  ///< Widest supported line
+
+/**
+ * @brief Printer code pages; values are the ESC t table numbers
+ */
+typedef enum {
+    TEXT_CODEPAGE_CP850 = 2,        ///< Multilingual Latin 1
+    TEXT_CODEPAGE_WPC1252 = 16,     ///< Windows Latin 1
+    TEXT_CODEPAGE_CP858 = 19,       ///< CP850 with the euro sign
+} text_codepage_t;
+
+/**
+ * @brief Layout settings
+ */
+typedef struct {
+    text_codepage_t codepage;
+    uint8_t columns;                ///< Characters per line: 32 (58 mm) or 48 (80 mm), 0 = no wrapping
+} text_layout_t;
+
+/**
+ * @brief Current settings used by the ticket templates
+ */
+const text_layout_t *text_layout_get(void);
+
+/**
+ * @brief Change the settings used by the ticket templates
+ *
+ * Templates that are already compiled keep the previous code page until
+ * they are recompiled.
+ *
+ * @return ESP_ERR_INVALID_ARG for an unknown code page or too many columns
+ */
+esp_err_t text_layout_set(const text_layout_t *layout);
+
+/**
+ * @brief Select the code page on the printer (ESC t n)
+ */
+esp_err_t text_layout_select(escpos_t *b, const text_layout_t *layout);
+
+/**
+ * @brief Transcode UTF-8 text and emit it without wrapping
+ *
+ * Used for the static text of templates.
+ */
+esp_err_t text_layout_write_raw(escpos_t *b, const char *utf8, size_t length,
+                                const text_layout_t *layout);
+
+/**
+ * @brief Transcode UTF-8 text and emit it word-wrapped
+ *
+ * Assumes the text starts at the beginning of a line. Words longer than a
+ * line are split. Existing newlines are kept; the text does not end with an
+ * added newline.
+ */
+esp_err_t text_layout_write(escpos_t *b, const char *utf8, const text_layout_t *layout);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,452 @@
+#include "ticket_template.h"
+#include "nvs_storage.h"
+#include "text_layout.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "TEMPLATE";
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+#define TEMPLATE_BLOB_SIZE        512   // Bytes ESC/POS fijos de una plantilla
+#define TEMPLATE_MAX_SEGMENTS     16    // Tramos fijos + campos
+#define TEMPLATE_TAG_LEN          16
+#define TEMPLATE_NVS_PREFIX       "t_"  // Clave NVS: t_<nombre> (máximo 15 caracteres)
+
+// Tramo de una plantilla compilada: bytes fijos del blob o un campo
+typedef struct {
+    uint16_t offset;
+    uint16_t length;
+    int8_t field;               // -1 = tramo fijo
+} tpl_segment_t;
+
+typedef struct {
+    char name[TICKET_TEMPLATE_NAME_LEN + 1];
+    const char *default_source;
+    const char *fields[TICKET_TEMPLATE_MAX_FIELDS];
+    int field_count;
+    uint8_t blob[TEMPLATE_BLOB_SIZE];
+    tpl_segment_t segs[TEMPLATE_MAX_SEGMENTS];
+    int seg_count;
+} tpl_t;
+
+static tpl_t s_templates[TICKET_TEMPLATE_MAX];
+static int s_template_count = 0;
+static tpl_t s_scratch;                 // Compilación en curso (bajo s_mutex)
+static SemaphoreHandle_t s_mutex = NULL;
+
+// ============================================
+// COMPILACIÓN
+// ============================================
+
+static bool add_segment(tpl_t *t, size_t offset, size_t length, int field)
+{
+    if (field < 0 && length == 0) {
+        return true;
+    }
+    if (t->seg_count == TEMPLATE_MAX_SEGMENTS) {
+        return false;
+    }
+    t->segs[t->seg_count++] = (tpl_segment_t){
+        .offset = offset,
+        .length = length,
+        .field = field,
+    };
+    return true;
+}
+
+static esp_err_t emit_tag(escpos_t *b, const char *tag, const text_layout_t *layout)
+{
+    if (strcmp(tag, "init") == 0) {
+        // ESC @ vuelve a la página de códigos por defecto
+        escpos_init(b);
+        return text_layout_select(b, layout);
+    }
+    if (strcmp(tag, "left") == 0)            return escpos_align(b, ESCPOS_ALIGN_LEFT);
+    if (strcmp(tag, "center") == 0)          return escpos_align(b, ESCPOS_ALIGN_CENTER);
+    if (strcmp(tag, "right") == 0)           return escpos_align(b, ESCPOS_ALIGN_RIGHT);
+    if (strcmp(tag, "bold") == 0)            return escpos_bold(b, true);
+    if (strcmp(tag, "/bold") == 0)           return escpos_bold(b, false);
+    if (strcmp(tag, "underline") == 0)       return escpos_underline(b, 1);
+    if (strcmp(tag, "/underline") == 0)      return escpos_underline(b, 0);
+    if (strcmp(tag, "inverse") == 0)         return escpos_inverse(b, true);
+    if (strcmp(tag, "/inverse") == 0)        return escpos_inverse(b, false);
+    if (strcmp(tag, "big") == 0)             return escpos_size(b, 2, 2);
+    if (strcmp(tag, "tall") == 0)            return escpos_size(b, 1, 2);
+    if (strcmp(tag, "/big") == 0 ||
+        strcmp(tag, "/tall") == 0)           return escpos_size(b, 1, 1);
+    if (strcmp(tag, "cut") == 0)             return escpos_cut(b, true);
+    if (strcmp(tag, "cut:full") == 0)        return escpos_cut(b, false);
+    if (strncmp(tag, "feed:", 5) == 0) {
+        int lines = atoi(tag + 5);
+        if (lines >= 0 && lines <= 255) {
+            return escpos_feed(b, lines);
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+// Compila src a t->blob y t->segs con los campos ya cargados en t
+static esp_err_t compile(tpl_t *t, const char *src)
+{
+    escpos_t b;
+    size_t seg_start = 0;
+    const char *p = src;
+    const text_layout_t *layout = text_layout_get();
+
+    escpos_begin_buffer(&b, t->blob, sizeof(t->blob));
+    t->seg_count = 0;
+
+    // El texto fijo se transcodifica acá, una sola vez
+    text_layout_select(&b, layout);
+
+    while (*p) {
+        if (*p != '{') {
+            const char *next = strchr(p, '{');
+            size_t n = next ? (size_t)(next - p) : strlen(p);
+            text_layout_write_raw(&b, p, n, layout);
+            p += n;
+            continue;
+        }
+        if (p[1] == '{') {
+            escpos_raw(&b, "{", 1);
+            p += 2;
+            continue;
+        }
+
+        const char *end = strchr(p, '}');
+        size_t n = end ? (size_t)(end - p - 1) : 0;
+        if (!end || n == 0 || n >= TEMPLATE_TAG_LEN) {
+            ESP_LOGW(TAG, "⚠️ Etiqueta mal formada en '%s'", t->name);
+            return ESP_ERR_INVALID_ARG;
+        }
+        char tag[TEMPLATE_TAG_LEN];
+        memcpy(tag, p + 1, n);
+        tag[n] = '\0';
+        p = end + 1;
+
+        if (tag[0] != '$') {
+            if (emit_tag(&b, tag, layout) == ESP_ERR_INVALID_ARG) {
+                ESP_LOGW(TAG, "⚠️ Etiqueta desconocida {%s} en '%s'", tag, t->name);
+                return ESP_ERR_INVALID_ARG;
+            }
+            continue;
+        }
+
+        int field = -1;
+        for (int i = 0; i < t->field_count; i++) {
+            if (strcmp(t->fields[i], tag + 1) == 0) {
+                field = i;
+                break;
+            }
+        }
+        if (field < 0) {
+            ESP_LOGW(TAG, "⚠️ Campo desconocido {%s} en '%s'", tag, t->name);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (!add_segment(t, seg_start, escpos_length(&b) - seg_start, -1) ||
+            !add_segment(t, 0, 0, field)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        seg_start = escpos_length(&b);
+    }
+
+    if (!add_segment(t, seg_start, escpos_length(&b) - seg_start, -1)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return escpos_error(&b);
+}
+
+static tpl_t *find_template(const char *name)
+{
+    for (int i = 0; i < s_template_count; i++) {
+        if (strcmp(s_templates[i].name, name) == 0) {
+            return &s_templates[i];
+        }
+    }
+    return NULL;
+}
+
+static void nvs_key(const tpl_t *t, char *key, size_t len)
+{
+    snprintf(key, len, TEMPLATE_NVS_PREFIX "%s", t->name);
+}
+
+// Compila en s_scratch y, si compila, reemplaza la plantilla (bajo s_mutex)
+static esp_err_t compile_into(tpl_t *t, const char *src)
+{
+    s_scratch = *t;
+    esp_err_t ret = compile(&s_scratch, src);
+    if (ret == ESP_OK) {
+        *t = s_scratch;
+    }
+    return ret;
+}
+
+// ============================================
+// API PÚBLICA
+// ============================================
+
+esp_err_t ticket_template_declare(const char *name, const char *default_source,
+                                  const char *const *fields, int field_count)
+{
+    if (!name || strlen(name) == 0 || strlen(name) > TICKET_TEMPLATE_NAME_LEN ||
+        !default_source || field_count < 0 || field_count > TICKET_TEMPLATE_MAX_FIELDS ||
+        (field_count > 0 && !fields)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!s_mutex) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (!s_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (find_template(name)) {
+        xSemaphoreGive(s_mutex);
+        return ESP_OK;
+    }
+    if (s_template_count == TICKET_TEMPLATE_MAX) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    tpl_t *t = &s_templates[s_template_count];
+    memset(t, 0, sizeof(*t));
+    strcpy(t->name, name);
+    t->default_source = default_source;
+    t->field_count = field_count;
+    for (int i = 0; i < field_count; i++) {
+        t->fields[i] = fields[i];
+    }
+
+    char key[16];
+    char src[TICKET_TEMPLATE_MAX_SOURCE + 1];
+    nvs_key(t, key, sizeof(key));
+    nvs_get_str_value(key, src, sizeof(src), "");
+
+    esp_err_t ret = ESP_FAIL;
+    if (src[0]) {
+        ret = compile(t, src);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "⚠️ Plantilla '%s' guardada inválida, se usa la de fábrica", name);
+        }
+    }
+    if (ret != ESP_OK) {
+        ret = compile(t, default_source);
+    }
+    if (ret == ESP_OK) {
+        s_template_count++;
+        ESP_LOGI(TAG, "✅ Plantilla '%s' lista (%d tramos)", name, t->seg_count);
+    } else {
+        ESP_LOGE(TAG, "❌ Plantilla de fábrica '%s' inválida", name);
+        ret = ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t ticket_template_render(const char *name, const char *const *values, escpos_t *b)
+{
+    if (!s_mutex) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    const tpl_t *t = find_template(name);
+    if (!t) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Solo copias: el formato se resolvió al compilar
+    for (int i = 0; i < t->seg_count; i++) {
+        const tpl_segment_t *seg = &t->segs[i];
+        if (seg->field < 0) {
+            escpos_raw(b, t->blob + seg->offset, seg->length);
+        } else if (values && values[seg->field]) {
+            text_layout_write(b, values[seg->field], text_layout_get());
+        }
+    }
+    xSemaphoreGive(s_mutex);
+
+    return escpos_error(b);
+}
+
+esp_err_t ticket_template_set_source(const char *name, const char *source)
+{
+    if (!s_mutex || !name) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (source && strlen(source) > TICKET_TEMPLATE_MAX_SOURCE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    tpl_t *t = find_template(name);
+    if (!t) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    bool reset = !source || !source[0];
+    esp_err_t ret = compile_into(t, reset ? t->default_source : source);
+    if (ret == ESP_OK) {
+        char key[16];
+        nvs_key(t, key, sizeof(key));
+        ret = nvs_set_str_value(key, reset ? "" : source);
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "✏️ Plantilla '%s' %s", name, reset ? "restaurada" : "actualizada");
+    }
+    return ret == ESP_ERR_INVALID_SIZE ? ESP_ERR_INVALID_ARG : ret;
+}
+
+// ============================================
+// ENDPOINT /template
+// ============================================
+
+static esp_err_t template_get_handler(httpd_req_t *req)
+{
+    char query[48];
+    char name[TICKET_TEMPLATE_NAME_LEN + 1];
+
+    httpd_resp_set_type(req, "text/plain; charset=utf-8");
+
+    if (!s_mutex) {
+        return httpd_resp_send_404(req);
+    }
+
+    // Todo se copia bajo s_mutex y se envía sin él, así un cliente lento no
+    // frena la impresión. Los nombres de campo son de la app y no cambian.
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK) {
+        // Sin nombre: listar plantillas y sus campos
+        struct {
+            char name[TICKET_TEMPLATE_NAME_LEN + 1];
+            const char *fields[TICKET_TEMPLATE_MAX_FIELDS];
+            int field_count;
+        } list[TICKET_TEMPLATE_MAX];
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        int count = s_template_count;
+        for (int i = 0; i < count; i++) {
+            strcpy(list[i].name, s_templates[i].name);
+            memcpy(list[i].fields, s_templates[i].fields, sizeof(list[i].fields));
+            list[i].field_count = s_templates[i].field_count;
+        }
+        xSemaphoreGive(s_mutex);
+
+        for (int i = 0; i < count; i++) {
+            httpd_resp_sendstr_chunk(req, list[i].name);
+            for (int f = 0; f < list[i].field_count; f++) {
+                httpd_resp_sendstr_chunk(req, f ? ", $" : ": $");
+                httpd_resp_sendstr_chunk(req, list[i].fields[f]);
+            }
+            httpd_resp_sendstr_chunk(req, "\n");
+        }
+        return httpd_resp_sendstr_chunk(req, NULL);
+    }
+
+    char *src = malloc(TICKET_TEMPLATE_MAX_SOURCE + 1);
+    if (!src) {
+        return httpd_resp_send_500(req);
+    }
+
+    // La fuente en NVS se lee bajo s_mutex: POST la compila y la guarda
+    // dentro de la misma sección
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    const tpl_t *t = find_template(name);
+    const char *default_source = t ? t->default_source : NULL;
+    if (t) {
+        char key[16];
+        nvs_key(t, key, sizeof(key));
+        nvs_get_str_value(key, src, TICKET_TEMPLATE_MAX_SOURCE + 1, "");
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (!default_source) {
+        free(src);
+        return httpd_resp_send_404(req);
+    }
+    esp_err_t ret = httpd_resp_sendstr(req, src[0] ? src : default_source);
+    free(src);
+    return ret;
+}
+
+static esp_err_t template_post_handler(httpd_req_t *req)
+{
+    char query[48];
+    char name[TICKET_TEMPLATE_NAME_LEN + 1];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Falta ?name=");
+    }
+    if (req->content_len > TICKET_TEMPLATE_MAX_SOURCE) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Plantilla demasiado larga");
+    }
+
+    char *src = malloc(TICKET_TEMPLATE_MAX_SOURCE + 1);
+    if (!src) {
+        return httpd_resp_send_500(req);
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int n = httpd_req_recv(req, src + received, req->content_len - received);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (n <= 0) {
+            free(src);
+            return ESP_FAIL;
+        }
+        received += n;
+    }
+    src[received] = '\0';
+
+    esp_err_t ret = ticket_template_set_source(name, src);
+    free(src);
+
+    if (ret == ESP_ERR_NOT_FOUND) {
+        return httpd_resp_send_404(req);
+    }
+    if (ret == ESP_ERR_INVALID_ARG) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Plantilla inválida");
+    }
+    if (ret != ESP_OK) {
+        return httpd_resp_send_500(req);
+    }
+    return httpd_resp_sendstr(req, "OK");
+}
+
+esp_err_t ticket_template_register(httpd_handle_t server)
+{
+    httpd_uri_t get_uri = {
+        .uri = "/template",
+        .method = HTTP_GET,
+        .handler = template_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_uri_t post_uri = {
+        .uri = "/template",
+        .method = HTTP_POST,
+        .handler = template_post_handler,
+        .user_ctx = NULL
+    };
+
+    esp_err_t ret = httpd_register_uri_handler(server, &get_uri);
+    if (ret == ESP_OK) {
+        ret = httpd_register_uri_handler(server, &post_uri);
+    }
+    return ret;
+}
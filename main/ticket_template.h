@@ -0,0 +1,97 @@
+/**
+ * @file ticket_template.h
+ * @brief Precompiled ticket layouts
+ *
+ * An app declares each ticket layout once, as a template source with a fixed
+ * list of variable fields. The source is compiled to ESC/POS bytes up front,
+ * so printing a ticket only copies the static segments and the field values
+ * into a builder.
+ *
+ * Template sources are plain text with tags in braces:
+ * - `{init}` `{left}` `{center}` `{right}`
+ * - `{bold}` `{/bold}` `{underline}` `{/underline}` `{inverse}` `{/inverse}`
+ * - `{big}` `{/big}` (double width and height), `{tall}` (double height)
+ * - `{feed:N}` `{cut}` `{cut:full}`
+ * - `{$field}` inserts a field declared by the app
+ * - `{{` is a literal `{`
+ *
+ * Sources and field values are UTF-8; they are transcoded to the code page
+ * from text_layout_get(), and field values are word-wrapped to its width.
+ *
+ * Sources can be replaced at runtime and are stored in NVS, so tickets can
+ * be restyled without reflashing. `GET /template` lists the templates,
+ * `GET /template?name=X` returns a source and `POST /template?name=X`
+ * replaces it (an empty body restores the app default).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "escpos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TICKET_TEMPLATE_MAX         6     ///< Templates that can be declared
+#define TICKET_TEMPLATE_MAX_FIELDS  4     ///< Fields per template
+#define TICKET_TEMPLATE_NAME_LEN    12    ///< Longest template name
+#define TICKET_TEMPLATE_MAX_SOURCE  512   ///< Longest template source
+
+/**
+ * @brief Declare a template
+ *
+ * Compiles the source stored in NVS under this name, or the default if
+ * there is none or it does not compile. Declaring a name again is a no-op.
+ *
+ * @param name Template name (up to TICKET_TEMPLATE_NAME_LEN characters)
+ * @param default_source Source used when NVS has no valid override
+ * @param fields Names of the fields, in the order render() takes values
+ * @param field_count Number of fields
+ * @return esp_err_t
+ *         - ESP_OK: Template ready
+ *         - ESP_ERR_INVALID_ARG: Invalid name, fields, or default source
+ *         - ESP_ERR_NO_MEM: No free template slots
+ */
+esp_err_t ticket_template_declare(const char *name, const char *default_source,
+                                  const char *const *fields, int field_count);
+
+/**
+ * @brief Render a ticket into a builder
+ *
+ * @param name Template name
+ * @param values Field values, in declaration order
+ * @param b Destination builder (buffer or job mode)
+ * @return esp_err_t
+ *         - ESP_OK: Ticket emitted
+ *         - ESP_ERR_NOT_FOUND: Unknown template
+ *         - Any error from the builder
+ */
+esp_err_t ticket_template_render(const char *name, const char *const *values, escpos_t *b);
+
+/**
+ * @brief Replace the source of a template and store it in NVS
+ *
+ * @param name Template name
+ * @param source New source, or NULL / "" to restore the default
+ * @return esp_err_t
+ *         - ESP_OK: Source compiled and stored
+ *         - ESP_ERR_NOT_FOUND: Unknown template
+ *         - ESP_ERR_INVALID_ARG: Source does not compile (template unchanged)
+ *         - Any NVS error
+ */
+esp_err_t ticket_template_set_source(const char *name, const char *source);
+
+/**
+ * @brief Register `GET /template` and `POST /template`
+ *
+ * @param server Running HTTP server
+ * @return esp_err_t Result of httpd_register_uri_handler()
+ */
+esp_err_t ticket_template_register(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,11 @@
+#!/usr/bin/env python
+# Comprime una página para embeberla en el firmware. Sin nombre ni fecha en
+# la cabecera gzip, así el resultado (y su ETag) solo cambia si cambia la
+# página.
+import gzip
+import sys
+
+with open(sys.argv[1], 'rb') as src:
+    data = src.read()
+with open(sys.argv[2], 'wb') as dst:
+    dst.write(gzip.compress(data, 9, mtime=0))
@@ -0,0 +1,42 @@
+#include "web_assets.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "WEB_ASSETS";
+
+// ============================================
+// CONFIGURACIÓN
+// ============================================
+// Guardar, pero preguntar siempre: "/" cambia con la app activa
+#define WEB_ASSET_CACHE_CONTROL   "no-cache"
+#define WEB_ASSET_INM_MAX         64    // If-None-Match más largo que se compara
+
+esp_err_t web_asset_send(httpd_req_t *req, web_asset_t *asset)
+{
+    size_t len = asset->end - asset->start;
+    char if_none_match[WEB_ASSET_INM_MAX];
+
+    // El ETag sale del contenido, así que solo cambia si cambia la página
+    if (asset->etag[0] == '\0') {
+        snprintf(asset->etag, sizeof(asset->etag), "\"%08lx\"",
+                 esp_rom_crc32_le(0, asset->start, len));
+    }
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", WEB_ASSET_CACHE_CONTROL);
+
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match,
+                                    sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, asset->etag) != NULL) {
+        ESP_LOGD(TAG, "304 %s", req->uri);
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // Todos los navegadores aceptan gzip; no hay copia sin comprimir
+    httpd_resp_set_type(req, asset->type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)asset->start, len);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file web_assets.h
+ * @brief Pre-compressed web pages embedded in the firmware
+ *
+ * The pages live in main/web/ as plain HTML files. The build compresses
+ * each one with gzip and embeds the result (see main/CMakeLists.txt), so
+ * they are sent as stored, with `Content-Encoding: gzip`, without any work
+ * per request.
+ *
+ * Every response carries a strong ETag (CRC32 of the embedded bytes) and
+ * `Cache-Control: no-cache`. Browsers keep the page and revalidate it on
+ * each visit, and the server answers `304 Not Modified` when it has not
+ * changed. Revalidation is always required because "/" serves a different
+ * page depending on the active app, and an OTA update can change them all.
+ *
+ * @code
+ * WEB_ASSET_DECLARE(preguntas_html, "text/html");
+ *
+ * static esp_err_t root_get_handler(httpd_req_t *req)
+ * {
+ *     return web_asset_send(req, &preguntas_html_asset);
+ * }
+ * @endcode
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief An embedded gzip-compressed file
+ *
+ * Declare with WEB_ASSET_DECLARE(); the ETag is filled on first use.
+ */
+typedef struct {
+    const uint8_t *start;
+    const uint8_t *end;
+    const char *type;               ///< MIME type of the uncompressed file
+    char etag[11];                  ///< Quoted CRC32, e.g. "\"1a2b3c4d\""
+} web_asset_t;
+
+/**
+ * @brief Declare `<name>_asset` for the embedded file `<name>.gz`
+ *
+ * @param name File name of the page with '.' replaced by '_' (e.g.
+ *             preguntas_html for web/preguntas.html)
+ * @param mime_type Content-Type to send
+ */
+#define WEB_ASSET_DECLARE(name, mime_type)                                   \
+    extern const uint8_t _binary_##name##_gz_start[];                        \
+    extern const uint8_t _binary_##name##_gz_end[];                          \
+    static web_asset_t name##_asset = {                                      \
+        .start = _binary_##name##_gz_start,                                  \
+        .end = _binary_##name##_gz_end,                                      \
+        .type = (mime_type),                                                 \
+    }
+
+/**
+ * @brief Send an asset, or 304 if the client's copy is current
+ *
+ * @param req HTTP request (GET)
+ * @param asset Asset declared with WEB_ASSET_DECLARE()
+ * @return Result of httpd_resp_send()
+ */
+esp_err_t web_asset_send(httpd_req_t *req, web_asset_t *asset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,9 +1,32 @@
 #include "web_server.h"
 #include "esp_log.h"
 #include "app_interface.h"
+#include "print_spool.h"
+#include "image_upload.h"
+#include "ticket_template.h"
+#include "raw_server.h"
+#include "print_upload.h"
+#include "job_status.h"
+#include "net_profile.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <string.h>
 
 static const char *TAG = "HTTP";
 
+#define WEB_WORKER_STACK          6144  // Decodificar imágenes (TJpgDec + franjas)
+#define WEB_WORKER_PRIORITY       4     // Debajo del servidor HTTP (5)
+#define WEB_WORKER_QUEUE          1     // Pedidos esperando al que está en curso
+
+typedef struct {
+    httpd_req_t *req;                   // Copia asíncrona
+    web_deferred_fn_t fn;
+} web_deferred_t;
+
+static QueueHandle_t s_deferred = NULL;
+
 // Endpoint general /health
 static esp_err_t health_get_handler(httpd_req_t *req)
 {
@@ -11,8 +34,89 @@ static esp_err_t health_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-// Endpoint de prueba
+uint32_t web_client_id(httpd_req_t *req)
+{
+    return web_sockfd_client_id(httpd_req_to_sockfd(req));
+}
+
+uint32_t web_sockfd_client_id(int sockfd)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+
+    if (sockfd < 0 || getpeername(sockfd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        return 0;
+    }
+
+    const uint8_t *ip;
+    size_t ip_len;
+    if (addr.ss_family == AF_INET6) {
+        ip = (const uint8_t *)&((struct sockaddr_in6 *)&addr)->sin6_addr;
+        ip_len = 16;
+    } else {
+        ip = (const uint8_t *)&((struct sockaddr_in *)&addr)->sin_addr;
+        ip_len = 4;
+    }
+
+    // FNV-1a sobre la dirección
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < ip_len; i++) {
+        hash = (hash ^ ip[i]) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+static void web_worker_task(void *arg)
+{
+    web_deferred_t item;
+
+    while (1) {
+        if (xQueueReceive(s_deferred, &item, portMAX_DELAY) == pdTRUE) {
+            item.fn(item.req);
+            httpd_req_async_handler_complete(item.req);
+        }
+    }
+}
+
+esp_err_t web_defer(httpd_req_t *req, web_deferred_fn_t fn)
+{
+    // Solo los handlers encolan, todos desde la tarea del servidor: el
+    // lugar libre no cambia en el medio
+    if (!s_deferred || uxQueueSpacesAvailable(s_deferred) == 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    web_deferred_t item = { .fn = fn };
+    if (httpd_req_async_handler_begin(req, &item.req) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    xQueueSend(s_deferred, &item, 0);
+    return ESP_OK;
+}
+
+// Endpoint de prueba. Con ?print=1 imprime un ticket por el carril del
+// operador, que se adelanta a los trabajos de los asistentes.
 static esp_err_t test_get_handler(httpd_req_t *req) {
+    char query[32];
+    char value[4];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "print", value, sizeof(value)) == ESP_OK &&
+        strcmp(value, "1") == 0) {
+        static const uint8_t ticket[] = {
+            0x1B, 0x40,                                 // ESC @
+            0x1B, 0x61, 0x01,                           // Centrado
+            'P', 'R', 'U', 'E', 'B', 'A', '\n',
+            0x1B, 0x61, 0x00,
+            '\n', '\n', '\n',
+            0x1D, 0x56, 0x00,                           // Corte
+        };
+        esp_err_t ret = print_spool_submit(ticket, sizeof(ticket), PRINTER_PRIO_OPERATOR,
+                                           web_client_id(req), NULL);
+        httpd_resp_sendstr(req, ret == ESP_OK ? "Ticket de prueba encolado" : esp_err_to_name(ret));
+        return ESP_OK;
+    }
+
     httpd_resp_sendstr(req, "Servidor web funcionando!");
     return ESP_OK;
 }
@@ -22,8 +126,31 @@ httpd_handle_t start_webserver(void)
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     httpd_handle_t server = NULL;
 
+    // Endpoints generales + los de la app, y margen de stack para los
+    // tickets que se arman en el handler (las imágenes van en web_worker)
+    config.max_uri_handlers = 20;
+    config.stack_size = 6144;
+    // Sesiones, backlog, keep-alive y timeouts según el perfil de capacidad.
+    // Los WebSocket de estado quedan abiertos: con las sesiones llenas se
+    // cierra la menos usada (el navegador reconecta) en vez de rechazar
+    net_profile_apply_httpd(&config);
+    // Para /job/<id>; las rutas sin comodines se comparan igual que antes
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
     ESP_LOGI(TAG, "🔄 Iniciando servidor web...");
 
+    if (!s_deferred) {
+        s_deferred = xQueueCreate(WEB_WORKER_QUEUE, sizeof(web_deferred_t));
+        if (s_deferred && xTaskCreate(web_worker_task, "web_worker", WEB_WORKER_STACK, NULL,
+                                      WEB_WORKER_PRIORITY, NULL) != pdPASS) {
+            vQueueDelete(s_deferred);
+            s_deferred = NULL;
+        }
+        if (!s_deferred) {
+            ESP_LOGE(TAG, "❌ No se pudo crear web_worker: subidas deshabilitadas");
+        }
+    }
+
     if(httpd_start(&server, &config) == ESP_OK) {
         // Registrar endpoint general
         httpd_uri_t health = {
@@ -47,6 +174,26 @@ httpd_handle_t start_webserver(void)
         httpd_register_uri_handler(server, &test_uri);
         ESP_LOGI(TAG, "✅ Endpoint /test registrado");
 
+        if (image_upload_register(server) == ESP_OK) {
+            ESP_LOGI(TAG, "✅ Endpoint /print_image registrado");
+        }
+
+        if (print_upload_register(server) == ESP_OK) {
+            ESP_LOGI(TAG, "✅ Endpoint /print registrado");
+        }
+
+        if (raw_server_register(server) == ESP_OK) {
+            ESP_LOGI(TAG, "✅ Endpoint /raw_status registrado");
+        }
+
+        if (job_status_register(server) == ESP_OK) {
+            ESP_LOGI(TAG, "✅ Endpoint /job/<id> registrado");
+        }
+
+        if (net_profile_register(server) == ESP_OK) {
+            ESP_LOGI(TAG, "✅ Endpoint /net_profile registrado");
+        }
+
         // Delegar registro de endpoints específicos de la app
         const app_interface_t *app = get_active_app();
 
@@ -59,6 +206,11 @@ httpd_handle_t start_webserver(void)
             ESP_LOGI(TAG, "✅ App encontrada, registrando handlers...");
             app->app_register_http_handlers(server);
             ESP_LOGI(TAG, "✅ Handlers de app registrados correctamente");
+
+            // Las apps declaran sus plantillas al registrar sus handlers
+            if (ticket_template_register(server) == ESP_OK) {
+                ESP_LOGI(TAG, "✅ Endpoint /template registrado");
+            }
         }
 
         ESP_LOGI(TAG, "🚀 Servidor HTTP iniciado con endpoints de la app");
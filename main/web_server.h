@@ -2,3 +2,18 @@
 #include "esp_http_server.h"
 
 httpd_handle_t start_webserver(void);
+
+// Clave del cliente que hizo el pedido (hash de la IP remota, sin puerto),
+// usada para repartir la impresora en forma equitativa. 0 si no se conoce.
+uint32_t web_client_id(httpd_req_t *req);
+
+// Igual que web_client_id() para un socket aceptado fuera del servidor HTTP
+uint32_t web_sockfd_client_id(int sockfd);
+
+// Trabajo largo de un handler (subidas que esperan a la impresora): corre en
+// la tarea "web_worker" sobre una copia asíncrona del pedido, así la tarea del
+// servidor sigue atendiendo a los demás. fn responde el pedido; al volver se
+// completa. Uno en curso y uno esperando: si no hay lugar devuelve
+// ESP_ERR_TIMEOUT sin tocar req y el handler responde 503.
+typedef esp_err_t (*web_deferred_fn_t)(httpd_req_t *req);
+esp_err_t web_defer(httpd_req_t *req, web_deferred_fn_t fn);
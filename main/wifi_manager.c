@@ -1,4 +1,5 @@
 #include "wifi_manager.h"
+#include "net_profile.h"
 #include "esp_log.h"
 #include "esp_event.h"
 #include "esp_netif.h"
@@ -10,7 +11,6 @@ static const char *TAG = "WiFiAP";
 
 #define WIFI_AP_SSID      "AllToPrint-%02X%02X"
 #define WIFI_AP_PASS      "12345678"  // Min 8 chars para WPA2
-#define WIFI_MAX_CONN     4
 
 static esp_netif_t *ap_netif = NULL;
 
@@ -61,7 +61,7 @@ void wifi_manager_init_ap(void)
     strcpy((char *)wifi_config.ap.password, WIFI_AP_PASS);
     wifi_config.ap.ssid_len = strlen((char *)wifi_config.ap.ssid);
     wifi_config.ap.channel = 1;
-    wifi_config.ap.max_connection = WIFI_MAX_CONN;
+    wifi_config.ap.max_connection = net_profile_get()->ap_max_clients;
     wifi_config.ap.authmode = WIFI_AUTH_WPA_WPA2_PSK;
 
     // Si querés AP abierto, descomentar esto:
@@ -77,4 +77,5 @@ void wifi_manager_init_ap(void)
     ESP_LOGI(TAG, "  SSID: %s", wifi_config.ap.ssid);
     ESP_LOGI(TAG, "  PASS: %s", wifi_config.ap.password);
     ESP_LOGI(TAG, "  Canal: %d", wifi_config.ap.channel);
+    ESP_LOGI(TAG, "  Clientes: %d", wifi_config.ap.max_connection);
 }
\ No newline at end of file
@@ -0,0 +1,804 @@
+// Pruebas en host de main/form_parser.c
+//
+// - Casos conocidos de url-encoded y multipart, y errores de Content-Type.
+// - El mismo cuerpo partido en cualquier punto y en tramos de cualquier
+//   tamaño tiene que dar los mismos campos y el mismo error que entero.
+// - Fuzz reproducible: formularios generados (con resultado esperado),
+//   mutados y al azar; con -DHOST_TEST_SANITIZE=ON corre bajo ASan/UBSan.
+// - form_parse_request() con un socket falso que entrega tramos sueltos y
+//   timeouts.
+// - Con --bench: MB/s con tramos de 256 bytes, como en el equipo.
+//
+// Uso: form_parser_test [--bench] [--seed N] [--iterations N]
+
+#include "form_parser.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <strings.h>
+
+// ============================================
+// REGISTRO DE CAMPOS
+// ============================================
+
+#define REC_MAX  (64 * 1024)
+
+// Los campos quedan como "nombre=valor;" uno detrás de otro. Los tramos se
+// concatenan, así que la forma de partir el cuerpo no cambia el registro.
+typedef struct {
+    uint8_t out[REC_MAX];
+    size_t len;
+    bool open;                  // Hay un campo con datos y sin cerrar
+    char cur[FORM_NAME_MAX + 1];
+    int violations;             // Llamadas que no respetan el contrato
+    int calls;
+    int fail_at;                // Devolver error en esta llamada (0 = nunca)
+    int calls_after_error;
+} rec_t;
+
+static void rec_append(rec_t *r, const void *data, size_t length)
+{
+    if (r->len + length > REC_MAX) {
+        length = REC_MAX - r->len;
+    }
+    memcpy(r->out + r->len, data, length);
+    r->len += length;
+}
+
+static esp_err_t rec_cb(void *ctx, const char *name,
+                        const uint8_t *data, size_t length, bool done)
+{
+    rec_t *r = ctx;
+
+    if (r->fail_at > 0 && r->calls >= r->fail_at) {
+        r->calls_after_error++;
+    }
+    r->calls++;
+
+    if (!name || strnlen(name, FORM_NAME_MAX + 1) > FORM_NAME_MAX) {
+        r->violations++;
+        return ESP_OK;
+    }
+    if (done ? (data != NULL || length != 0) : (data == NULL || length == 0)) {
+        r->violations++;
+    }
+    // Los tramos de un campo llegan seguidos y con el mismo nombre
+    if (r->open && strcmp(name, r->cur) != 0) {
+        r->violations++;
+    }
+
+    if (!r->open) {
+        rec_append(r, name, strlen(name));
+        rec_append(r, "=", 1);
+    }
+    if (done) {
+        rec_append(r, ";", 1);
+        r->open = false;
+    } else {
+        rec_append(r, data, length);
+        r->open = true;
+        strcpy(r->cur, name);
+    }
+
+    if (r->fail_at > 0 && r->calls == r->fail_at) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// ============================================
+// ALIMENTACIÓN
+// ============================================
+
+typedef enum {
+    FEED_WHOLE,         // Todo de una vez
+    FEED_SPLIT,         // Dos tramos, cortando en arg
+    FEED_STEP,          // Tramos de arg bytes
+    FEED_RANDOM,        // Tramos de 1..arg bytes al azar
+} feed_mode_t;
+
+typedef struct {
+    esp_err_t init;
+    esp_err_t feed;     // Primer error de form_parser_feed()
+    esp_err_t finish;
+} result_t;
+
+static result_t parse(const char *content_type, const uint8_t *body, size_t length,
+                      feed_mode_t mode, size_t arg, rec_t *rec)
+{
+    form_parser_t p;
+    result_t res = { 0 };
+
+    memset(rec, 0, sizeof(*rec));
+    res.init = form_parser_init(&p, content_type, rec_cb, rec);
+    if (res.init != ESP_OK) {
+        return res;
+    }
+
+    size_t pos = 0;
+    while (pos < length) {
+        size_t n = length - pos;
+        switch (mode) {
+        case FEED_WHOLE:
+            break;
+        case FEED_SPLIT:
+            if (pos < arg) {
+                n = arg - pos;
+            }
+            break;
+        case FEED_STEP:
+            n = n < arg ? n : arg;
+            break;
+        case FEED_RANDOM: {
+            size_t r = 1 + rng_below(arg);
+            n = n < r ? n : r;
+            break;
+        }
+        }
+        esp_err_t ret = form_parser_feed(&p, body + pos, n);
+        if (ret != ESP_OK && res.feed == ESP_OK) {
+            res.feed = ret;
+        }
+        pos += n;
+    }
+    res.finish = form_parser_finish(&p);
+    return res;
+}
+
+static bool same_result(const result_t *a, const rec_t *ra, const result_t *b, const rec_t *rb)
+{
+    return a->init == b->init && a->feed == b->feed && a->finish == b->finish &&
+           ra->len == rb->len && memcmp(ra->out, rb->out, ra->len) == 0;
+}
+
+static rec_t s_whole, s_piece;
+
+// El cuerpo entero y partido de todas las formas tiene que dar lo mismo
+static void check_split_invariance(const char *what, const char *content_type,
+                                   const uint8_t *body, size_t length, bool every_split)
+{
+    result_t whole = parse(content_type, body, length, FEED_WHOLE, 0, &s_whole);
+    result_t r;
+
+    CHECK(s_whole.violations == 0, "%s: %d llamadas fuera de contrato", what, s_whole.violations);
+    if (whole.init != ESP_OK) {
+        return;
+    }
+
+    // Basta con el primer tramo que no coincida
+    if (every_split) {
+        for (size_t k = 1; k < length; k++) {
+            r = parse(content_type, body, length, FEED_SPLIT, k, &s_piece);
+            if (!same_result(&whole, &s_whole, &r, &s_piece) || s_piece.violations != 0) {
+                CHECK(false, "%s: distinto partiendo en %zu", what, k);
+                return;
+            }
+        }
+    }
+    for (size_t step = 1; step <= 9; step++) {
+        r = parse(content_type, body, length, FEED_STEP, step, &s_piece);
+        if (!same_result(&whole, &s_whole, &r, &s_piece) || s_piece.violations != 0) {
+            CHECK(false, "%s: distinto en tramos de %zu", what, step);
+            return;
+        }
+    }
+    r = parse(content_type, body, length, FEED_STEP, 256, &s_piece);
+    CHECK(same_result(&whole, &s_whole, &r, &s_piece), "%s: distinto en tramos de 256", what);
+    r = parse(content_type, body, length, FEED_RANDOM, 80, &s_piece);
+    CHECK(same_result(&whole, &s_whole, &r, &s_piece) && s_piece.violations == 0,
+          "%s: distinto en tramos al azar", what);
+}
+
+// ============================================
+// CASOS CONOCIDOS
+// ============================================
+
+#define UE  "application/x-www-form-urlencoded"
+#define MP  "multipart/form-data; boundary=XyZ"
+
+typedef struct {
+    const char *content_type;
+    const char *body;
+    esp_err_t init;
+    esp_err_t finish;
+    const char *expected;       // NULL: no se mira el registro
+} known_t;
+
+static const known_t s_known[] = {
+    // url-encoded
+    { UE, "", ESP_OK, ESP_OK, "" },
+    { UE, "msg=hola+mundo&n=2", ESP_OK, ESP_OK, "msg=hola mundo;n=2;" },
+    { UE, "a+b%20c=1", ESP_OK, ESP_OK, "a b c=1;" },
+    // Escapes inválidos o cortados quedan literales
+    { UE, "msg=%C3%A1%zz%4&x&%6dsg=2%", ESP_OK, ESP_OK, "msg=\xC3\xA1%zz%4;x=;msg=2%;" },
+    { UE, "a=%4", ESP_OK, ESP_OK, "a=%4;" },
+    { UE, "a=&&=b", ESP_OK, ESP_OK, "a=;=b;" },
+    { UE, "solo", ESP_OK, ESP_OK, "solo=;" },
+    // Valor más largo que el buffer de decodificación
+    { UE, "v=0123456789012345678901234567890123456789", ESP_OK, ESP_OK,
+      "v=0123456789012345678901234567890123456789;" },
+    // Nombre truncado a FORM_NAME_MAX
+    { UE, "nnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnn=1", ESP_OK, ESP_OK,
+      "nnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnn=1;" },
+
+    // multipart: casi-delimitadores dentro de los datos
+    { MP, "--XyZ\r\nContent-Disposition: form-data; name=\"msg\"\r\n\r\n"
+          "hola\r\n--Xy\r mundo\r\n"
+          "--XyZ\r\ncontent-disposition: form-data; filename=\"a\"; name=\"f\"\r\n"
+          "Content-Type: x\r\n\r\n\r\n\r\r\n--XyZ--\r\n",
+      ESP_OK, ESP_OK, "msg=hola\r\n--Xy\r mundo;f=\r\n\r;" },
+    { "multipart/form-data; boundary=\"XyZ\"",
+      "--XyZ\r\nContent-Disposition: form-data; name=a\r\n\r\n1\r\n--XyZ--",
+      ESP_OK, ESP_OK, "a=1;" },
+    { "Multipart/Form-Data; BOUNDARY=XyZ; charset=utf-8",
+      "--XyZ\r\nContent-Disposition: form-data; name=a\r\n\r\n1\r\n--XyZ--",
+      ESP_OK, ESP_OK, "a=1;" },
+    // Preámbulo, relleno tras el delimitador y epílogo
+    { MP, "basura --XyZ\r\n--XyZ  \r\nContent-Disposition: form-data; name=a\r\n\r\n"
+          "1\r\n--XyZ--\r\nepilogo\r\n--XyZ\r\n",
+      ESP_OK, ESP_OK, "a=1;" },
+    // Parte sin nombre y parte vacía
+    { MP, "--XyZ\r\n\r\ndatos\r\n--XyZ\r\nContent-Disposition: form-data; name=v\r\n\r\n"
+          "\r\n--XyZ--",
+      ESP_OK, ESP_OK, "=datos;v=;" },
+    { MP, "--XyZ--", ESP_OK, ESP_OK, "" },
+    // Sin delimitador final
+    { MP, "--XyZ\r\nContent-Disposition: form-data; name=a\r\n\r\n1\r\n--XyZ",
+      ESP_OK, ESP_ERR_INVALID_RESPONSE, NULL },
+    { MP, "", ESP_OK, ESP_ERR_INVALID_RESPONSE, NULL },
+    // Basura tras el delimitador o en las cabeceras
+    { MP, "--XyZx\r\n\r\n1\r\n--XyZ--", ESP_OK, ESP_ERR_INVALID_RESPONSE, NULL },
+    { MP, "--XyZ-x", ESP_OK, ESP_ERR_INVALID_RESPONSE, NULL },
+    { MP, "--XyZ\rx", ESP_OK, ESP_ERR_INVALID_RESPONSE, NULL },
+    { MP, "--XyZ\r\nA: b\rx", ESP_OK, ESP_ERR_INVALID_RESPONSE, NULL },
+
+    // Content-Type
+    { "text/plain", "", ESP_ERR_NOT_SUPPORTED, ESP_OK, NULL },
+    { "multipart/form-data", "", ESP_ERR_INVALID_ARG, ESP_OK, NULL },
+    { "multipart/form-data; boundary=", "", ESP_ERR_INVALID_ARG, ESP_OK, NULL },
+    { "multipart/form-data; boundary=\"\"", "", ESP_ERR_INVALID_ARG, ESP_OK, NULL },
+    { "multipart/form-data; boundary="
+      "0123456789012345678901234567890123456789012345678901234567890123456789",
+      "--0123456789012345678901234567890123456789012345678901234567890123456789--",
+      ESP_OK, ESP_OK, "" },
+    { "multipart/form-data; boundary="
+      "0123456789012345678901234567890123456789012345678901234567890123456789x",
+      "", ESP_ERR_INVALID_ARG, ESP_OK, NULL },
+};
+
+static void test_known(void)
+{
+    rec_t *rec = &s_whole;
+
+    for (size_t i = 0; i < sizeof(s_known) / sizeof(s_known[0]); i++) {
+        const known_t *k = &s_known[i];
+        size_t length = strlen(k->body);
+        result_t r = parse(k->content_type, (const uint8_t *)k->body, length, FEED_WHOLE, 0, rec);
+        esp_err_t final = r.feed != ESP_OK ? r.feed : r.finish;
+
+        CHECK(r.init == k->init, "caso %zu: init %s", i, esp_err_to_name(r.init));
+        if (r.init != ESP_OK) {
+            continue;
+        }
+        CHECK(final == k->finish, "caso %zu: %s", i, esp_err_to_name(final));
+        CHECK(r.finish == final, "caso %zu: el error no se mantiene en finish", i);
+        if (k->expected) {
+            CHECK(rec->len == strlen(k->expected) && memcmp(rec->out, k->expected, rec->len) == 0,
+                  "caso %zu: '%.*s'", i, (int)rec->len, rec->out);
+        }
+
+        char what[32];
+        snprintf(what, sizeof(what), "caso %zu", i);
+        check_split_invariance(what, k->content_type, (const uint8_t *)k->body, length, true);
+    }
+}
+
+// El error de la callback corta el parser y se devuelve siempre
+static void test_callback_error(void)
+{
+    static const char body[] = "a=1&b=2&c=3";
+    rec_t *rec = &s_whole;
+
+    for (int fail_at = 1; fail_at <= 5; fail_at++) {
+        form_parser_t p;
+
+        memset(rec, 0, sizeof(*rec));
+        rec->fail_at = fail_at;
+        form_parser_init(&p, UE, rec_cb, rec);
+        esp_err_t ret = ESP_OK;
+        for (size_t i = 0; i < sizeof(body) - 1; i++) {
+            esp_err_t r = form_parser_feed(&p, (const uint8_t *)body + i, 1);
+            if (ret == ESP_OK) {
+                ret = r;
+            }
+        }
+        esp_err_t fin = form_parser_finish(&p);
+        CHECK(fin == ESP_ERR_NO_MEM, "error en llamada %d: finish %s", fail_at, esp_err_to_name(fin));
+        CHECK(rec->calls_after_error == 0, "error en llamada %d: %d llamadas de más",
+              fail_at, rec->calls_after_error);
+    }
+}
+
+static void test_text_cb(void)
+{
+    static const char body[] =
+        "--XyZ\r\nContent-Disposition: form-data; name=\"msg\"\r\n\r\nprimero largo\r\n"
+        "--XyZ\r\nContent-Disposition: form-data; name=\"msg\"\r\n\r\nsegundo\r\n--XyZ--";
+    char buf[8];
+    form_text_t t = FORM_TEXT_INIT("msg", buf, sizeof(buf));
+    form_text_t none = FORM_TEXT_INIT("otro", buf, sizeof(buf));
+    form_parser_t p;
+
+    form_parser_init(&p, MP, form_text_cb, &t);
+    for (size_t i = 0; i < sizeof(body) - 1; i++) {
+        form_parser_feed(&p, (const uint8_t *)body + i, 1);
+    }
+    CHECK(form_parser_finish(&p) == ESP_OK, "form_text_cb: finish");
+    CHECK(t.found && strcmp(buf, "primero") == 0 && t.len == 7,
+          "form_text_cb: '%s' (%zu)", buf, t.len);
+
+    form_parser_init(&p, MP, form_text_cb, &none);
+    form_parser_feed(&p, (const uint8_t *)body, sizeof(body) - 1);
+    form_parser_finish(&p);
+    CHECK(!none.found, "form_text_cb: campo ausente encontrado");
+}
+
+// ============================================
+// GENERADOR DE FORMULARIOS
+// ============================================
+
+#define GEN_FIELDS_MAX   6
+#define GEN_VALUE_MAX    300
+#define GEN_BODY_MAX     8192
+
+typedef struct {
+    char content_type[128];
+    uint8_t body[GEN_BODY_MAX];
+    size_t length;
+    uint8_t expected[GEN_BODY_MAX];
+    size_t expected_len;
+} gen_t;
+
+static void put(uint8_t *buf, size_t *len, const void *data, size_t n)
+{
+    memcpy(buf + *len, data, n);
+    *len += n;
+}
+
+static void gen_name(char *name, size_t *len)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+
+    *len = 1 + rng_below(40);
+    for (size_t i = 0; i < *len; i++) {
+        name[i] = chars[rng_below(sizeof(chars) - 1)];
+    }
+    name[*len] = '\0';
+}
+
+// Valores con muchos bytes que confunden: CR, LF, '-', parte del boundary
+static size_t gen_value(uint8_t *value, const char *boundary)
+{
+    size_t len = rng_below(GEN_VALUE_MAX);
+    size_t blen = boundary ? strlen(boundary) : 0;
+
+    for (size_t i = 0; i < len; i++) {
+        uint32_t k = rng_below(10);
+        if (k < 3) {
+            value[i] = "\r\n-"[k];
+        } else if (k < 5 && blen > 0) {
+            value[i] = boundary[rng_below(blen)];
+        } else if (k < 6) {
+            value[i] = "%+&= "[rng_below(5)];
+        } else {
+            value[i] = (uint8_t)rng_next();
+        }
+    }
+    return len;
+}
+
+static bool contains(const uint8_t *data, size_t len, const uint8_t *needle, size_t nlen)
+{
+    for (size_t i = 0; i + nlen <= len; i++) {
+        if (memcmp(data + i, needle, nlen) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void gen_multipart(gen_t *g)
+{
+    static const char bchars[] = "0123456789abcdefABCDEF'()+_,-./:=?";
+    char boundary[FORM_BOUNDARY_MAX + 1];
+    char delim[FORM_BOUNDARY_MAX + 5];
+    size_t blen = 1 + rng_below(FORM_BOUNDARY_MAX);
+
+    for (size_t i = 0; i < blen; i++) {
+        boundary[i] = bchars[rng_below(sizeof(bchars) - 1)];
+    }
+    boundary[blen] = '\0';
+    snprintf(delim, sizeof(delim), "\r\n--%s", boundary);
+    snprintf(g->content_type, sizeof(g->content_type),
+             rng_below(2) ? "multipart/form-data; boundary=\"%s\"" : "multipart/form-data; boundary=%s",
+             boundary);
+
+    g->length = 0;
+    g->expected_len = 0;
+    if (rng_below(3) == 0) {
+        put(g->body, &g->length, "preambulo\r\n", 11);
+    }
+    put(g->body, &g->length, delim + 2, strlen(delim) - 2);
+
+    uint32_t fields = rng_below(GEN_FIELDS_MAX + 1);
+    for (uint32_t f = 0; f < fields; f++) {
+        char name[48];
+        size_t nlen;
+        uint8_t value[GEN_VALUE_MAX];
+        size_t vlen;
+
+        gen_name(name, &nlen);
+        do {
+            vlen = gen_value(value, boundary);
+        } while (contains(value, vlen, (const uint8_t *)delim, strlen(delim)));
+
+        char header[192];
+        int hlen = snprintf(header, sizeof(header),
+                            "\r\nContent-Disposition: form-data; name=\"%s\"%s\r\n%s\r\n",
+                            name, rng_below(2) ? "; filename=\"x.bin\"" : "",
+                            rng_below(2) ? "Content-Type: application/octet-stream\r\n" : "");
+        put(g->body, &g->length, header, hlen);
+        put(g->body, &g->length, value, vlen);
+        put(g->body, &g->length, delim, strlen(delim));
+
+        put(g->expected, &g->expected_len, name, nlen < FORM_NAME_MAX ? nlen : FORM_NAME_MAX);
+        put(g->expected, &g->expected_len, "=", 1);
+        put(g->expected, &g->expected_len, value, vlen);
+        put(g->expected, &g->expected_len, ";", 1);
+    }
+    put(g->body, &g->length, "--\r\n", 4);
+}
+
+static void gen_urlencoded(gen_t *g)
+{
+    static const char hex_lower[] = "0123456789abcdef";
+    static const char hex_upper[] = "0123456789ABCDEF";
+
+    strcpy(g->content_type, rng_below(2) ? UE : UE "; charset=UTF-8");
+    g->length = 0;
+    g->expected_len = 0;
+
+    uint32_t fields = 1 + rng_below(GEN_FIELDS_MAX);
+    for (uint32_t f = 0; f < fields; f++) {
+        char name[48];
+        size_t nlen;
+        uint8_t value[GEN_VALUE_MAX];
+        size_t vlen = gen_value(value, NULL);
+
+        gen_name(name, &nlen);
+        if (f > 0) {
+            put(g->body, &g->length, "&", 1);
+        }
+        put(g->body, &g->length, name, nlen);
+        put(g->body, &g->length, "=", 1);
+        for (size_t i = 0; i < vlen; i++) {
+            uint8_t c = value[i];
+            if (c == ' ') {
+                put(g->body, &g->length, "+", 1);
+            } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                       (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.') {
+                put(g->body, &g->length, &c, 1);
+            } else {
+                const char *hex = rng_below(2) ? hex_lower : hex_upper;
+                char esc[3] = { '%', hex[c >> 4], hex[c & 15] };
+                put(g->body, &g->length, esc, 3);
+            }
+        }
+
+        put(g->expected, &g->expected_len, name, nlen < FORM_NAME_MAX ? nlen : FORM_NAME_MAX);
+        put(g->expected, &g->expected_len, "=", 1);
+        put(g->expected, &g->expected_len, value, vlen);
+        put(g->expected, &g->expected_len, ";", 1);
+    }
+}
+
+// Hasta 4 cambios al azar: byte cambiado, insertado, borrado o cuerpo cortado
+static void mutate(gen_t *g)
+{
+    static const char nasty[] = "\r\n-%=&+\"";
+    uint32_t count = 1 + rng_below(4);
+
+    for (uint32_t m = 0; m < count && g->length > 0; m++) {
+        size_t at = rng_below(g->length);
+        uint8_t c = rng_below(2) ? (uint8_t)nasty[rng_below(sizeof(nasty) - 1)] : (uint8_t)rng_next();
+
+        switch (rng_below(4)) {
+        case 0:
+            g->body[at] = c;
+            break;
+        case 1:
+            if (g->length < GEN_BODY_MAX) {
+                memmove(g->body + at + 1, g->body + at, g->length - at);
+                g->body[at] = c;
+                g->length++;
+            }
+            break;
+        case 2:
+            memmove(g->body + at, g->body + at + 1, g->length - at - 1);
+            g->length--;
+            break;
+        default:
+            g->length = at;
+            break;
+        }
+    }
+}
+
+static gen_t s_gen;
+
+static void test_fuzz(uint32_t seed, uint32_t iterations)
+{
+    static const char *const types[] = {
+        UE, MP, "multipart/form-data; boundary=\"-\"", "multipart/form-data; boundary=a b",
+        "multipart/form-data; boundary=", "text/plain",
+    };
+    gen_t *g = &s_gen;
+
+    rng_seed(seed);
+    for (uint32_t it = 0; it < iterations; it++) {
+        char what[48];
+        snprintf(what, sizeof(what), "fuzz %u", it);
+
+        // Formulario válido: resultado conocido
+        if (it % 2) {
+            gen_multipart(g);
+        } else {
+            gen_urlencoded(g);
+        }
+        result_t r = parse(g->content_type, g->body, g->length, FEED_RANDOM, 64, &s_piece);
+        CHECK(r.init == ESP_OK && r.feed == ESP_OK && r.finish == ESP_OK,
+              "%s: %s / %s", what, esp_err_to_name(r.feed), esp_err_to_name(r.finish));
+        CHECK(s_piece.len == g->expected_len && memcmp(s_piece.out, g->expected, g->expected_len) == 0,
+              "%s: campos distintos de los generados", what);
+        CHECK(s_piece.violations == 0, "%s: llamadas fuera de contrato", what);
+
+        // El mismo, mutado: solo se sabe que partirlo no cambia nada
+        mutate(g);
+        check_split_invariance(what, g->content_type, g->body, g->length, it % 16 == 0);
+
+        // Bytes al azar con un Content-Type cualquiera
+        g->length = rng_below(512);
+        for (size_t i = 0; i < g->length; i++) {
+            g->body[i] = rng_below(2) ? (uint8_t)"\r\n-XyZ%=&"[rng_below(9)] : (uint8_t)rng_next();
+        }
+        check_split_invariance(what, types[rng_below(sizeof(types) / sizeof(types[0]))],
+                               g->body, g->length, false);
+
+        if (s_failures > 20) {
+            printf("demasiados fallos, semilla %u\n", seed);
+            return;
+        }
+    }
+}
+
+// ============================================
+// form_parse_request() CON UN SOCKET FALSO
+// ============================================
+
+typedef struct {
+    const char *content_type;       // NULL: sin cabecera
+    const uint8_t *body;
+    size_t length;
+    size_t pos;
+    size_t close_at;                // La conexión se cae aquí (0 = nunca)
+    uint32_t timeouts;              // Timeouts seguidos antes de cada tramo
+    uint32_t pending_timeouts;
+} fake_req_t;
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    fake_req_t *f = r->user_ctx;
+    return strcasecmp(field, "Content-Type") == 0 && f->content_type ? strlen(f->content_type) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    fake_req_t *f = r->user_ctx;
+    if (strcasecmp(field, "Content-Type") != 0 || !f->content_type) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (strlen(f->content_type) >= val_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    strcpy(val, f->content_type);
+    return ESP_OK;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    fake_req_t *f = r->user_ctx;
+
+    if (f->pending_timeouts > 0) {
+        f->pending_timeouts--;
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    f->pending_timeouts = f->timeouts;
+    if (f->close_at > 0 && f->pos >= f->close_at) {
+        return 0;
+    }
+
+    size_t end = f->close_at > 0 ? f->close_at : f->length;
+    size_t n = 1 + rng_below(buf_len);
+    if (n > end - f->pos) {
+        n = end - f->pos;
+    }
+    memcpy(buf, f->body + f->pos, n);
+    f->pos += n;
+    return (int)n;
+}
+
+static esp_err_t request(fake_req_t *f, rec_t *rec)
+{
+    httpd_req_t req = { .content_len = f->length, .user_ctx = f };
+
+    memset(rec, 0, sizeof(*rec));
+    f->pos = 0;
+    f->pending_timeouts = f->timeouts;
+    return form_parse_request(&req, rec_cb, rec);
+}
+
+static void test_request(void)
+{
+    gen_t *g = &s_gen;
+    fake_req_t f = { 0 };
+    esp_err_t ret;
+
+    rng_seed(7);
+    for (int i = 0; i < 200; i++) {
+        if (i % 2) {
+            gen_multipart(g);
+        } else {
+            gen_urlencoded(g);
+        }
+        f = (fake_req_t) {
+            .content_type = g->content_type, .body = g->body, .length = g->length,
+            .timeouts = rng_below(4),
+        };
+        ret = request(&f, &s_piece);
+        CHECK(ret == ESP_OK, "request %d: %s", i, esp_err_to_name(ret));
+        CHECK(s_piece.len == g->expected_len && memcmp(s_piece.out, g->expected, g->expected_len) == 0,
+              "request %d: campos distintos", i);
+    }
+
+    // Sin Content-Type: formulario simple
+    static const uint8_t simple[] = "msg=hola";
+    f = (fake_req_t) { .body = simple, .length = sizeof(simple) - 1 };
+    ret = request(&f, &s_piece);
+    CHECK(ret == ESP_OK && s_piece.len == 9 && memcmp(s_piece.out, "msg=hola;", 9) == 0,
+          "request sin Content-Type: %s", esp_err_to_name(ret));
+
+    // Content-Type que no entra en el buffer
+    char long_type[200];
+    memset(long_type, 'x', sizeof(long_type) - 1);
+    long_type[sizeof(long_type) - 1] = '\0';
+    f = (fake_req_t) { .content_type = long_type, .body = simple, .length = sizeof(simple) - 1 };
+    ret = request(&f, &s_piece);
+    CHECK(ret == ESP_ERR_INVALID_ARG, "request con Content-Type largo: %s", esp_err_to_name(ret));
+
+    // Demasiados timeouts seguidos o conexión caída
+    f = (fake_req_t) { .content_type = UE, .body = simple, .length = sizeof(simple) - 1, .timeouts = 5 };
+    ret = request(&f, &s_piece);
+    CHECK(ret == ESP_FAIL, "request con 5 timeouts: %s", esp_err_to_name(ret));
+    f = (fake_req_t) { .content_type = UE, .body = simple, .length = sizeof(simple) - 1, .close_at = 1 };
+    ret = request(&f, &s_piece);
+    CHECK(ret == ESP_FAIL, "request cortada: %s", esp_err_to_name(ret));
+}
+
+// ============================================
+// BENCHMARK
+// ============================================
+
+static esp_err_t count_cb(void *ctx, const char *name,
+                          const uint8_t *data, size_t length, bool done)
+{
+    (void)name;
+    (void)data;
+    *(size_t *)ctx += length + done;
+    return ESP_OK;
+}
+
+static void bench_one(const char *what, const char *content_type, const uint8_t *body, size_t length)
+{
+    size_t sink = 0;
+    size_t rounds = 0;
+    double start = now_seconds();
+    double elapsed;
+
+    do {
+        form_parser_t p;
+        form_parser_init(&p, content_type, count_cb, &sink);
+        for (size_t pos = 0; pos < length; pos += 256) {
+            form_parser_feed(&p, body + pos, length - pos < 256 ? length - pos : 256);
+        }
+        form_parser_finish(&p);
+        rounds++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < 0.3);
+
+    printf("  %-28s %8.1f MB/s\n", what, rounds * length / elapsed / 1e6);
+    CHECK(sink > 0, "%s: sin datos", what);
+}
+
+static void bench(void)
+{
+    static uint8_t body[64 * 1024 + 256];
+    static const char head[] = "--XyZ\r\nContent-Disposition: form-data; name=\"f\"\r\n\r\n";
+    static const char tail[] = "\r\n--XyZ--\r\n";
+    size_t data_len = 64 * 1024;
+    size_t len;
+
+    printf("form_parser, tramos de 256 bytes:\n");
+
+    // Archivo binario: un '\r' cada 256 bytes de media
+    rng_seed(1);
+    len = 0;
+    put(body, &len, head, sizeof(head) - 1);
+    for (size_t i = 0; i < data_len; i++) {
+        body[len++] = (uint8_t)rng_next();
+    }
+    put(body, &len, tail, sizeof(tail) - 1);
+    bench_one("multipart binario", MP, body, len);
+
+    // Texto con un salto de línea cada 40 bytes
+    len = 0;
+    put(body, &len, head, sizeof(head) - 1);
+    for (size_t i = 0; i < data_len; i++) {
+        body[len++] = i % 40 == 38 ? '\r' : i % 40 == 39 ? '\n' : 'a' + i % 26;
+    }
+    put(body, &len, tail, sizeof(tail) - 1);
+    bench_one("multipart texto", MP, body, len);
+
+    // Peor caso: casi-delimitadores seguidos
+    len = 0;
+    put(body, &len, head, sizeof(head) - 1);
+    while (len + 6 < sizeof(head) + data_len) {
+        put(body, &len, "\r\n--Xy", 6);
+    }
+    put(body, &len, tail, sizeof(tail) - 1);
+    bench_one("multipart casi-delimitadores", MP, body, len);
+
+    // url-encoded: un tercio de escapes
+    len = 0;
+    put(body, &len, "msg=", 4);
+    while (len + 5 < data_len) {
+        put(body, &len, "ab%C3%A1+", 9);
+    }
+    bench_one("url-encoded", UE, body, len);
+}
+
+// ============================================
+// MAIN
+// ============================================
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 12345;
+    uint32_t iterations = 3000;
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoul(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = strtoul(argv[i + 1], NULL, 0);
+        }
+    }
+
+    test_known();
+    test_callback_error();
+    test_text_cb();
+    test_fuzz(seed, iterations);
+    test_request();
+    if (bench_requested(argc, argv)) {
+        bench();
+    }
+    return host_test_result("form_parser");
+}
@@ -0,0 +1,79 @@
+// Utilidades comunes de las pruebas en host: comprobaciones, un generador
+// pseudoaleatorio reproducible y un reloj para los benchmarks.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static int s_failures = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            s_failures++; \
+            printf("FALLO %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+// Resultado para ctest: 0 si todas las comprobaciones pasaron
+static inline int host_test_result(const char *name)
+{
+    if (s_failures > 0) {
+        printf("❌ %s: %d fallos\n", name, s_failures);
+        return 1;
+    }
+    printf("✅ %s\n", name);
+    return 0;
+}
+
+// ============================================
+// ALEATORIO (xorshift32, misma secuencia en cualquier máquina)
+// ============================================
+
+static uint32_t s_rng = 0x2545F491u;
+
+static inline void rng_seed(uint32_t seed)
+{
+    s_rng = seed ? seed : 0x2545F491u;
+}
+
+static inline uint32_t rng_next(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+// Entero en [0, n)
+static inline uint32_t rng_below(uint32_t n)
+{
+    return n ? rng_next() % n : 0;
+}
+
+// ============================================
+// BENCHMARK
+// ============================================
+
+static inline double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Los benchmarks solo corren con --bench (ctest los lanza aparte)
+static inline bool bench_requested(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
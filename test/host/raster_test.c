@@ -0,0 +1,438 @@
+// Pruebas en host de main/raster.c
+//
+// - pack_ordered() contra una conversión píxel a píxel: umbral fijo
+//   (negro si gris < 128) y Bayer 8x8 (negro si gris < 4 * b + 2, el
+//   centro de cada escalón). Todos los grises en cada carril y cada fila
+//   de la matriz, carriles mezclados al azar y anchos de 1 a
+//   RASTER_MAX_WIDTH, para que la multiplicación que junta los bits no
+//   cambie de resultado si alguien la toca.
+// - La API entera con un trabajo falso: bandas GS v 0, fase de Bayer entre
+//   llamadas, stride y Floyd–Steinberg contra una versión directa.
+// - Con --bench: Mpx/s de los kernels contra la conversión píxel a píxel y
+//   Floyd–Steinberg a 576 puntos (cabezal de 80 mm).
+//
+// Uso: raster_test [--bench] [--seed N] [--iterations N]
+
+// Se incluye el .c para llegar a pack_ordered() y a la matriz
+#include "raster.c"
+#include "host_test.h"
+
+// ============================================
+// TRABAJO FALSO
+// ============================================
+
+#define JOB_MAX (1024 * 1024)
+
+struct printer_job {
+    uint8_t data[JOB_MAX];
+    size_t len;
+    size_t fail_after;          // Falla al pasar de estos bytes (0 = nunca)
+};
+
+static printer_job_t s_job;
+
+esp_err_t printer_job_write(printer_job_t *job, const uint8_t *data, size_t length)
+{
+    if (job->fail_after > 0 && job->len + length > job->fail_after) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (job->len + length > sizeof(job->data)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(job->data + job->len, data, length);
+    job->len += length;
+    return ESP_OK;
+}
+
+// ============================================
+// REFERENCIAS PÍXEL A PÍXEL
+// ============================================
+
+static bool ref_black(raster_dither_t dither, uint8_t g, uint32_t x, uint32_t y)
+{
+    if (dither == RASTER_DITHER_BAYER) {
+        return g < 4 * s_bayer8[y & 7][x & 7] + 2;
+    }
+    return g < 128;
+}
+
+// GS v 0: píxel 0 en el bit 7, los puntos de relleno en blanco
+static void ref_ordered_row(raster_dither_t dither, const uint8_t *gray, uint16_t width,
+                            uint32_t y, uint8_t *out)
+{
+    memset(out, 0, (width + 7) / 8);
+    for (uint32_t x = 0; x < width; x++) {
+        if (ref_black(dither, gray[x], x, y)) {
+            out[x / 8] |= 0x80 >> (x & 7);
+        }
+    }
+}
+
+// Floyd–Steinberg de libro, con el error x16 y el redondeo del módulo
+typedef struct {
+    uint16_t width;
+    int cur[RASTER_MAX_WIDTH + 1];
+    int next[RASTER_MAX_WIDTH + 1];
+} ref_fs_t;
+
+static void ref_fs_row(ref_fs_t *fs, const uint8_t *gray, uint8_t *out)
+{
+    memset(out, 0, (fs->width + 7) / 8);
+    memset(fs->next, 0, sizeof(fs->next));
+
+    for (uint32_t x = 0; x < fs->width; x++) {
+        int v = gray[x] + ((fs->cur[x] + 8) >> 4);
+        v = v < 0 ? 0 : v > 255 ? 255 : v;
+
+        bool black = v < 128;
+        int e = black ? v : v - 255;
+        if (black) {
+            out[x / 8] |= 0x80 >> (x & 7);
+        }
+
+        // Lo que sale por los bordes se pierde
+        fs->cur[x + 1] += 7 * e;
+        if (x > 0) {
+            fs->next[x - 1] += 3 * e;
+        }
+        fs->next[x] += 5 * e;
+        fs->next[x + 1] += e;
+    }
+    memcpy(fs->cur, fs->next, sizeof(fs->cur));
+}
+
+// ============================================
+// pack_ordered()
+// ============================================
+
+static uint64_t row_thresholds(raster_dither_t dither, uint32_t y)
+{
+    raster_t *r;
+    CHECK(raster_begin(&s_job, 8, dither, &r) == ESP_OK, "raster_begin");
+    uint64_t u = r->bayer[y & 7];
+    raster_end(r);
+    return u;
+}
+
+static void test_bayer_matrix(void)
+{
+    bool seen[64] = { false };
+
+    for (int i = 0; i < 64; i++) {
+        uint8_t b = s_bayer8[i / 8][i % 8];
+        CHECK(b < 64 && !seen[b], "la matriz de Bayer repite o se pasa en %d", i);
+        if (b < 64) {
+            seen[b] = true;
+        }
+    }
+}
+
+// Cada gris en cada carril, con los otros carriles en los extremos
+static void test_lanes_exhaustive(void)
+{
+    static const raster_dither_t dithers[] = { RASTER_DITHER_THRESHOLD, RASTER_DITHER_BAYER };
+
+    for (size_t d = 0; d < 2; d++) {
+        for (uint32_t y = 0; y < 8; y++) {
+            uint64_t u = row_thresholds(dithers[d], y);
+            for (int lane = 0; lane < 8; lane++) {
+                for (int fill = 0; fill < 2; fill++) {
+                    for (int v = 0; v < 256; v++) {
+                        uint8_t gray[8];
+                        uint8_t got;
+                        uint8_t want;
+
+                        memset(gray, fill ? 0xFF : 0x00, sizeof(gray));
+                        gray[lane] = v;
+                        pack_ordered(gray, &got, 8, u);
+                        ref_ordered_row(dithers[d], gray, 8, y, &want);
+                        if (got != want) {
+                            CHECK(false, "%s fila %u carril %d gris %d: 0x%02X en vez de 0x%02X",
+                                  d ? "Bayer" : "umbral", y, lane, v, got, want);
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Carriles al azar y umbrales de 7 bits cualesquiera: ningún préstamo pasa
+// de un carril a otro
+static void test_lanes_random(uint32_t iterations)
+{
+    for (uint32_t it = 0; it < iterations; it++) {
+        uint64_t g = ((uint64_t)rng_next() << 32) | rng_next();
+        uint64_t u = (((uint64_t)rng_next() << 32) | rng_next()) & RASTER_LANES_LO7;
+        uint8_t want = 0;
+
+        for (int i = 0; i < 8; i++) {
+            uint8_t gi = g >> (8 * i);
+            uint8_t ui = u >> (8 * i);
+            if ((gi >> 1) <= ui) {
+                want |= 0x80 >> i;
+            }
+        }
+        uint8_t got = pack8(g, u);
+        if (got != want) {
+            CHECK(false, "pack8(%016llx, %016llx) = 0x%02X en vez de 0x%02X",
+                  (unsigned long long)g, (unsigned long long)u, got, want);
+            return;
+        }
+    }
+}
+
+static uint8_t s_gray[RASTER_MAX_WIDTH * 64];
+static uint8_t s_got[RASTER_MAX_WIDTH / 8 + 1];
+static uint8_t s_want[RASTER_MAX_WIDTH / 8 + 1];
+
+static void random_gray(uint8_t *gray, size_t length)
+{
+    // Mitad ruido, mitad rampas: las rampas pasan por cada umbral
+    uint32_t kind = rng_below(3);
+    for (size_t i = 0; i < length; i++) {
+        gray[i] = kind == 0 ? (uint8_t)rng_next() :
+                  kind == 1 ? (uint8_t)(i * 7) :
+                  (uint8_t)(rng_below(2) ? 126 + rng_below(4) : rng_next());
+    }
+}
+
+static void test_widths(uint32_t iterations)
+{
+    for (uint32_t it = 0; it < iterations; it++) {
+        raster_dither_t dither = rng_below(2) ? RASTER_DITHER_BAYER : RASTER_DITHER_THRESHOLD;
+        uint16_t width = it < RASTER_MAX_WIDTH ? it + 1 : 1 + rng_below(RASTER_MAX_WIDTH);
+        uint32_t y = rng_below(8);
+        uint16_t bytes = (width + 7) / 8;
+
+        random_gray(s_gray, width);
+        // Lo que hay después del ancho no se tiene que leer ni notar
+        memset(s_gray + width, 0, 8);
+        memset(s_got, 0xA5, sizeof(s_got));
+        pack_ordered(s_gray, s_got, width, row_thresholds(dither, y));
+        ref_ordered_row(dither, s_gray, width, y, s_want);
+
+        if (memcmp(s_got, s_want, bytes) != 0 || s_got[bytes] != 0xA5) {
+            CHECK(false, "%s ancho %u fila %u: distinto de la referencia",
+                  dither == RASTER_DITHER_BAYER ? "Bayer" : "umbral", width, y);
+            return;
+        }
+    }
+}
+
+// ============================================
+// API CON UN TRABAJO FALSO
+// ============================================
+
+// Lo que tendría que llegar al trabajo: bandas de RASTER_BAND_ROWS filas
+static size_t expected_stream(raster_dither_t dither, const uint8_t *gray, size_t stride,
+                              uint16_t width, uint32_t rows, uint8_t *out)
+{
+    static ref_fs_t fs;
+    uint16_t row_bytes = (width + 7) / 8;
+    size_t n = 0;
+
+    memset(&fs, 0, sizeof(fs));
+    fs.width = width;
+    for (uint32_t y = 0; y < rows; y += RASTER_BAND_ROWS) {
+        uint32_t band = rows - y < RASTER_BAND_ROWS ? rows - y : RASTER_BAND_ROWS;
+        const uint8_t cmd[8] = {
+            0x1D, 0x76, 0x30, 0x00, row_bytes & 0xFF, row_bytes >> 8, band & 0xFF, band >> 8,
+        };
+        memcpy(out + n, cmd, sizeof(cmd));
+        n += sizeof(cmd);
+        for (uint32_t k = 0; k < band; k++) {
+            const uint8_t *row = gray + (size_t)(y + k) * stride;
+            if (dither == RASTER_DITHER_FLOYD_STEINBERG) {
+                ref_fs_row(&fs, row, out + n);
+            } else {
+                ref_ordered_row(dither, row, width, y + k, out + n);
+            }
+            n += row_bytes;
+        }
+    }
+    return n;
+}
+
+static uint8_t s_expected[JOB_MAX];
+
+static void test_stream(uint32_t iterations)
+{
+    for (uint32_t it = 0; it < iterations; it++) {
+        raster_dither_t dither = (raster_dither_t)rng_below(3);
+        uint16_t width = rng_below(4) ? 1 + rng_below(RASTER_MAX_WIDTH) : 576;
+        size_t stride = width + rng_below(16);
+        uint32_t rows = 1 + rng_below(sizeof(s_gray) / stride < 60 ? sizeof(s_gray) / stride : 60);
+        raster_t *r;
+
+        random_gray(s_gray, stride * rows);
+        s_job.len = 0;
+        s_job.fail_after = 0;
+        CHECK(raster_begin(&s_job, width, dither, &r) == ESP_OK, "raster_begin %u", width);
+
+        // Filas en tandas al azar: la fase de Bayer y el error siguen
+        for (uint32_t y = 0; y < rows;) {
+            uint16_t n = 1 + rng_below(rows - y);
+            CHECK(raster_write_rows(r, s_gray + y * stride, stride, n) == ESP_OK, "raster_write_rows");
+            y += n;
+        }
+        CHECK(raster_end(r) == ESP_OK, "raster_end");
+
+        size_t n = expected_stream(dither, s_gray, stride, width, rows, s_expected);
+        if (s_job.len != n || memcmp(s_job.data, s_expected, n) != 0) {
+            CHECK(false, "imagen %u (dither %d, %ux%u): bandas distintas de la referencia",
+                  it, dither, width, rows);
+            return;
+        }
+    }
+}
+
+static void test_errors(void)
+{
+    raster_t *r;
+
+    CHECK(raster_begin(NULL, 8, RASTER_DITHER_BAYER, &r) == ESP_ERR_INVALID_ARG, "sin trabajo");
+    CHECK(raster_begin(&s_job, 0, RASTER_DITHER_BAYER, &r) == ESP_ERR_INVALID_ARG, "ancho 0");
+    CHECK(raster_begin(&s_job, RASTER_MAX_WIDTH + 1, RASTER_DITHER_BAYER, &r) == ESP_ERR_INVALID_ARG,
+          "ancho de más");
+    CHECK(raster_begin(&s_job, 8, (raster_dither_t)3, &r) == ESP_ERR_INVALID_ARG, "dither");
+
+    // El primer error del trabajo queda y se devuelve hasta el final
+    s_job.len = 0;
+    s_job.fail_after = 100;
+    memset(s_gray, 0, 64 * RASTER_BAND_ROWS * 4);
+    CHECK(raster_begin(&s_job, 64, RASTER_DITHER_THRESHOLD, &r) == ESP_OK, "raster_begin");
+    esp_err_t ret = raster_write_rows(r, s_gray, 64, RASTER_BAND_ROWS * 2);
+    CHECK(ret == ESP_ERR_TIMEOUT, "error del trabajo: %s", esp_err_to_name(ret));
+    ret = raster_write_rows(r, s_gray, 64, 1);
+    CHECK(ret == ESP_ERR_TIMEOUT, "error pegado: %s", esp_err_to_name(ret));
+    CHECK(raster_end(r) == ESP_ERR_TIMEOUT, "raster_end no devuelve el error");
+    s_job.fail_after = 0;
+}
+
+// ============================================
+// BENCHMARK
+// ============================================
+
+#define BENCH_WIDTH 576
+#define BENCH_ROWS  RASTER_BAND_ROWS
+
+typedef void (*bench_fn_t)(const uint8_t *gray, uint8_t *out, uint32_t y);
+
+static uint64_t s_bench_u[8];
+static raster_dither_t s_bench_dither;
+
+static void bench_kernel(const uint8_t *gray, uint8_t *out, uint32_t y)
+{
+    pack_ordered(gray, out, BENCH_WIDTH, s_bench_u[y & 7]);
+}
+
+static void bench_reference(const uint8_t *gray, uint8_t *out, uint32_t y)
+{
+    ref_ordered_row(s_bench_dither, gray, BENCH_WIDTH, y, out);
+}
+
+static double bench_rows(bench_fn_t fn)
+{
+    static uint8_t out[BENCH_ROWS * BENCH_WIDTH / 8];
+    uint64_t rows = 0;
+    double start = now_seconds();
+    double elapsed;
+
+    do {
+        for (uint32_t y = 0; y < BENCH_ROWS; y++) {
+            fn(s_gray + y * BENCH_WIDTH, out + y * BENCH_WIDTH / 8, y);
+        }
+        rows += BENCH_ROWS;
+        elapsed = now_seconds() - start;
+    } while (elapsed < 0.2);
+
+    CHECK(out[0] != 0x5A || out[1] != 0x5A, "benchmark sin salida");
+    return rows * BENCH_WIDTH / elapsed / 1e6;
+}
+
+static void bench(void)
+{
+    static const raster_dither_t dithers[] = { RASTER_DITHER_THRESHOLD, RASTER_DITHER_BAYER };
+    static const char *const names[] = { "umbral", "Bayer" };
+
+    rng_seed(1);
+    random_gray(s_gray, BENCH_WIDTH * BENCH_ROWS);
+    printf("raster, %u puntos por fila:\n", BENCH_WIDTH);
+
+    for (size_t d = 0; d < 2; d++) {
+        s_bench_dither = dithers[d];
+        for (uint32_t y = 0; y < 8; y++) {
+            s_bench_u[y] = row_thresholds(dithers[d], y);
+        }
+        double fast = bench_rows(bench_kernel);
+        double ref = bench_rows(bench_reference);
+        printf("  %-16s %8.1f Mpx/s (píxel a píxel %6.1f, x%.1f)\n",
+               names[d], fast, ref, fast / ref);
+    }
+
+    // Floyd–Steinberg por la API, con bandas y todo
+    raster_t *r;
+    uint64_t rows = 0;
+    double start = now_seconds();
+    double elapsed;
+
+    s_job.fail_after = 0;
+    raster_begin(&s_job, BENCH_WIDTH, RASTER_DITHER_FLOYD_STEINBERG, &r);
+    do {
+        s_job.len = 0;
+        raster_write_rows(r, s_gray, BENCH_WIDTH, BENCH_ROWS);
+        rows += BENCH_ROWS;
+        elapsed = now_seconds() - start;
+    } while (elapsed < 0.2);
+    raster_end(r);
+    printf("  %-16s %8.1f Mpx/s (%.2f us por fila)\n", "Floyd-Steinberg",
+           rows * BENCH_WIDTH / elapsed / 1e6, elapsed / rows * 1e6);
+
+    static ref_fs_t fs;
+    static uint8_t out[BENCH_WIDTH / 8];
+    memset(&fs, 0, sizeof(fs));
+    fs.width = BENCH_WIDTH;
+    rows = 0;
+    start = now_seconds();
+    do {
+        for (uint32_t y = 0; y < BENCH_ROWS; y++) {
+            ref_fs_row(&fs, s_gray + y * BENCH_WIDTH, out);
+        }
+        rows += BENCH_ROWS;
+        elapsed = now_seconds() - start;
+    } while (elapsed < 0.2);
+    printf("  %-16s %8.1f Mpx/s (%.2f us por fila)\n", "  referencia",
+           rows * BENCH_WIDTH / elapsed / 1e6, elapsed / rows * 1e6);
+}
+
+// ============================================
+// MAIN
+// ============================================
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 12345;
+    uint32_t iterations = 2000;
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoul(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = strtoul(argv[i + 1], NULL, 0);
+        }
+    }
+
+    rng_seed(seed);
+    test_bayer_matrix();
+    test_lanes_exhaustive();
+    test_lanes_random(iterations * 500);
+    test_widths(iterations < RASTER_MAX_WIDTH ? RASTER_MAX_WIDTH : iterations);
+    test_stream(iterations / 10);
+    test_errors();
+    if (bench_requested(argc, argv)) {
+        bench();
+    }
+    return host_test_result("raster");
+}
@@ -0,0 +1,22 @@
+// Sustituto de esp_http_server.h para el host: solo lo que usa
+// form_parser.c. Las funciones las implementa cada prueba.
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+
+#define HTTPD_SOCK_ERR_FAIL      -1
+#define HTTPD_SOCK_ERR_INVALID   -2
+#define HTTPD_SOCK_ERR_TIMEOUT   -3
+
+typedef void *httpd_handle_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    size_t content_len;
+    void *user_ctx;
+} httpd_req_t;
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size);
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len);
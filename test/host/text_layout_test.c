@@ -0,0 +1,503 @@
+// Pruebas en host de main/text_layout.c
+//
+// - Las tablas a mano contra los mapeos estándar de CP850, CP858 y
+//   Windows-1252 (de unicode.org, copiados abajo en sentido byte → código):
+//   cada carácter que la página tiene y el módulo conoce tiene que salir
+//   con su byte, y los reemplazos solo se usan si la página no lo tiene.
+// - Controles, invisibles y UTF-8 inválido.
+// - Corte de línea contra una implementación de referencia, con textos al
+//   azar en las tres páginas y varios anchos.
+// - Con --bench: MB/s de UTF-8 de entrada por página, sin corte y a 32 y
+//   48 columnas.
+//
+// Uso: text_layout_test [--bench] [--seed N] [--iterations N]
+
+// Se incluye el .c para llegar a las tablas static
+#include "text_layout.c"
+#include "host_test.h"
+#include <stdlib.h>
+
+// escpos.c la necesita para los trabajos; aquí todo va a un buffer
+esp_err_t printer_job_write(printer_job_t *job, const uint8_t *data, size_t length)
+{
+    (void)job;
+    (void)data;
+    (void)length;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// ============================================
+// MAPEOS ESTÁNDAR (bytes 0x80..0xFF → Unicode, 0 = sin definir)
+// ============================================
+
+static const uint16_t s_ref_cp850[128] = {
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00F8, 0x00A3, 0x00D8, 0x00D7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x00AE, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x00C1, 0x00C2, 0x00C0,
+    0x00A9, 0x2563, 0x2551, 0x2557, 0x255D, 0x00A2, 0x00A5, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x00E3, 0x00C3,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x00A4,
+    0x00F0, 0x00D0, 0x00CA, 0x00CB, 0x00C8, 0x0131, 0x00CD, 0x00CE,
+    0x00CF, 0x2518, 0x250C, 0x2588, 0x2584, 0x00A6, 0x00CC, 0x2580,
+    0x00D3, 0x00DF, 0x00D4, 0x00D2, 0x00F5, 0x00D5, 0x00B5, 0x00FE,
+    0x00DE, 0x00DA, 0x00DB, 0x00D9, 0x00FD, 0x00DD, 0x00AF, 0x00B4,
+    0x00AD, 0x00B1, 0x2017, 0x00BE, 0x00B6, 0x00A7, 0x00F7, 0x00B8,
+    0x00B0, 0x00A8, 0x00B7, 0x00B9, 0x00B3, 0x00B2, 0x25A0, 0x00A0,
+};
+
+static const uint16_t s_ref_cp1252[128] = {
+    0x20AC, 0x0000, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x0000, 0x017D, 0x0000,
+    0x0000, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x0000, 0x017E, 0x0178,
+    0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+    0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+    0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+    0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+    0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+    0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+    0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+    0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+    0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+    0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+    0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+    0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+};
+
+typedef struct {
+    text_codepage_t page;
+    const char *name;
+} page_t;
+
+static const page_t s_pages[] = {
+    { TEXT_CODEPAGE_CP850, "CP850" },
+    { TEXT_CODEPAGE_CP858, "CP858" },
+    { TEXT_CODEPAGE_WPC1252, "WPC1252" },
+};
+
+#define PAGE_COUNT (sizeof(s_pages) / sizeof(s_pages[0]))
+
+// CP858 es CP850 con el euro en lugar de la ı sin punto
+static uint32_t ref_unicode(text_codepage_t page, uint8_t b)
+{
+    if (b < 0x80) {
+        return b;
+    }
+    if (page == TEXT_CODEPAGE_WPC1252) {
+        return s_ref_cp1252[b - 0x80];
+    }
+    if (page == TEXT_CODEPAGE_CP858 && b == 0xD5) {
+        return 0x20AC;
+    }
+    return s_ref_cp850[b - 0x80];
+}
+
+// Byte de la página para un código, o -1 si no lo tiene
+static int ref_byte(text_codepage_t page, uint32_t cp)
+{
+    for (int b = 0x80; b <= 0xFF; b++) {
+        if (ref_unicode(page, b) == cp) {
+            return b;
+        }
+    }
+    return -1;
+}
+
+// ============================================
+// SALIDA
+// ============================================
+
+static size_t utf8_encode(uint32_t cp, char *out)
+{
+    if (cp < 0x80) {
+        out[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = 0xC0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = 0xE0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3F);
+        out[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3F);
+    out[2] = 0x80 | ((cp >> 6) & 0x3F);
+    out[3] = 0x80 | (cp & 0x3F);
+    return 4;
+}
+
+#define OUT_MAX 16384
+
+static uint8_t s_out[OUT_MAX];
+static size_t s_out_len;
+
+// Sin corte (columns = 0 y wrap = false) usa text_layout_write_raw()
+static esp_err_t render(const char *utf8, size_t length, text_codepage_t page,
+                        uint8_t columns, bool wrap)
+{
+    text_layout_t layout = { .codepage = page, .columns = columns };
+    escpos_t b;
+    esp_err_t ret;
+
+    escpos_begin_buffer(&b, s_out, sizeof(s_out));
+    if (wrap) {
+        ret = text_layout_write(&b, utf8, &layout);
+    } else {
+        ret = text_layout_write_raw(&b, utf8, length, &layout);
+    }
+    s_out_len = escpos_length(&b);
+    return ret;
+}
+
+static bool out_is(const char *expected)
+{
+    return s_out_len == strlen(expected) && memcmp(s_out, expected, s_out_len) == 0;
+}
+
+// ============================================
+// TABLAS CONTRA LOS MAPEOS ESTÁNDAR
+// ============================================
+
+// Todo byte de la página cuyo carácter conoce el módulo sale igual
+static void test_pages(void)
+{
+    for (size_t p = 0; p < PAGE_COUNT; p++) {
+        text_codepage_t page = s_pages[p].page;
+        int unknown = 0;
+
+        for (int b = 0x80; b <= 0xFF; b++) {
+            uint32_t cp = ref_unicode(page, b);
+            char utf8[4];
+
+            if (cp == 0) {
+                continue;
+            }
+            render(utf8, utf8_encode(cp, utf8), page, 0, false);
+
+            if (cp == 0xAD) {
+                CHECK(s_out_len == 0, "%s: el guion opcional no se descarta", s_pages[p].name);
+            } else if ((cp >= 0xA0 && cp <= 0xFF) || find_extra(cp)) {
+                CHECK(s_out_len == 1 && s_out[0] == b, "%s: U+%04X sale 0x%02X en vez de 0x%02X",
+                      s_pages[p].name, (unsigned)cp, s_out_len ? s_out[0] : 0, b);
+            } else {
+                // Cajas y símbolos que no hacen falta en un mensaje
+                CHECK(out_is("?"), "%s: U+%04X sin tabla no sale '?'", s_pages[p].name, (unsigned)cp);
+                unknown++;
+            }
+        }
+
+        // Latin-1 completo está en las tres páginas
+        for (uint32_t cp = 0xA0; cp <= 0xFF; cp++) {
+            CHECK(cp == 0xAD || ref_byte(page, cp) >= 0, "%s: falta U+%04X en el mapeo",
+                  s_pages[p].name, (unsigned)cp);
+        }
+        printf("  %-8s %d caracteres de la página sin tabla (cajas, bloques)\n",
+               s_pages[p].name, unknown);
+    }
+}
+
+// Cada entrada de s_extras contra los mapeos
+static void test_extras(void)
+{
+    for (size_t i = 0; i < TEXT_EXTRAS_COUNT; i++) {
+        const text_extra_t *e = &s_extras[i];
+        const uint8_t bytes[PAGE_COUNT] = { e->cp850, e->cp858, e->wpc1252 };
+
+        CHECK(i == 0 || s_extras[i - 1].cp < e->cp, "s_extras no está ordenada en U+%04X", e->cp);
+        CHECK(find_extra(e->cp) == e, "find_extra no encuentra U+%04X", e->cp);
+        CHECK(e->fallback[0] != '\0', "U+%04X sin reemplazo", e->cp);
+        for (const char *f = e->fallback; *f; f++) {
+            CHECK(*f > 0x20 && *f < 0x7F, "U+%04X: reemplazo no imprimible", e->cp);
+        }
+
+        for (size_t p = 0; p < PAGE_COUNT; p++) {
+            int b = ref_byte(s_pages[p].page, e->cp);
+            if (bytes[p]) {
+                CHECK(b == bytes[p], "%s: U+%04X está en 0x%02X, la tabla dice 0x%02X",
+                      s_pages[p].name, e->cp, b, bytes[p]);
+            } else {
+                CHECK(b < 0, "%s: U+%04X está en 0x%02X y la tabla usa el reemplazo",
+                      s_pages[p].name, e->cp, b);
+            }
+
+            char utf8[4];
+            render(utf8, utf8_encode(e->cp, utf8), s_pages[p].page, 0, false);
+            CHECK(bytes[p] ? (s_out_len == 1 && s_out[0] == bytes[p]) : out_is(e->fallback),
+                  "%s: U+%04X sale mal", s_pages[p].name, e->cp);
+        }
+    }
+}
+
+// ============================================
+// CONTROLES E INVÁLIDOS
+// ============================================
+
+typedef struct {
+    const char *in;
+    const char *out;        // Igual en las tres páginas
+} special_t;
+
+static const special_t s_specials[] = {
+    { "Hola, mundo! ~{}", "Hola, mundo! ~{}" },
+    { "a\x01\x1b@\x7f" "b", "a@b" },            // ESC/POS inyectado
+    { "a\tb\r\nc", "a b\nc" },
+    { "a\xc2\x80\xc2\x9f" "b", "ab" },          // C1
+    { "e\xcc\x81", "e" },                        // Marca combinante
+    { "a\xe2\x80\x8b" "b\xef\xbb\xbf", "ab" },  // Ancho cero, BOM
+    { "\xe2\x9d\xa4\xef\xb8\x8f", "?" },        // ❤️: el selector se descarta
+    { "\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd", "?" }, // 👍🏽: el tono se descarta
+    { "\xf0\x9f\x98\x80", "?" },                // Emoji
+    { "\x80" "a", "?a" },                        // Continuación suelta
+    { "\xff" "a", "?a" },
+    { "\xe2\x82" "a", "?a" },                    // Secuencia cortada
+    { "a\xc3", "a?" },                           // Cortada al final
+};
+
+static void test_specials(void)
+{
+    for (size_t i = 0; i < sizeof(s_specials) / sizeof(s_specials[0]); i++) {
+        for (size_t p = 0; p < PAGE_COUNT; p++) {
+            render(s_specials[i].in, strlen(s_specials[i].in), s_pages[p].page, 0, false);
+            CHECK(out_is(s_specials[i].out), "%s: especial %zu: '%.*s'",
+                  s_pages[p].name, i, (int)s_out_len, s_out);
+        }
+    }
+
+    // NBSP no corta la línea
+    render("ab\xc2\xa0" "cd", 6, TEXT_CODEPAGE_WPC1252, 3, true);
+    CHECK(out_is("ab\xa0\ncd"), "NBSP: '%.*s'", (int)s_out_len, s_out);
+}
+
+// ============================================
+// CORTE DE LÍNEA
+// ============================================
+
+typedef struct {
+    const char *in;
+    uint8_t columns;
+    text_codepage_t page;
+    const char *out;
+} wrap_case_t;
+
+static const wrap_case_t s_wrap_cases[] = {
+    { "hola mundo", 10, TEXT_CODEPAGE_CP858, "hola mundo" },
+    { "hola mundo!", 10, TEXT_CODEPAGE_CP858, "hola\nmundo!" },
+    { "  hola   mundo  ", 10, TEXT_CODEPAGE_CP858, "hola mundo" },
+    { "abcdefghijklmnopqrstuvwxyz", 10, TEXT_CODEPAGE_CP858, "abcdefghij\nklmnopqrst\nuvwxyz" },
+    { "ab abcdefghijklmn", 10, TEXT_CODEPAGE_CP858, "ab\nabcdefghij\nklmn" },
+    { "a\n\nb \n c", 10, TEXT_CODEPAGE_CP858, "a\n\nb\nc" },
+    // Una columna por carácter, no por byte de UTF-8
+    { "ñandú café", 10, TEXT_CODEPAGE_CP850, "\xa4" "and\xa3 caf\x82" },
+    { "ñandú café", 10, TEXT_CODEPAGE_WPC1252, "\xf1" "and\xfa caf\xe9" },
+    // Los reemplazos ocupan lo que miden
+    { "12 € 345", 6, TEXT_CODEPAGE_CP850, "12 EUR\n345" },
+    { "12 € 345", 6, TEXT_CODEPAGE_CP858, "12 \xd5\n345" },
+    { "fin…", 5, TEXT_CODEPAGE_CP858, "fin..\n." },
+};
+
+// Corte voraz hecho aparte, sobre la salida sin cortar
+static size_t reference_wrap(const uint8_t *in, size_t len, uint8_t columns, uint8_t *out)
+{
+    size_t n = 0;
+    size_t col = 0;
+    bool space = false;
+    size_t i = 0;
+
+    while (i < len) {
+        if (in[i] == '\n') {
+            out[n++] = '\n';
+            col = 0;
+            space = false;
+            i++;
+        } else if (in[i] == ' ') {
+            space = col > 0;
+            i++;
+        } else {
+            size_t end = i;
+            while (end < len && in[end] != ' ' && in[end] != '\n') {
+                end++;
+            }
+            // Palabras más largas que la línea: en tramos de columns
+            while (i < end) {
+                size_t piece = end - i < columns ? end - i : columns;
+                if (col > 0 && col + space + piece > columns) {
+                    out[n++] = '\n';
+                    col = 0;
+                    space = false;
+                }
+                if (space) {
+                    out[n++] = ' ';
+                    col++;
+                    space = false;
+                }
+                memcpy(out + n, in + i, piece);
+                n += piece;
+                col += piece;
+                i += piece;
+            }
+        }
+    }
+    return n;
+}
+
+static const char *const s_words[] = {
+    "hola", "mundo", "ñandú", "café", "pingüino", "¿qué?", "¡sí!", "€10",
+    "“citas”", "‘simples’", "—", "–", "…", "ŒUVRE", "œ", "ıi", "™",
+    "😀", "👍🏽", "❤️", "e\xcc\x81", "\xc2\xa0", "\t", "\n", "\n\n", "  ",
+    "supercalifragilisticoespialidoso", "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz0123456789",
+    "a", "de", "la", "x", "ESC\x1b@",
+};
+
+static char s_text[4096];
+
+static size_t random_text(void)
+{
+    size_t len = 0;
+    uint32_t words = rng_below(60);
+
+    for (uint32_t i = 0; i < words; i++) {
+        const char *w = s_words[rng_below(sizeof(s_words) / sizeof(s_words[0]))];
+        size_t wl = strlen(w);
+        if (len + wl + 2 >= sizeof(s_text)) {
+            break;
+        }
+        memcpy(s_text + len, w, wl);
+        len += wl;
+        if (rng_below(4)) {
+            s_text[len++] = ' ';
+        }
+    }
+    s_text[len] = '\0';
+    return len;
+}
+
+static uint8_t s_raw[OUT_MAX];
+static uint8_t s_expected[OUT_MAX];
+
+static void test_wrap(uint32_t seed, uint32_t iterations)
+{
+    static const uint8_t widths[] = { 1, 2, 5, 10, 32, 48, 64 };
+
+    for (size_t i = 0; i < sizeof(s_wrap_cases) / sizeof(s_wrap_cases[0]); i++) {
+        const wrap_case_t *c = &s_wrap_cases[i];
+        render(c->in, strlen(c->in), c->page, c->columns, true);
+        CHECK(out_is(c->out), "corte %zu: '%.*s'", i, (int)s_out_len, s_out);
+    }
+
+    rng_seed(seed);
+    for (uint32_t it = 0; it < iterations; it++) {
+        size_t len = random_text();
+        const page_t *pg = &s_pages[rng_below(PAGE_COUNT)];
+        uint8_t columns = widths[rng_below(sizeof(widths))];
+
+        render(s_text, len, pg->page, 0, false);
+        size_t raw_len = s_out_len;
+        memcpy(s_raw, s_out, raw_len);
+
+        // Sin ancho, text_layout_write() no corta
+        render(s_text, len, pg->page, 0, true);
+        CHECK(s_out_len == raw_len && memcmp(s_out, s_raw, raw_len) == 0,
+              "texto %u (%s): sin ancho no coincide con la salida sin cortar", it, pg->name);
+
+        size_t expected_len = reference_wrap(s_raw, raw_len, columns, s_expected);
+        render(s_text, len, pg->page, columns, true);
+        if (s_out_len != expected_len || memcmp(s_out, s_expected, expected_len) != 0) {
+            CHECK(false, "texto %u (%s, %u columnas): distinto de la referencia", it, pg->name, columns);
+            continue;
+        }
+
+        size_t col = 0;
+        for (size_t k = 0; k < s_out_len; k++) {
+            col = s_out[k] == '\n' ? 0 : col + 1;
+            if (col > columns) {
+                CHECK(false, "texto %u: línea de más de %u columnas", it, columns);
+                break;
+            }
+        }
+
+        if (s_failures > 20) {
+            printf("demasiados fallos, semilla %u\n", seed);
+            return;
+        }
+    }
+}
+
+// ============================================
+// BENCHMARK
+// ============================================
+
+static void bench_text(const char *what, const char *seed_text)
+{
+    static char text[8192];
+    size_t len = 0;
+    size_t seed_len = strlen(seed_text);
+
+    while (len + seed_len < sizeof(text)) {
+        memcpy(text + len, seed_text, seed_len);
+        len += seed_len;
+    }
+    text[len] = '\0';
+
+    printf("  %-14s", what);
+    for (size_t p = 0; p < PAGE_COUNT; p++) {
+        static const uint8_t columns[] = { 0, 32, 48 };
+        for (size_t c = 0; c < sizeof(columns); c++) {
+            size_t rounds = 0;
+            double start = now_seconds();
+            double elapsed;
+            do {
+                render(text, len, s_pages[p].page, columns[c], columns[c] > 0);
+                rounds++;
+                elapsed = now_seconds() - start;
+            } while (elapsed < 0.05);
+            printf(" %6.1f", rounds * len / elapsed / 1e6);
+        }
+        printf(" |");
+    }
+    printf("\n");
+}
+
+static void bench(void)
+{
+    printf("text_layout, MB/s de UTF-8 (sin corte / 32 / 48 columnas):\n");
+    printf("  %-14s %-22s| %-22s| %-22s|\n", "", " CP850", " CP858", " WPC1252");
+    bench_text("ASCII", "The quick brown fox jumps over the lazy dog. ");
+    bench_text("acentos", "¿Dónde está el pingüino? ¡Qué año! Mañana a las 10:00, café y niños. ");
+    bench_text("celular", "“Felicidades” — ¡gracias! 😀👍🏽 te quiero ❤️… nos vemos ‘mañana’ €20 ");
+}
+
+// ============================================
+// MAIN
+// ============================================
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 12345;
+    uint32_t iterations = 20000;
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoul(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = strtoul(argv[i + 1], NULL, 0);
+        }
+    }
+
+    test_pages();
+    test_extras();
+    test_specials();
+    test_wrap(seed, iterations);
+    if (bench_requested(argc, argv)) {
+        bench();
+    }
+    return host_test_result("text_layout");
+}